@@ -14,22 +14,20 @@ echo "Installing $SENSOR sensor on $BOARD board from inside directory $DIR" >> "
 
 mkdir -p "$BOARD_DIR" || true
 cp -RL "$DIR/install.sh" "$BOARD_DIR/" || true
-echo /usr/bin/python3 -c "open('$BOARD_DIR/lunar.yaml', 'w')\
-    .write(\
-        open('$DIR/lunar.yaml')\
-        .read()\
-        .replace('SENSOR_DEFINITION', open('$DIR/$SENSOR.yaml').read())\
-    )" >> "$LOG_PATH"
-/usr/bin/python3 -c "open('$BOARD_DIR/lunar.yaml', 'w')\
-    .write(\
-        open('$DIR/lunar.yaml')\
-        .read()\
-        .replace('SENSOR_DEFINITION', open('$DIR/$SENSOR.yaml').read())\
-    )" >> "$LOG_PATH"
+SPLICE_SENSOR="import re
+sensor = open('$DIR/$SENSOR.yaml').read()
+filters = open('$DIR/filters.yaml').read().splitlines()
+sensor = re.sub(r'^( *)LUX_FILTERS\$', lambda m: '\\n'.join(m.group(1) + line if line else line for line in filters), sensor, flags=re.M)
+open('$BOARD_DIR/lunar.yaml', 'w').write(open('$DIR/lunar.yaml').read().replace('SENSOR_DEFINITION', sensor))"
+echo "$SPLICE_SENSOR" >> "$LOG_PATH"
+/usr/bin/python3 -c "$SPLICE_SENSOR" >> "$LOG_PATH"
 cd "$BOARD_DIR"
 export PATH="/opt/homebrew/bin:/usr/local/bin:$PATH"
 
 BOARD="${BOARD:-esp32dev}"
+FILTER_WINDOW="${FILTER_WINDOW:-7}"
+DELTA_THRESHOLD="${DELTA_THRESHOLD:-0.02}"
+HEARTBEAT_MS="${HEARTBEAT_MS:-60000}"
 
 PLATFORM_VERSION="${PLATFORM_VERSION:-platformio/espressif32@6.3.2}"
 PLATFORM="${PLATFORM:-ESP32}"
@@ -92,6 +90,7 @@ echo "" | tee -a "$LOG_PATH"
 echo "SSID=$WIFI_SSID" | tee -a "$LOG_PATH"
 echo "PASSWORD=$WIFI_PASSWORD" | tee -a "$LOG_PATH"
 echo "SENSOR=$SENSOR" | tee -a "$LOG_PATH"
+echo "FILTER_WINDOW=$FILTER_WINDOW DELTA_THRESHOLD=$DELTA_THRESHOLD HEARTBEAT_MS=$HEARTBEAT_MS" | tee -a "$LOG_PATH"
 echo "" | tee -a "$LOG_PATH"
 
 echo /usr/bin/python3 -m esphome \
@@ -102,6 +101,9 @@ echo /usr/bin/python3 -m esphome \
     -s platform_version "$PLATFORM_VERSION" \
     -s sda "$SDA" \
     -s scl "$SCL" \
+    -s filter_window "$FILTER_WINDOW" \
+    -s delta_threshold "$DELTA_THRESHOLD" \
+    -s heartbeat_ms "$HEARTBEAT_MS" \
     run "$BOARD_DIR/lunar.yaml" --no-logs --device "$ESP_DEVICE" 2>&1 | tee -a "$LOG_PATH"
 if [[ $PIPESTATUS ]]; then
     echo "\${PIPESTATUS[0]} == ${PIPESTATUS[0]}"
@@ -116,6 +118,9 @@ fi
     -s platform_version "$PLATFORM_VERSION" \
     -s sda "$SDA" \
     -s scl "$SCL" \
+    -s filter_window "$FILTER_WINDOW" \
+    -s delta_threshold "$DELTA_THRESHOLD" \
+    -s heartbeat_ms "$HEARTBEAT_MS" \
     run "$BOARD_DIR/lunar.yaml" --no-logs --device "$ESP_DEVICE" 2>&1 | tee -a "$LOG_PATH"
 if [[ $PIPESTATUS ]]; then
     echo "\${PIPESTATUS[0]} == ${PIPESTATUS[0]}"
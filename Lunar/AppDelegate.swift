@@ -167,6 +167,8 @@ enum MemoryUsageError: Error {
 }
 
 let SWIFTUI_PREVIEW = ProcessInfo.processInfo.environment["XCODE_RUNNING_FOR_PREVIEWS"] == "1"
+/// Set when the app is only the host of the `LunarTests` bundle
+let UNIT_TESTING = ProcessInfo.processInfo.environment["XCTestConfigurationFilePath"] != nil
 
 var lastXDRContrastResetTime = Date()
 
@@ -849,6 +851,12 @@ final class AppDelegate: NSObject, NSApplicationDelegate, CLLocationManagerDeleg
                 DC.activeDisplays.values.forEach { $0.responsiveDDC = true }
             }
         }.store(in: &observers)
+        sensorHostnamePublisher.debounce(for: .seconds(1), scheduler: RunLoop.main).sink { _ in
+            SensorEventStream.restart()
+        }.store(in: &observers)
+        sensorStreamingPublisher.sink { _ in
+            mainAsync { SensorEventStream.restart() }
+        }.store(in: &observers)
     }
 
     func validateMenuItem(_ menuItem: NSMenuItem) -> Bool {
@@ -1118,6 +1126,7 @@ final class AppDelegate: NSObject, NSApplicationDelegate, CLLocationManagerDeleg
         mainAsyncAfter(ms: 1000) {
             DC.recomputeAllDisplaysBrightness(activeDisplays: DC.activeDisplayList)
             DC.adaptBrightness()
+            SensorEventStream.restart()
         }
     }
 
@@ -2145,11 +2154,14 @@ final class AppDelegate: NSObject, NSApplicationDelegate, CLLocationManagerDeleg
                 let argList = Array(CommandLine.arguments[idx + 1 ..< CommandLine.arguments.count])
             #endif
 
+            // `lunar batch` opens its own session with the running instance
+            let batch = (try? Lunar.parseAsRoot(argList)) is Lunar.Batch
+
             let exc = tryBlock {
-                guard !argList.contains("--new-instance"), self.otherLunar() != nil,
+                guard !argList.contains("--new-instance"), !batch, self.otherLunar() != nil,
                       let socket = try? Socket.create(), let opts = Lunar.globalOptions(args: argList)
                 else {
-                    if !argList.contains("--remote") {
+                    if !argList.contains("--remote") || batch {
                         self.initCacheTransitionLogging()
                         Lunar.main(argList)
                     } else if argList.contains("--new-instance") {
@@ -2162,12 +2174,12 @@ final class AppDelegate: NSObject, NSApplicationDelegate, CLLocationManagerDeleg
                     return
                 }
 
-                let argString = argList.without("--remote").joined(separator: CLI_ARG_SEPARATOR)
                 let key = opts.key.isEmpty ? Defaults[.apiKey] : opts.key
+                let request = ([key] + argList.without("--remote")).map(CLISession.escape).joined(separator: CLI_ARG_SEPARATOR)
 
                 do {
                     try socket.connect(to: opts.host, port: LUNAR_CLI_PORT)
-                    try socket.write(from: "\(key)\(CLI_ARG_SEPARATOR)\(argString)")
+                    try socket.write(from: "\(request)\n")
                     var statusCode: Int32 = 0
 
                     if var response = try (socket.readString())?.trimmed {
@@ -2311,6 +2323,9 @@ final class AppDelegate: NSObject, NSApplicationDelegate, CLLocationManagerDeleg
             sentryCrashExceptionApplicationType = SentryCrashExceptionApplication.self
         }
 
+        // the tests only need the types, not a Lunar that controls the displays
+        guard !UNIT_TESTING else { return }
+
         initDDCLogging()
         guard !SWIFTUI_PREVIEW else {
             DC.displays = DC.getDisplaysLock.around {
@@ -2523,6 +2538,7 @@ final class AppDelegate: NSObject, NSApplicationDelegate, CLLocationManagerDeleg
     }
 
     func applicationWillTerminate(_: Notification) {
+        DisplayPersistence.shared.flush()
         if isServer {
             DC.cleanup()
         }
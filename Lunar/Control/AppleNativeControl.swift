@@ -139,6 +139,7 @@ final class AppleNativeControl: Control {
         guard let display else { return false }
         let br = preciseBrightness ?? (brightness.d / 100.0)
         var success = true
+        let writeStartedAt = DispatchTime.now()
 
         switch method {
         case .coreDisplay:
@@ -148,6 +149,11 @@ final class AppleNativeControl: Control {
             if success, br == 1.0 {
                 DisplayServicesSetLinearBrightness(display.id, br.f)
             }
+        }
+        if success {
+            HealthMetrics.shared.display(display.id).nativeWrite.observe(ns: DispatchTime.now().rawValue - writeStartedAt.rawValue)
+        }
+        if method == .displayServices {
             updateNits()
         }
 
@@ -0,0 +1,416 @@
+//
+//  ControllerClient.swift
+//  Lunar
+//
+//  Created by Alin Panaitiu on 19.10.2026.
+//  Copyright © 2026 Alin. All rights reserved.
+//
+
+import Foundation
+
+// MARK: - LatencyStats
+
+/// Rolling window of request latencies in milliseconds, used for percentile reporting
+struct LatencyStats {
+    init(capacity: Int = 256) {
+        self.capacity = max(capacity, 1)
+        samples.reserveCapacity(self.capacity)
+    }
+
+    let capacity: Int
+
+    private(set) var total = 0
+    private(set) var failures = 0
+
+    var count: Int { samples.count }
+
+    var p50: Double? { percentile(50) }
+    var p99: Double? { percentile(99) }
+
+    mutating func record(_ ms: Double) {
+        if samples.count < capacity {
+            samples.append(ms)
+        } else {
+            samples[total % capacity] = ms
+        }
+        total += 1
+    }
+
+    mutating func recordFailure() {
+        failures += 1
+    }
+
+    /// Nearest-rank percentile over the window
+    func percentile(_ p: Double) -> Double? {
+        guard !samples.isEmpty else { return nil }
+
+        let sorted = samples.sorted()
+        let rank = Int((cap(p, minVal: 0, maxVal: 100) / 100 * sorted.count.d).rounded(.up))
+        return sorted[cap(rank - 1, minVal: 0, maxVal: sorted.count - 1)]
+    }
+
+    private var samples: [Double] = []
+}
+
+// MARK: - BatchWrite
+
+/// One entry of a `POST /batch` request to a network controller.
+///
+/// The body is `{"writes": [BatchWrite]}` and the controller answers with `{"results": [BatchResult]}` in the same order.
+/// `display` is the controller's display number (the `/1`, `/2` path of the single requests)
+/// and `control` is the lowercased `ControlID`. Smooth transitions are never batched.
+struct BatchWrite: Codable, Equatable {
+    let display: Int
+    let control: String
+    let value: UInt16
+}
+
+// MARK: - BatchResult
+
+struct BatchResult: Codable, Equatable {
+    static let failed = BatchResult(ok: false, value: nil, error: "request failed")
+
+    let ok: Bool
+    let value: String?
+    let error: String?
+}
+
+// MARK: - ControllerClient
+
+/// Persistent HTTP/1.1 client for one network controller (host + port).
+///
+/// All displays behind a controller share one `URLSession`, so connections are kept alive and requests
+/// are pipelined instead of opening a new TCP connection for every VCP write.
+///
+/// Writes are coalesced per key (display + control): while a write for a key is in flight, newer values
+/// replace the queued one and only the latest gets sent. At most `maxInFlight` requests are outstanding.
+final class ControllerClient {
+    init(host: String, port: Int, maxInFlight: Int = CachedDefaults[.networkMaxInFlight]) {
+        self.host = host
+        self.port = port
+        self.maxInFlight = max(maxInFlight, 1)
+
+        let config = URLSessionConfiguration.ephemeral
+        config.httpShouldUsePipelining = true
+        config.httpMaximumConnectionsPerHost = self.maxInFlight
+        config.httpShouldSetCookies = false
+        config.requestCachePolicy = .reloadIgnoringLocalCacheData
+        config.httpAdditionalHeaders = ["Connection": "keep-alive"]
+        config.timeoutIntervalForRequest = 15
+        session = URLSession(configuration: config)
+
+        queue = DispatchQueue(label: "fyi.lunar.controller.\(host):\(port).queue", qos: .userInitiated)
+    }
+
+    deinit {
+        session.invalidateAndCancel()
+    }
+
+    let host: String
+    let port: Int
+    let maxInFlight: Int
+    let session: URLSession
+
+    /// Writes that were replaced by a newer value before being sent
+    private(set) var coalesced = 0
+
+    var latency: LatencyStats {
+        queue.sync { stats }
+    }
+
+    var description: String {
+        "\(host):\(port)"
+    }
+
+    static func shared(for url: URL) -> ControllerClient? {
+        guard let host = url.host else { return nil }
+        let port = url.port ?? (url.scheme == "https" ? 443 : 80)
+
+        return clientsLock.around {
+            let key = "\(host):\(port)"
+            if let client = clients[key] {
+                return client
+            }
+            let client = ControllerClient(host: host, port: port)
+            clients[key] = client
+            return client
+        }
+    }
+
+    static func removeAll() {
+        clientsLock.around { clients.removeAll() }
+    }
+
+    /// `scheme://host:port` of the controller, `/batch` lives under it
+    var base: URL? {
+        var components = URLComponents()
+        components.scheme = "http"
+        components.host = host.contains(":") ? "[\(host)]" : host
+        components.port = port
+        return components.url
+    }
+
+    /// `nil` until the controller answered a batch request, `false` for controllers that only know single requests
+    var supportsBatch: Bool? {
+        queue.sync { batchSupport }
+    }
+
+    /// Queues a write, replacing any queued write with the same `key` that wasn't sent yet.
+    ///
+    /// When more than one write with the same `timeout` is ready and `batch` describes them, they are sent together in one `POST /batch`.
+    /// `onResponse` is called on the client queue with the response body, or `nil` on failure.
+    /// Callbacks of replaced writes are dropped.
+    func enqueue(key: String, url: URL, timeout: TimeInterval, batch: BatchWrite? = nil, onResponse: @escaping (String?) -> Void) {
+        queue.async { [self] in
+            add(key: key, write: Write(url: url, timeout: timeout, batch: batch, onResponse: onResponse, onReplaced: nil))
+            pump()
+        }
+    }
+
+    /// Queues all `writes` before sending anything, so they leave together in as few `/batch` requests as `MAX_BATCH_SIZE` allows.
+    ///
+    /// `completion` is called once on the client queue with one response per write in input order,
+    /// `nil` for writes that failed or were replaced by a newer value before being sent.
+    func enqueue(_ writes: [(key: String, url: URL, batch: BatchWrite?)], timeout: TimeInterval, completion: @escaping ([String?]) -> Void) {
+        guard !writes.isEmpty else {
+            completion([])
+            return
+        }
+
+        queue.async { [self] in
+            var responses = [String?](repeating: nil, count: writes.count)
+            var remaining = writes.count
+            let done = { (i: Int, response: String?) in
+                responses[i] = response
+                remaining -= 1
+                if remaining == 0 {
+                    completion(responses)
+                }
+            }
+
+            for (i, write) in writes.enumerated() {
+                add(key: write.key, write: Write(
+                    url: write.url, timeout: timeout, batch: write.batch,
+                    onResponse: { done(i, $0) }, onReplaced: { done(i, nil) }
+                ))
+            }
+            pump()
+        }
+    }
+
+    /// JSON `POST` on the shared connection, `completion` gets the status code and body (`nil` status on network errors)
+    func post(_ url: URL, json body: Data, timeout: TimeInterval, completion: @escaping (Int?, Data?) -> Void) {
+        var request = URLRequest(url: url, cachePolicy: .reloadIgnoringLocalCacheData, timeoutInterval: timeout)
+        request.httpMethod = "POST"
+        request.setValue("application/json", forHTTPHeaderField: "Content-Type")
+        request.setValue("keep-alive", forHTTPHeaderField: "Connection")
+        request.httpBody = body
+        perform(request, completion: completion)
+    }
+
+    /// Blocking request on the shared connection, used for reads
+    func get(_ url: URL, timeout: TimeInterval) -> String? {
+        let semaphore = DispatchSemaphore(value: 0, name: "ControllerClient.get \(url.absoluteString)")
+        var response: String?
+
+        send(url, timeout: timeout) { resp in
+            response = resp
+            semaphore.signal()
+        }
+        guard semaphore.wait(for: timeout + 0.5) != .timedOut else { return nil }
+        return response
+    }
+
+    private struct Write {
+        let url: URL
+        let timeout: TimeInterval
+        let batch: BatchWrite?
+        let onResponse: (String?) -> Void
+        let onReplaced: (() -> Void)?
+    }
+
+    private struct BatchRequest: Codable {
+        let writes: [BatchWrite]
+    }
+
+    private struct BatchResponse: Codable {
+        let results: [BatchResult]
+    }
+
+    private static let MAX_BATCH_SIZE = 32
+
+    private static var clients: [String: ControllerClient] = [:]
+    private static let clientsLock = NSRecursiveLock()
+
+    private let queue: DispatchQueue
+
+    private var pending: [String: Write] = [:]
+    private var order: [String] = []
+    private var inFlightKeys: Set<String> = []
+    private var inFlight = 0
+    private var batchSupport: Bool?
+    private var stats = LatencyStats()
+
+    /// Sends `writes` in a single round-trip and calls `completion` with one result per write, in order,
+    /// or with `nil` when the controller doesn't speak the `/batch` protocol. Must be called on `queue`
+    private func postBatch(_ writes: [BatchWrite], timeout: TimeInterval, completion: @escaping ([BatchResult]?) -> Void) {
+        guard let base, !writes.isEmpty else {
+            completion(writes.map { _ in .failed })
+            return
+        }
+
+        let body = (try? JSONEncoder().encode(BatchRequest(writes: writes))) ?? Data()
+        post(base / "batch", json: body, timeout: timeout) { [weak self] status, data in
+            guard let self else { return }
+
+            guard let status else {
+                completion(writes.map { _ in .failed })
+                return
+            }
+
+            // any other status, or a success that isn't a result per write, means the writes were never applied as a batch
+            guard (200 ..< 300).contains(status), let data,
+                  let response = try? JSONDecoder().decode(BatchResponse.self, from: data),
+                  response.results.count == writes.count
+            else {
+                completion(nil)
+                return
+            }
+            queue.async { self.batchSupport = true }
+            completion(response.results)
+        }
+    }
+
+    /// Starts queued writes while there's room, never two writes for the same key at once so they can't be reordered
+    private func pump() {
+        while inFlight < maxInFlight {
+            let ready = order.filter { !inFlightKeys.contains($0) }
+            guard let first = ready.first else { return }
+
+            if batchSupport != false, let timeout = pending[first]?.timeout {
+                let batchable = ready.filter { pending[$0]?.batch != nil && pending[$0]?.timeout == timeout }.prefix(Self.MAX_BATCH_SIZE)
+                if batchable.count > 1 {
+                    sendBatch(keys: Array(batchable), timeout: timeout)
+                    continue
+                }
+            }
+            sendSingle(key: first)
+        }
+    }
+
+    private func add(key: String, write: Write) {
+        if let replaced = pending[key] {
+            coalesced += 1
+            replaced.onReplaced?()
+        } else {
+            order.append(key)
+        }
+        pending[key] = write
+    }
+
+    private func take(_ key: String) -> Write? {
+        order.removeAll { $0 == key }
+        guard let write = pending.removeValue(forKey: key) else { return nil }
+
+        inFlightKeys.insert(key)
+        return write
+    }
+
+    private func sendSingle(key: String) {
+        guard let write = take(key) else { return }
+
+        inFlight += 1
+        send(write.url, timeout: write.timeout) { [weak self] resp in
+            guard let self else { return }
+
+            queue.async {
+                self.inFlight -= 1
+                self.inFlightKeys.remove(key)
+                write.onResponse(resp)
+                self.pump()
+            }
+        }
+    }
+
+    private func sendBatch(keys: [String], timeout: TimeInterval) {
+        let writes = keys.compactMap { key in take(key).map { (key, $0) } }
+        guard !writes.isEmpty else { return }
+
+        inFlight += 1
+        postBatch(writes.compactMap(\.1.batch), timeout: timeout) { [weak self] results in
+            guard let self else { return }
+
+            queue.async {
+                self.inFlight -= 1
+                guard let results else {
+                    // the controller didn't apply the batch: queue the writes again so they go out
+                    // one by one within `maxInFlight`, unless a newer value replaced them in the meantime
+                    log.debug("Controller \(self.description) rejected /batch, sending single requests from now on")
+                    self.batchSupport = false
+                    self.requeue(writes)
+                    self.pump()
+                    return
+                }
+
+                for ((key, write), result) in zip(writes, results) {
+                    self.inFlightKeys.remove(key)
+                    write.onResponse(result.ok ? (result.value ?? "") : nil)
+                }
+                self.pump()
+            }
+        }
+    }
+
+    /// Puts taken writes back at the front of the queue, dropping the ones that were replaced in the meantime
+    private func requeue(_ writes: [(String, Write)]) {
+        var keys: [String] = []
+        for (key, write) in writes {
+            inFlightKeys.remove(key)
+            guard pending[key] == nil else {
+                coalesced += 1
+                write.onReplaced?()
+                continue
+            }
+            pending[key] = write
+            keys.append(key)
+        }
+        order.insert(contentsOf: keys, at: 0)
+    }
+
+    private func send(_ url: URL, timeout: TimeInterval, completion: @escaping (String?) -> Void) {
+        var request = URLRequest(url: url, cachePolicy: .reloadIgnoringLocalCacheData, timeoutInterval: timeout)
+        request.setValue("keep-alive", forHTTPHeaderField: "Connection")
+
+        perform(request) { status, data in
+            guard let status, (200 ..< 300).contains(status), let data else {
+                completion(nil)
+                return
+            }
+            completion(String(data: data, encoding: .utf8))
+        }
+    }
+
+    private func perform(_ request: URLRequest, completion: @escaping (Int?, Data?) -> Void) {
+        let start = DispatchTime.now()
+        session.dataTask(with: request) { [weak self] data, response, _ in
+            let ms = (DispatchTime.now().rawValue - start.rawValue).d / 1_000_000
+            let status = (response as? HTTPURLResponse)?.statusCode
+
+            self?.queue.async {
+                guard let self else { return }
+
+                guard let status, (200 ..< 300).contains(status) else {
+                    stats.recordFailure()
+                    return
+                }
+                stats.record(ms)
+                #if DEBUG
+                    if stats.total % 100 == 0, let p50 = stats.p50, let p99 = stats.p99 {
+                        log.debug("Controller \(description): p50=\(p50.str(decimals: 1))ms p99=\(p99.str(decimals: 1))ms coalesced=\(coalesced)")
+                    }
+                #endif
+            }
+            completion(status, data)
+        }.resume()
+    }
+}
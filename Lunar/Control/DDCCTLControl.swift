@@ -60,9 +60,10 @@ struct DDCCTLControl: Control {
     }
 
     func ddcctlSet(_ property: ControlID, value: UInt16) -> Bool {
-        guard let index = displayIndex else { return false }
+        guard let index = displayIndex, let display else { return false }
         let ddcctlSemaphore = DispatchSemaphore(value: 0, name: "ddcctlSemaphore")
         var command = "ddcctl "
+        let writeStartedAt = DispatchTime.now()
         let process: Process
         do {
             var args = ["-d", index.s, propertyArg(property)]
@@ -90,7 +91,9 @@ struct DDCCTLControl: Control {
             return false
         }
 
-        return process.terminationStatus == 0
+        guard process.terminationStatus == 0 else { return false }
+        HealthMetrics.shared.display(display.id).ddcctlWrite.observe(ns: DispatchTime.now().rawValue - writeStartedAt.rawValue)
+        return true
     }
 
     func setRedGain(_ gain: UInt16) -> Bool {
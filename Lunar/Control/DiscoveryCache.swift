@@ -0,0 +1,132 @@
+//
+//  DiscoveryCache.swift
+//  Lunar
+//
+//  Created by Alin Panaitiu on 19.10.2026.
+//  Copyright © 2026 Alin. All rights reserved.
+//
+
+import Foundation
+
+let DISCOVERY_CACHE_FILE = FileManager.default.urls(for: .cachesDirectory, in: .userDomainMask).first!
+    .appendingPathComponent("fyi.lunar.Lunar", isDirectory: true)
+    .appendingPathComponent("controllers.json")
+
+// MARK: - CachedController
+
+/// A resolved `_ddcutil._tcp` service as it was last seen: TXT record, addresses and when it stops being trusted
+struct CachedController: Codable, Equatable {
+    let name: String
+    let type: String
+    let domain: String
+    let hostName: String?
+    let port: Int
+    let addresses: [String]
+    let txt: [String: String]
+    let resolvedAt: Date
+    let ttl: TimeInterval
+
+    var key: String { "\(name).\(type)\(domain)" }
+    var expiresAt: Date { resolvedAt.addingTimeInterval(ttl) }
+    var expired: Bool { expiresAt < Date() }
+
+    /// Unresolved stand-in carrying the cached TXT record, the addresses come from `addresses`
+    func netService() -> NetService {
+        let service = NetService(domain: domain, type: type, name: name, port: port.i32)
+        service.setTXTRecord(dictionary: txt)
+        return service
+    }
+}
+
+// MARK: - DiscoveryCache
+
+/// Persists the network controllers Bonjour resolved, so the next launch or wake can bind displays
+/// to their controllers immediately instead of waiting for browsing and resolving to finish.
+///
+/// Entries are only a hint: `NetworkControl` validates them with a probe right after binding,
+/// and live Bonjour results replace them as soon as they arrive.
+final class DiscoveryCache {
+    init(file: URL = DISCOVERY_CACHE_FILE) {
+        self.file = file
+        load()
+    }
+
+    /// mDNS uses 75 minutes for TXT and host records, controllers are usually static so a cached entry is kept for a day
+    static let DEFAULT_TTL: TimeInterval = 24 * 60 * 60
+
+    static let shared = DiscoveryCache()
+
+    let file: URL
+
+    var entries: [CachedController] {
+        lock.around { controllers.values.filter { !$0.expired }.sorted { $0.resolvedAt > $1.resolvedAt } }
+    }
+
+    func record(_ service: NetService, ttl: TimeInterval = DEFAULT_TTL) {
+        guard let txt = service.txtRecordDictionary, !txt.isEmpty else { return }
+
+        let addresses = (service.addresses ?? []).compactMap { $0.withUnsafeBytes(address) }
+        guard !addresses.isEmpty else { return }
+
+        let entry = CachedController(
+            name: service.name, type: service.type, domain: service.domain, hostName: service.hostName,
+            port: service.port, addresses: addresses, txt: txt, resolvedAt: Date(), ttl: ttl
+        )
+        lock.around {
+            // re-resolves of an unchanged service only refresh the entry once it's halfway to expiring
+            if let existing = controllers[entry.key], existing.addresses == addresses, existing.txt == txt,
+               existing.port == entry.port, timeSince(existing.resolvedAt) < ttl / 2
+            {
+                return
+            }
+
+            controllers[entry.key] = entry
+            scheduleSave()
+        }
+    }
+
+    func remove(_ entry: CachedController) {
+        lock.around {
+            guard controllers.removeValue(forKey: entry.key) != nil else { return }
+            scheduleSave()
+        }
+    }
+
+    func removeAll() {
+        lock.around {
+            controllers.removeAll()
+            scheduleSave()
+        }
+    }
+
+    private let lock = NSRecursiveLock()
+    private var controllers: [String: CachedController] = [:]
+    private var saveTask: DispatchWorkItem?
+
+    private func load() {
+        guard let data = try? Data(contentsOf: file),
+              let cached = try? JSONDecoder().decode([CachedController].self, from: data)
+        else { return }
+
+        controllers = Dictionary(cached.filter { !$0.expired }.map { ($0.key, $0) }, uniquingKeysWith: { a, b in a.resolvedAt > b.resolvedAt ? a : b })
+    }
+
+    /// Resolves come in bursts after wake, write once after they settle
+    private func scheduleSave() {
+        saveTask?.cancel()
+
+        let task = DispatchWorkItem(name: "DiscoveryCache save") { [weak self] in
+            guard let self else { return }
+
+            let cached = lock.around { Array(controllers.values) }
+            do {
+                try FileManager.default.createDirectory(at: file.deletingLastPathComponent(), withIntermediateDirectories: true)
+                try JSONEncoder().encode(cached).write(to: file, options: .atomic)
+            } catch {
+                log.warning("Could not write the network controller cache: \(error)")
+            }
+        }
+        saveTask = task
+        DispatchQueue.global(qos: .utility).asyncAfter(deadline: .now() + 2, execute: task.workItem)
+    }
+}
@@ -0,0 +1,218 @@
+//
+//  EndpointProber.swift
+//  Lunar
+//
+//  Created by Alin Panaitiu on 19.10.2026.
+//  Copyright © 2026 Alin. All rights reserved.
+//
+
+import Foundation
+
+// MARK: - EndpointProber
+
+/// Happy-eyeballs style prober for the addresses a network controller advertises (IPv4, IPv6, link-local).
+///
+/// All candidates are raced at once, with a short stagger in ranking order so the usual winner gets a head start,
+/// and the first one that answers is returned. Probes that lose the race keep running and update a smoothed RTT
+/// per URL, so the next race starts from the fastest known address and a dead address costs nothing once ranked last.
+final class EndpointProber {
+    init(name: String) {
+        self.name = name
+    }
+
+    static let STAGGER: TimeInterval = 0.025
+    static let MIN_REPROBE_INTERVAL: TimeInterval = 1
+    static let MAX_REPROBE_INTERVAL: TimeInterval = 60
+
+    static let queue = DispatchQueue(label: "fyi.lunar.endpoint.prober.queue", qos: .utility)
+    static let raceQueue = DispatchQueue(label: "fyi.lunar.endpoint.race.queue", qos: .userInitiated, attributes: .concurrent)
+    static let session: URLSession = {
+        let config = URLSessionConfiguration.ephemeral
+        config.httpShouldSetCookies = false
+        config.requestCachePolicy = .reloadIgnoringLocalCacheData
+        config.waitsForConnectivity = false
+        return URLSession(configuration: config)
+    }()
+
+    struct Sample {
+        /// Smoothed round-trip time in milliseconds, `nil` until the URL answers once
+        var rtt: Double?
+        var failures = 0
+    }
+
+    let name: String
+
+    /// Known URLs ordered by smoothed RTT, failing URLs last
+    var ranking: [(url: URL, sample: Sample)] {
+        lock.around {
+            samples.map { ($0.key, $0.value) }.sorted { Self.rank($0.sample, before: $1.sample) }
+        }
+    }
+
+    /// `urls` reordered by what previous races measured, keeping the given order for URLs without samples
+    func ranked(_ urls: [URL]) -> [URL] {
+        lock.around {
+            urls.enumerated().sorted { a, b in
+                let sa = samples[a.element] ?? Sample()
+                let sb = samples[b.element] ?? Sample()
+                if Self.rank(sa, before: sb) { return true }
+                if Self.rank(sb, before: sa) { return false }
+                return a.offset < b.offset
+            }.map(\.element)
+        }
+    }
+
+    /// Races all `urls` and returns the first one to answer with a 2xx, or `nil` if none did within `timeout`.
+    ///
+    /// Blocks the calling thread for at most one RTT of the fastest live address (plus the stagger),
+    /// instead of one timeout per dead address.
+    func firstResponding(_ urls: [URL], timeout: TimeInterval) -> URL? {
+        let semaphore = DispatchSemaphore(value: 0, name: "EndpointProber.firstResponding \(name)")
+        var result: URL?
+
+        // `race` always completes, at the latest when its timeout passes
+        race(urls, timeout: timeout) { url in
+            result = url
+            semaphore.signal()
+        }
+        semaphore.wait(for: 0)
+        return result
+    }
+
+    /// Starts a probe for every URL in ranking order, `STAGGER` apart, and calls `completion` once on the race queue
+    /// with the first URL that answered with a 2xx, or with `nil` when all of them failed or `timeout` passed.
+    ///
+    /// The probes that lose keep running so their RTT still updates the ranking.
+    func race(_ urls: [URL], timeout: TimeInterval, completion: @escaping (URL?) -> Void) {
+        let candidates = ranked(urls)
+        guard !candidates.isEmpty else {
+            completion(nil)
+            return
+        }
+
+        let raceLock = NSRecursiveLock()
+        var done = false
+        var finished = 0
+
+        let finish = { [name] (url: URL?) in
+            guard raceLock.around({ () -> Bool in
+                defer { done = true }
+                return !done
+            }) else { return }
+
+            #if DEBUG
+                log.debug("Probed \(candidates.count) endpoints for \(name): \(url?.absoluteString ?? "none responded")")
+            #endif
+            completion(url)
+        }
+
+        for (i, url) in candidates.enumerated() {
+            Self.raceQueue.asyncAfter(deadline: .now() + Self.STAGGER * i.d) { [self] in
+                probe(url, timeout: timeout) { ok in
+                    let last: Bool = raceLock.around {
+                        finished += 1
+                        return finished == candidates.count
+                    }
+                    if ok {
+                        finish(url)
+                    } else if last {
+                        finish(nil)
+                    }
+                }
+            }
+        }
+        Self.raceQueue.asyncAfter(deadline: .now() + timeout + Self.STAGGER * candidates.count.d) {
+            finish(nil)
+        }
+    }
+
+    /// Re-races `urls` in the background until one answers, waiting twice as long after each failed round.
+    ///
+    /// Calling it again while a re-probe is pending does nothing, `onRecovered` is called on the prober queue.
+    /// The races themselves run on the concurrent race queue, so a controller that doesn't answer
+    /// doesn't hold up the re-probes of the others.
+    func reprobe(_ urls: [URL], timeout: TimeInterval, onRecovered: @escaping (URL) -> Void) {
+        Self.queue.async { [self] in
+            guard reprobeTask == nil else { return }
+
+            let delay = min(Self.MAX_REPROBE_INTERVAL, Self.MIN_REPROBE_INTERVAL * pow(2, reprobeAttempt.d))
+            reprobeAttempt = min(reprobeAttempt + 1, 16)
+            let round = reprobeRound
+
+            let task = DispatchWorkItem(name: "EndpointProber.reprobe \(name)") { [weak self] in
+                self?.race(urls, timeout: timeout) { url in
+                    Self.queue.async {
+                        guard let self, round == reprobeRound else { return }
+                        reprobeTask = nil
+
+                        guard let url else {
+                            reprobe(urls, timeout: timeout, onRecovered: onRecovered)
+                            return
+                        }
+                        reprobeAttempt = 0
+                        onRecovered(url)
+                    }
+                }
+            }
+            reprobeTask = task
+            Self.queue.asyncAfter(deadline: .now() + delay, execute: task.workItem)
+        }
+    }
+
+    func cancelReprobe() {
+        Self.queue.async { [self] in
+            reprobeTask?.cancel()
+            reprobeTask = nil
+            reprobeAttempt = 0
+            reprobeRound += 1
+        }
+    }
+
+    private let lock = NSRecursiveLock()
+    private var samples: [URL: Sample] = [:]
+
+    private var reprobeTask: DispatchWorkItem?
+    private var reprobeAttempt = 0
+    /// Bumped by `cancelReprobe`, so a race that was already running when it was cancelled doesn't report back
+    private var reprobeRound = 0
+
+    /// Lower RTT first, then URLs that never answered, then URLs that failed the most
+    private static func rank(_ a: Sample, before b: Sample) -> Bool {
+        switch (a.rtt, b.rtt) {
+        case let (.some(ra), .some(rb)) where a.failures == b.failures:
+            return ra < rb
+        case (.some, .none) where a.failures <= b.failures:
+            return true
+        case (.none, .some) where a.failures < b.failures:
+            return true
+        default:
+            return a.failures < b.failures
+        }
+    }
+
+    private func probe(_ url: URL, timeout: TimeInterval, completion: @escaping (Bool) -> Void) {
+        let request = URLRequest(url: url, cachePolicy: .reloadIgnoringLocalCacheData, timeoutInterval: timeout)
+        let start = DispatchTime.now()
+
+        Self.session.dataTask(with: request) { [weak self] _, response, _ in
+            let ok = (response as? HTTPURLResponse).map { (200 ..< 300).contains($0.statusCode) } ?? false
+            let ms = (DispatchTime.now().rawValue - start.rawValue).d / 1_000_000
+            self?.record(url, ok: ok, ms: ms)
+            completion(ok)
+        }.resume()
+    }
+
+    private func record(_ url: URL, ok: Bool, ms: Double) {
+        lock.around {
+            var sample = samples[url] ?? Sample()
+            if ok {
+                // same smoothing as TCP's SRTT, one slow answer doesn't demote a good address
+                sample.rtt = sample.rtt.map { $0 + 0.125 * (ms - $0) } ?? ms
+                sample.failures = 0
+            } else {
+                sample.failures += 1
+            }
+            samples[url] = sample
+        }
+    }
+}
@@ -16,23 +16,37 @@ import UserNotifications
 // MARK: - Service
 
 final class Service {
-    init(_ service: NetService, scheme: String = "http", path: String = "") {
+    init(_ service: NetService, scheme: String = "http", path: String = "", cachedAddresses: [String] = []) {
         self.service = service
         self.scheme = scheme
         self.path = path
+        self.cachedAddresses = cachedAddresses
+        prober = EndpointProber(name: "\(service.name):\(service.port)")
     }
 
     var scheme: String
     var path: String
     var service: NetService
+    let prober: EndpointProber
+
+    /// Addresses from the discovery cache, used until Bonjour resolves the service
+    let cachedAddresses: [String]
+
+    var fromCache: Bool { service.addresses == nil && !cachedAddresses.isEmpty }
+
+    var addresses: [String] {
+        guard let addresses = service.addresses else { return cachedAddresses }
+        return addresses.compactMap { $0.withUnsafeBytes(address) }
+    }
+
+    /// Display number on the controller, parsed from the `/<n>` path
+    var displayNumber: Int? {
+        Int(path.trimmingCharacters(in: CharacterSet(charactersIn: "/")))
+    }
 
     lazy var urls: [URL] = {
-        guard let addresses = service.addresses else { return [] }
-        return addresses
-            .compactMap { data in
-                guard let addr = data.withUnsafeBytes(address) else { return nil }
-                return buildURL(addr)
-            }
+        addresses
+            .compactMap { addr in buildURL(addr) }
             .sorted { u1, u2 in
                 guard let h1 = u1.host, let h2 = u2.host else { return false }
                 return !h1.contains(":") && h2.contains(":")
@@ -40,12 +54,8 @@ final class Service {
     }()
 
     lazy var maxValueUrls: [URL] = {
-        guard let addresses = service.addresses else { return [] }
-        return addresses
-            .compactMap { data in
-                guard let addr = data.withUnsafeBytes(address) else { return nil }
-                return buildURL(addr, path: "/max\(path)")
-            }
+        addresses
+            .compactMap { addr in buildURL(addr, path: "/max\(path)") }
             .sorted { u1, u2 in
                 guard let h1 = u1.host, let h2 = u2.host else { return false }
                 return !h1.contains(":") && h2.contains(":")
@@ -53,12 +63,8 @@ final class Service {
     }()
 
     lazy var smoothTransitionUrls: [URL] = {
-        guard let addresses = service.addresses else { return [] }
-        return addresses
-            .compactMap { data in
-                guard let addr = data.withUnsafeBytes(address) else { return nil }
-                return buildURL(addr, path: "/smooth\(path)")
-            }
+        addresses
+            .compactMap { addr in buildURL(addr, path: "/smooth\(path)") }
             .sorted { u1, u2 in
                 guard let h1 = u1.host, let h2 = u2.host else { return false }
                 return !h1.contains(":") && h2.contains(":")
@@ -120,14 +126,28 @@ final class Service {
         return urlBuilder.url
     }
 
+    /// Races all `urls` and returns the first that responds, `retries` rounds at most
     func getFirstRespondingURL(urls: [URL], timeout: DateComponents = 3.seconds, retries: UInt = 3) -> URL? {
-        for url in urls {
-            if waitForResponse(from: url, timeoutPerTry: timeout, retries: retries) != nil {
+        for _ in 0 ..< max(retries, 1) {
+            if let url = prober.firstResponding(urls, timeout: timeout.timeInterval) {
                 return url
             }
         }
         return nil
     }
+
+    /// Keeps racing the addresses in the background with exponential backoff and switches to the first that answers
+    func reprobe() {
+        prober.reprobe(urls, timeout: 0.6) { [weak self] url in
+            guard let self else { return }
+
+            log.info("Controller \(service.name) is reachable again at \(url)")
+            _url = url
+            urlInitialized = true
+            _smoothTransitionUrl = prober.firstResponding(smoothTransitionUrls, timeout: 0.6)
+            smoothTransitionUrlInitialized = true
+        }
+    }
 }
 
 // MARK: - NetworkControl
@@ -138,17 +158,15 @@ final class NetworkControl: Control {
         listenForRequests()
     }
 
-    struct Request: Equatable {
-        var url: URL
-        var controlID: ControlID
-        var timeout: DateComponents
-        var value: UInt16
-    }
-
     static var browser = CiaoBrowser()
     static var controllersForDisplay: [String: Service] = [:]
     static var controllerVideoObserver: Cancellable?
     static let browserSemaphore = DispatchSemaphore(value: 1, name: "browserSemaphore")
+    static var discoveryStartedAt = Date()
+    static var firstBindLogged = false
+    /// Keys of the cache entries probed this run, and of those that didn't answer. Only touched on the main thread
+    static var probedCacheEntries: Set<String> = []
+    static var unresponsiveCacheEntries: Set<String> = []
 
     var displayControl: DisplayControl = .network
 
@@ -157,15 +175,15 @@ final class NetworkControl: Control {
     var setterTasks = [ControlID: DispatchWorkItem]()
     let getterTasksSemaphore = DispatchSemaphore(value: 1, name: "getterTasksSemaphore")
 
-    var requestsPublishers: [ControlID: PassthroughSubject<Request, Never>] = ControlID.allCases.dict {
-        ($0, PassthroughSubject<Request, Never>())
-    }
     var responsiveCheckPublisher = PassthroughSubject<Bool, Never>()
 
     var observers = Set<AnyCancellable>()
 
     var responsiveTryCount = 0
 
+    /// Called with the control once the controller finished a smooth transition, or answered the write that replaced it
+    @AtomicLock var onTransitionDone: ((ControlID) -> Void)? = nil
+
     var isSoftware: Bool { false }
     var isDDC: Bool { true }
 
@@ -175,6 +193,7 @@ final class NetworkControl: Control {
             for service in Set(browser.services).subtracting(matchedServices) {
                 matchTXTRecord(service)
             }
+            bindFromCache()
         }
         listenForDDCUtilControllers()
         controllerVideoObserver = disableControllerVideoPublisher.sink { change in
@@ -194,10 +213,17 @@ final class NetworkControl: Control {
         return false
     }
 
-    static func promptForNetworkControl(_ displayNum: Int, netService: NetService, display: Display) {
-        let service = Service(netService, path: "/\(displayNum)")
+    static func promptForNetworkControl(_ displayNum: Int, netService: NetService, display: Display, cached: CachedController? = nil) {
+        let service = Service(netService, path: "/\(displayNum)", cachedAddresses: cached?.addresses ?? [])
         guard !service.urls.isEmpty else { return }
 
+        // cached services never prompt, they only stand in for a controller the user already chose to always use
+        if let cached {
+            guard display.alwaysUseNetworkControl, controllersForDisplay[display.serial] == nil else { return }
+            bindCached(service, entry: cached, display: display)
+            return
+        }
+
         log
             .debug(
                 "Matched display [\(display.id): \(display.name)] with network controller (\(netService.hostName ?? "nil"): \(service.urls)"
@@ -207,6 +233,7 @@ final class NetworkControl: Control {
             mainAsync {
                 if useNetwork == .alertFirstButtonReturn {
                     controllersForDisplay[display.serial] = service
+                    logFirstBind(display, source: "Bonjour")
 
                     display.control = display.getBestControl()
                 }
@@ -253,14 +280,14 @@ final class NetworkControl: Control {
         }
     }
 
-    static func matchTXTRecord(_ netService: NetService) {
+    static func matchTXTRecord(_ netService: NetService, cached: CachedController? = nil) {
         guard let txt = netService.txtRecordDictionary else { return }
 
         let serviceConnectedDisplayCount = Set(txt.compactMap { $0.key.split(separator: ":").first }).count
         if serviceConnectedDisplayCount == 1, DC.activeDisplays.count == 1,
            let display = DC.activeDisplays.first?.value, shouldPromptForNetworkControl(display)
         {
-            asyncNow { promptForNetworkControl(1, netService: netService, display: display) }
+            asyncNow { promptForNetworkControl(1, netService: netService, display: display, cached: cached) }
             return
         }
 
@@ -280,10 +307,58 @@ final class NetworkControl: Control {
             else {
                 continue
             }
-            asyncNow { promptForNetworkControl(displayNum, netService: netService, display: display) }
+            asyncNow { promptForNetworkControl(displayNum, netService: netService, display: display, cached: cached) }
         }
     }
 
+    /// Binds displays to the controllers resolved on a previous run, before Bonjour has found anything
+    static func bindFromCache() {
+        for entry in DiscoveryCache.shared.entries where !browser.services.contains(where: { $0.name == entry.name && $0.type == entry.type }) {
+            matchTXTRecord(entry.netService(), cached: entry)
+        }
+    }
+
+    /// Uses the cached controller right away and checks in the background that it still answers at one of the cached addresses.
+    ///
+    /// Each entry is probed once per run, the first time it's actually bound. An entry that didn't answer
+    /// isn't bound again until Bonjour finds the controller, and is only dropped from the cache if Bonjour
+    /// hasn't confirmed it recently, so a controller that was just slow to answer keeps its entry.
+    static func bindCached(_ service: Service, entry: CachedController, display: Display) {
+        mainAsync {
+            guard controllersForDisplay[display.serial] == nil, !unresponsiveCacheEntries.contains(entry.key) else { return }
+
+            controllersForDisplay[display.serial] = service
+            logFirstBind(display, source: "cache")
+            display.control = display.getBestControl()
+
+            guard !probedCacheEntries.contains(entry.key) else { return }
+            probedCacheEntries.insert(entry.key)
+
+            // `race` doesn't block, the probes run on the prober's own queue
+            service.prober.race(service.urls, timeout: 1.5) { url in
+                guard url == nil else { return }
+
+                log.info("Cached network controller \(entry.name) for \(display.name) didn't respond, waiting for Bonjour")
+                if timeSince(entry.resolvedAt) > entry.ttl / 2 {
+                    DiscoveryCache.shared.remove(entry)
+                }
+                mainAsync {
+                    unresponsiveCacheEntries.insert(entry.key)
+                    guard controllersForDisplay[display.serial] === service else { return }
+                    controllersForDisplay.removeValue(forKey: display.serial)
+                    display.control = display.getBestControl()
+                }
+            }
+        }
+    }
+
+    static func logFirstBind(_ display: Display, source: String) {
+        guard !firstBindLogged else { return }
+        firstBindLogged = true
+
+        log.info("First network controller bound for \(display.name) from \(source) after \((timeSince(discoveryStartedAt) * 1000).intround)ms")
+    }
+
     static func listenForDDCUtilControllers() {
         browser.serviceFoundHandler = { _ in
             log.info("Service found")
@@ -299,6 +374,7 @@ final class NetworkControl: Control {
             case let .success(netService):
                 log.info("Service resolved: \(netService)", context: netService.txtRecordDictionary)
                 log.debug("Service hostname: \(netService.hostName ?? "nil")")
+                DiscoveryCache.shared.record(netService)
                 matchTXTRecord(netService)
             case let .failure(error):
                 print(error)
@@ -308,6 +384,7 @@ final class NetworkControl: Control {
         browser.serviceRemovedHandler = { service in
             let displayService = controllersForDisplay.first(where: { _, displayService in
                 service == displayService.service
+                    || (displayService.fromCache && service.name == displayService.service.name && service.type == displayService.service.type)
             })
             if !DC.screensSleeping, !DC.locked,
                let serial = displayService?.key, let controller = displayService?.value,
@@ -326,13 +403,66 @@ final class NetworkControl: Control {
             }
         }
 
+        discoveryStartedAt = Date()
+        firstBindLogged = false
+        bindFromCache()
         browser.browse(type: ServiceType.tcp("ddcutil"))
     }
 
+    /// Runs `action` for every controller concurrently, so one slow controller doesn't delay the others
     static func sendToAllControllers(_ action: (URL) -> Void) {
         let urls = controllersForDisplay.values.compactMap { $0.url?.deletingLastPathComponent() }.uniqued()
-        for url in urls {
-            action(url)
+        DispatchQueue.concurrentPerform(iterations: urls.count) { i in
+            action(urls[i])
+        }
+    }
+
+    /// Sends instant VCP writes for many displays, grouped per controller so each one gets them in a single `POST /batch`,
+    /// with all controllers written in parallel.
+    ///
+    /// `completion` runs on a background queue with one response per write in input order, `nil` when the write failed,
+    /// was replaced by a newer value or its display has no controller. Controllers that reject `/batch` get the writes as single requests.
+    static func batch(
+        _ writes: [(display: Display, controlID: ControlID, value: UInt16)],
+        timeout: TimeInterval = 15,
+        completion: @escaping ([String?]) -> Void
+    ) {
+        guard !DC.screensSleeping, !DC.locked || DC.allowAdjustmentsWhileLocked, DDC.apply else {
+            completion(writes.map { _ in nil })
+            return
+        }
+
+        var groups: [String: (client: ControllerClient, indices: [Int], writes: [(key: String, url: URL, batch: BatchWrite?)])] = [:]
+        for (i, write) in writes.enumerated() {
+            guard let service = controllersForDisplay[write.display.serial], let url = service.url,
+                  let client = ControllerClient.shared(for: url)
+            else { continue }
+
+            let batchWrite = service.displayNumber.map { n in
+                BatchWrite(display: n, control: String(describing: write.controlID).lowercased(), value: write.value)
+            }
+            // same key as `set` so a batch and a single write for the same control coalesce
+            let item = (key: "\(write.display.serial):\(write.controlID)", url: url / write.controlID / write.value, batch: batchWrite)
+            groups[client.description, default: (client, [], [])].indices.append(i)
+            groups[client.description]?.writes.append(item)
+        }
+
+        let lock = NSRecursiveLock()
+        var responses = [String?](repeating: nil, count: writes.count)
+        let group = DispatchGroup()
+        for (client, indices, items) in groups.values {
+            group.enter()
+            client.enqueue(items, timeout: timeout) { itemResponses in
+                lock.around {
+                    for (i, response) in zip(indices, itemResponses) {
+                        responses[i] = response
+                    }
+                }
+                group.leave()
+            }
+        }
+        group.notify(queue: .global(qos: .userInitiated)) {
+            completion(lock.around { responses })
         }
     }
 
@@ -357,6 +487,7 @@ final class NetworkControl: Control {
             for display in DC.activeDisplays.values {
                 display.lastConnectionTime = Date()
             }
+            TransitionSession.removeAll()
             browser.reset()
             browser.delegate.onStop = {
                 browser.browse(type: ServiceType.tcp("ddcutil"))
@@ -389,31 +520,6 @@ final class NetworkControl: Control {
     }
 
     func listenForRequests() {
-        for item in requestsPublishers.values {
-            item.removeDuplicates()
-                .throttle(for: .milliseconds(500), scheduler: RunLoop.main, latest: true)
-                .sink { [weak self] request in
-                    guard let self, !DC.screensSleeping, !DC.locked || DC.allowAdjustmentsWhileLocked else { return }
-
-                    serviceBrowserQueue.async { [weak self] in
-                        guard let self else { return }
-                        defer {
-                            self.manageSendingState(for: request.controlID, sending: false)
-                        }
-
-                        guard let resp = waitForResponse(from: request.url, timeoutPerTry: request.timeout) else {
-                            guard let display = self.display else { return }
-                            log.error(
-                                "Error sending \(request.controlID)=\(request.value) to \(request.url) for display \(display)"
-                            )
-                            return
-                        }
-                        guard let display else { return }
-                        log.debug("Sent \(request.controlID)=\(request.value), received response `\(resp)` for display \(display)")
-                    }
-                }.store(in: &observers)
-        }
-
         responsiveCheckPublisher
             .debounce(for: .milliseconds(500), scheduler: RunLoop.main)
             .sink { [weak self] _ in
@@ -431,6 +537,7 @@ final class NetworkControl: Control {
                               retries: 1
                           )
                     else {
+                        NetworkControl.controllersForDisplay[display.serial]?.reprobe()
                         mainAsync {
                             self.responsiveTryCount += 1
                             if self.responsiveTryCount > 10 {
@@ -440,6 +547,7 @@ final class NetworkControl: Control {
                         }
                         return
                     }
+                    service.prober.cancelReprobe()
                     if newURL != url {
                         service.url = newURL
                         service.smoothTransitionUrl = service.getFirstRespondingURL(
@@ -468,15 +576,83 @@ final class NetworkControl: Control {
             return false
         }
 
-        manageSendingState(for: controlID, sending: true)
+        // nothing is sent while the screens sleep or the session is locked, but the control is still usable
+        guard !DC.screensSleeping, !DC.locked || DC.allowAdjustmentsWhileLocked else { return true }
 
         let fullUrl: URL = if smooth {
             url / controlID / oldValue! / value
         } else {
             url / controlID / value
         }
+        guard let client = ControllerClient.shared(for: fullUrl) else { return false }
+
+        // instant writes queued for several displays or controls behind the same controller go out in one `/batch` round-trip
+        let control = String(describing: controlID).lowercased()
+        let batchWrite = smooth ? nil : service.displayNumber.map { n in
+            BatchWrite(display: n, control: control, value: value)
+        }
+        let send = { (done: (() -> Void)?) in
+            let sentAt = DispatchTime.now()
+            client.enqueue(
+                key: "\(display.serial):\(controlID)", url: fullUrl, timeout: smooth ? 60 : 15, batch: batchWrite
+            ) { [weak self] resp in
+                guard let self else { return }
+                defer {
+                    self.manageSendingState(for: controlID, sending: false)
+                    done?()
+                }
 
-        requestsPublishers[controlID]?.send(Request(url: fullUrl, controlID: controlID, timeout: smooth ? 60.seconds : 15.seconds, value: value))
+                guard let display = self.display else { return }
+                guard let resp else {
+                    log.error("Error sending \(controlID)=\(value) to \(fullUrl) for display \(display)")
+                    return
+                }
+                log.debug("Sent \(controlID)=\(value), received response `\(resp)` for display \(display)")
+                // `/smooth` is answered when the transition is done, only instant writes are write latency
+                if !smooth {
+                    HealthMetrics.shared.display(display.id).networkWrite.observe(ns: DispatchTime.now().rawValue - sentAt.rawValue)
+                }
+            }
+        }
+
+        let transitionDone = { [weak self] in
+            guard let self else { return }
+            self.onTransitionDone?(controlID)
+        }
+
+        manageSendingState(for: controlID, sending: true)
+        guard let displayNumber = service.displayNumber, let session = TransitionSession.shared(for: client) else {
+            // the `/smooth` request is answered when the controller finished the transition
+            send(smooth ? transitionDone : nil)
+            return true
+        }
+
+        guard smooth, let oldValue else {
+            // an instant write must not be overridden by the rest of a running interpolation,
+            // so it's only queued after the controller stopped it
+            if session.supported == true {
+                session.cancel(display: displayNumber, control: control) { send(nil) }
+            } else {
+                send(nil)
+            }
+            return true
+        }
+
+        // the controller interpolates on its own clock at about 10ms per step, and streams back what it applied
+        let duration = cap(abs(value.i - oldValue.i).d * 0.01, minVal: 0.2, maxVal: 1.0)
+        session.start(
+            display: displayNumber, control: control, from: oldValue, to: value, duration: duration,
+            onProgress: { [weak self] applied, done in
+                #if DEBUG
+                    log.verbose("Controller applied \(controlID)=\(applied) (target \(value)) for display \(display)")
+                #endif
+                if done {
+                    self?.manageSendingState(for: controlID, sending: false)
+                    transitionDone()
+                }
+            },
+            fallback: { send(transitionDone) }
+        )
 
         return true
     }
@@ -496,7 +672,12 @@ final class NetworkControl: Control {
         }
 
         var value: UInt16?
-        guard let resp = waitForResponse(from: url / controlID, timeoutPerTry: 1500.milliseconds) else {
+        let resp = if let client = ControllerClient.shared(for: url) {
+            client.get(url / controlID, timeout: 1.5)
+        } else {
+            waitForResponse(from: url / controlID, timeoutPerTry: 1500.milliseconds)
+        }
+        guard let resp else {
             log.error("Error reading \(controlID) for \(display)")
             return nil
         }
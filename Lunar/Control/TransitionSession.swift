@@ -0,0 +1,376 @@
+//
+//  TransitionSession.swift
+//  Lunar
+//
+//  Created by Alin Panaitiu on 19.10.2026.
+//  Copyright © 2026 Alin. All rights reserved.
+//
+
+import Foundation
+
+// MARK: - TransitionCommand
+
+/// Interpolation request for the controller: it moves `control` from `from` to `target` over `duration_ms` on its own clock.
+///
+/// Sending a command with the id of a running transition retargets it from the value the controller applied last.
+struct TransitionCommand: Codable, Equatable {
+    enum Curve: String, Codable {
+        case linear
+        case easeOut = "ease-out"
+        case easeInOut = "ease-in-out"
+    }
+
+    enum CodingKeys: String, CodingKey {
+        case id
+        case display
+        case control
+        case from
+        case target
+        case durationMs = "duration_ms"
+        case curve
+    }
+
+    let id: UInt64
+    let display: Int
+    let control: String
+    let from: UInt16?
+    let target: UInt16
+    let durationMs: Int
+    let curve: Curve
+}
+
+// MARK: - TransitionSession
+
+/// Streaming smooth transitions with one network controller.
+///
+/// Commands are posted to `/transition` on the controller's keep-alive connection. Transitions started in the
+/// same run loop turn go out in one request, so the controller starts them on the same tick and monitors stay in step.
+///
+/// Wire protocol, all bodies are JSON:
+///
+///     POST /transition          {"transitions": [TransitionCommand]}   -> 2xx, body ignored
+///     POST /transition/cancel   {"ids": [12]}                          -> 2xx, body ignored
+///     GET  /transition/events   text/event-stream of `applied` events, kept open
+///
+///     event: applied
+///     data: {"id":12,"value":40,"done":false}
+///
+/// - A command with a new `id` starts interpolating from `from` (or the current VCP value when it's missing).
+/// - A command with the `id` of a running transition retargets it: `from` is omitted and the controller
+///   continues from the value it applied last, towards the new `target` over the new `duration_ms`.
+/// - Cancelled ids stop where they are without a final event, the last applied value stays on the monitor.
+/// - The controller sends `applied` at its own pace while interpolating, and one with `"done":true`
+///   and the final value when a transition ends. Events for unknown ids are ignored.
+/// - A transition that got no `done` event `ackGrace` seconds after its duration is considered finished
+///   at the last acknowledged value, so a dropped event stream can't leave the control busy.
+/// - The event stream is reconnected with exponential backoff while transitions are running.
+///
+/// Controllers that answer `/transition` with 404/405/501 are marked unsupported and every queued transition
+/// runs its `fallback` instead (the old `/smooth/<n>/<control>/<from>/<to>` request). Any other failed request
+/// (network error, timeout, 5xx) runs the `fallback` of the transitions it carried.
+final class TransitionSession: NSObject, URLSessionDataDelegate {
+    init(client: ControllerClient, base: URL, ackGrace: TimeInterval = TransitionSession.ACK_GRACE) {
+        self.client = client
+        self.base = base
+        self.ackGrace = ackGrace
+        queue = DispatchQueue(label: "fyi.lunar.transition.\(client.description).queue", qos: .userInitiated)
+        super.init()
+    }
+
+    deinit {
+        streamSession?.invalidateAndCancel()
+    }
+
+    typealias Progress = (_ value: UInt16, _ done: Bool) -> Void
+
+    static let MIN_BACKOFF: TimeInterval = 0.5
+    static let MAX_BACKOFF: TimeInterval = 30
+
+    /// Extra time past the duration before a transition without a `done` acknowledgment is considered finished
+    static let ACK_GRACE: TimeInterval = 5
+
+    static let APPLIED_EVENT = Array("applied".utf8)
+    static let ID_KEY = Array("\"id\":".utf8)
+    static let VALUE_KEY = Array("\"value\":".utf8)
+    static let DONE_TRUE = Array("\"done\":true".utf8)
+
+    let client: ControllerClient
+    let base: URL
+    let ackGrace: TimeInterval
+
+    /// `nil` until the controller answered a transition request
+    var supported: Bool? {
+        queue.sync { support }
+    }
+
+    /// Last value the controller acknowledged for each running transition, keyed by `<display>:<control>`
+    var applied: [String: UInt16] {
+        queue.sync { active.compactMapValues(\.applied) }
+    }
+
+    static func shared(for client: ControllerClient) -> TransitionSession? {
+        guard let base = client.base else { return nil }
+
+        return sessionsLock.around {
+            if let session = sessions[client.description] {
+                return session
+            }
+            let session = TransitionSession(client: client, base: base)
+            sessions[client.description] = session
+            return session
+        }
+    }
+
+    static func removeAll() {
+        sessionsLock.around {
+            sessions.values.forEach { $0.stop() }
+            sessions.removeAll()
+        }
+    }
+
+    /// Starts a transition, or retargets the one already running for the same display and control
+    func start(
+        display: Int,
+        control: String,
+        from: UInt16?,
+        to target: UInt16,
+        duration: TimeInterval,
+        curve: TransitionCommand.Curve = .easeOut,
+        onProgress: @escaping Progress,
+        fallback: @escaping () -> Void
+    ) {
+        queue.async { [self] in
+            guard support != false else {
+                fallback()
+                return
+            }
+
+            let key = "\(display):\(control)"
+            let id = active[key]?.command.id ?? nextID()
+            let command = TransitionCommand(
+                id: id, display: display, control: control,
+                from: active[key] == nil ? from : nil,
+                target: target, durationMs: Int(duration * 1000), curve: curve
+            )
+            var transition = active[key] ?? Transition(command: command, onProgress: onProgress, fallback: fallback)
+            transition.command = command
+            transition.onProgress = onProgress
+            transition.fallback = fallback
+            transition.deadline = Date().addingTimeInterval(duration + ackGrace)
+            active[key] = transition
+
+            outbox.removeAll { $0.id == id }
+            outbox.append(command)
+            connect()
+            scheduleFlush()
+            scheduleExpiry()
+        }
+    }
+
+    /// Stops the transition where it is, the controller keeps the last applied value.
+    ///
+    /// `completion` runs on the session queue once the controller answered the cancel request
+    /// (or right away when nothing was running), so a write sent from it can't be overtaken by the interpolation.
+    func cancel(display: Int, control: String, completion: (() -> Void)? = nil) {
+        queue.async { [self] in
+            let key = "\(display):\(control)"
+            guard let transition = active.removeValue(forKey: key) else {
+                completion?()
+                return
+            }
+
+            outbox.removeAll { $0.id == transition.command.id }
+            let body = (try? JSONEncoder().encode(["ids": [transition.command.id]])) ?? Data()
+            client.post(base / "transition" / "cancel", json: body, timeout: 5) { [weak self] _, _ in
+                self?.queue.async { completion?() }
+            }
+        }
+    }
+
+    func stop() {
+        queue.async { [self] in
+            stopped = true
+            reconnectTask?.cancel()
+            reconnectTask = nil
+            streamTask?.cancel()
+            streamTask = nil
+            streamSession?.invalidateAndCancel()
+            streamSession = nil
+        }
+    }
+
+    func urlSession(_: URLSession, dataTask _: URLSessionDataTask, didReceive response: URLResponse, completionHandler: @escaping (URLSession.ResponseDisposition) -> Void) {
+        guard let response = response as? HTTPURLResponse, response.statusCode == 200 else {
+            completionHandler(.cancel)
+            return
+        }
+        attempt = 0
+        completionHandler(.allow)
+    }
+
+    func urlSession(_: URLSession, dataTask _: URLSessionDataTask, didReceive data: Data) {
+        parser.feed(data) { event, payload in
+            guard event == Self.APPLIED_EVENT,
+                  let id = SSEParser.number(for: Self.ID_KEY, in: payload),
+                  let value = SSEParser.number(for: Self.VALUE_KEY, in: payload), value.isFinite, value >= 0
+            else { return }
+
+            acknowledge(id: UInt64(id), value: UInt16(min(value, UInt16.max.d)), done: SSEParser.find(Self.DONE_TRUE, in: payload) != nil)
+        }
+    }
+
+    func urlSession(_: URLSession, task _: URLSessionTask, didCompleteWithError _: Error?) {
+        streamTask = nil
+        guard !stopped, support != false, !active.isEmpty else { return }
+
+        let delay = min(Self.MAX_BACKOFF, Self.MIN_BACKOFF * pow(2, attempt.d))
+        attempt = min(attempt + 1, 16)
+
+        let task = DispatchWorkItem(name: "TransitionSession.reconnect") { [weak self] in self?.connect() }
+        reconnectTask = task
+        queue.asyncAfter(deadline: .now() + Double.random(in: delay / 2 ... delay), execute: task.workItem)
+    }
+
+    private struct Transition {
+        var command: TransitionCommand
+        var onProgress: Progress
+        var fallback: () -> Void
+        var applied: UInt16?
+        var deadline = Date()
+    }
+
+    private static var sessions: [String: TransitionSession] = [:]
+    private static let sessionsLock = NSRecursiveLock()
+
+    private let queue: DispatchQueue
+
+    private var support: Bool?
+    private var active: [String: Transition] = [:]
+    private var outbox: [TransitionCommand] = []
+    private var flushScheduled = false
+    private var expiryTask: DispatchWorkItem?
+    private var lastID: UInt64 = 0
+
+    private var parser = SSEParser()
+    private var streamSession: URLSession?
+    private var streamTask: URLSessionDataTask?
+    private var reconnectTask: DispatchWorkItem?
+    private var stopped = false
+    private var attempt = 0
+
+    private func nextID() -> UInt64 {
+        lastID += 1
+        return lastID
+    }
+
+    /// Opens the acknowledgment stream if it isn't already, all delegate callbacks run on `queue`
+    private func connect() {
+        guard streamTask == nil, support != false else { return }
+
+        stopped = false
+        parser.reset()
+        if streamSession == nil {
+            let config = URLSessionConfiguration.ephemeral
+            config.timeoutIntervalForRequest = 60
+            config.timeoutIntervalForResource = .infinity
+            config.httpMaximumConnectionsPerHost = 1
+
+            let delegateQueue = OperationQueue()
+            delegateQueue.underlyingQueue = queue
+            delegateQueue.maxConcurrentOperationCount = 1
+            streamSession = URLSession(configuration: config, delegate: self, delegateQueue: delegateQueue)
+        }
+
+        var request = URLRequest(url: base / "transition" / "events")
+        request.setValue("text/event-stream", forHTTPHeaderField: "Accept")
+        request.setValue("no-cache", forHTTPHeaderField: "Cache-Control")
+        streamTask = streamSession?.dataTask(with: request)
+        streamTask?.resume()
+    }
+
+    private func scheduleFlush() {
+        guard !flushScheduled else { return }
+        flushScheduled = true
+        queue.async { [self] in flush() }
+    }
+
+    private func flush() {
+        flushScheduled = false
+        guard !outbox.isEmpty else { return }
+
+        let commands = outbox
+        outbox = []
+
+        let body = (try? JSONEncoder().encode(["transitions": commands])) ?? Data()
+        client.post(base / "transition", json: body, timeout: 5) { [weak self] status, _ in
+            guard let self else { return }
+
+            queue.async {
+                switch status {
+                case .some(404), .some(405), .some(501):
+                    self.markUnsupported()
+                case let .some(status) where (200 ..< 300).contains(status):
+                    self.support = true
+                default:
+                    log.warning("Transition request to \(self.base) failed with status \(status.map { String($0) } ?? "none")")
+                    self.fallBack(commands)
+                }
+            }
+        }
+    }
+
+    private func markUnsupported() {
+        support = false
+        stop()
+
+        let transitions = active.values
+        active.removeAll()
+        outbox.removeAll()
+        for transition in transitions {
+            transition.fallback()
+        }
+    }
+
+    /// Nothing was written for these transitions, so they go out as the old `/smooth` requests instead.
+    /// A transition retargeted since then is left to the request carrying its newer command.
+    private func fallBack(_ commands: [TransitionCommand]) {
+        for (key, transition) in active where commands.contains(transition.command) {
+            active.removeValue(forKey: key)
+            transition.fallback()
+        }
+    }
+
+    private func acknowledge(id: UInt64, value: UInt16, done: Bool) {
+        guard let entry = active.first(where: { $0.value.command.id == id }) else { return }
+
+        if done {
+            active.removeValue(forKey: entry.key)
+        } else {
+            active[entry.key]?.applied = value
+        }
+        entry.value.onProgress(value, done)
+    }
+
+    private func finish(ids: Set<UInt64>) {
+        for (key, transition) in active where ids.contains(transition.command.id) {
+            active.removeValue(forKey: key)
+            transition.onProgress(transition.applied ?? transition.command.target, true)
+        }
+    }
+
+    /// Ends transitions whose `done` acknowledgment never came, so the sending state doesn't get stuck
+    private func scheduleExpiry() {
+        expiryTask?.cancel()
+        guard let deadline = active.values.map(\.deadline).min() else { return }
+
+        let task = DispatchWorkItem(name: "TransitionSession.expiry") { [weak self] in
+            guard let self else { return }
+
+            let now = Date()
+            finish(ids: Set(active.values.filter { $0.deadline <= now }.map(\.command.id)))
+            scheduleExpiry()
+        }
+        expiryTask = task
+        queue.asyncAfter(deadline: .now() + max(deadline.timeIntervalSinceNow, 0), execute: task.workItem)
+    }
+}
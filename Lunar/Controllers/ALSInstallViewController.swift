@@ -53,7 +53,7 @@ final class ALSInstallViewController: NSViewController {
 
     @objc dynamic var operationTitle = "Ambient Light Sensor"
     @objc dynamic var operationDescription: NSAttributedString =
-        "Your WiFi credentials will be programmed into the sensor firmware so it can connect to your local network and send lux values when requested."
+        "Your WiFi credentials will be programmed into the sensor firmware so it can connect to your local network and send lux values when they change."
             .attributedString
     @IBOutlet var progressBar: NSProgressIndicator!
     @IBOutlet var installButton: PaddedButton!
@@ -73,6 +73,26 @@ final class ALSInstallViewController: NSViewController {
     @objc dynamic var sda = "GPIO4"
     @objc dynamic var scl = "GPIO5"
 
+    /// Number of readings in the on-device median filter
+    @objc dynamic var filterWindow = CachedDefaults[.sensorFilterWindow] {
+        didSet { CachedDefaults[.sensorFilterWindow] = filterWindow }
+    }
+
+    /// Minimum change in perceived brightness (as a percentage of the last published lux) before the sensor publishes
+    @objc dynamic var deltaPercent = CachedDefaults[.sensorDeltaPercent] {
+        didSet { CachedDefaults[.sensorDeltaPercent] = deltaPercent }
+    }
+
+    /// The sensor publishes at least this often even if nothing changed, so Lunar knows it's still alive
+    @objc dynamic var heartbeatSeconds = CachedDefaults[.sensorHeartbeatSeconds] {
+        didSet { CachedDefaults[.sensorHeartbeatSeconds] = heartbeatSeconds }
+    }
+
+    /// `deltaPercent` as a log10 lux difference, which is what the firmware compares against
+    var deltaThreshold: Double {
+        log10(1 + cap(deltaPercent, minVal: 0, maxVal: 1000) / 100)
+    }
+
     @objc dynamic var board: String = SELECT_BOARD_ITEM {
         didSet {
             setInstallButtonEnabled()
@@ -186,7 +206,7 @@ final class ALSInstallViewController: NSViewController {
         installButton?.frame = NSRect(origin: installButton.frame.origin, size: CGSize(width: installButton.frame.width, height: 30))
         installButton?.attributedTitle = "Start".withAttribute(.textColor(mauve))
         operationDescription =
-            "Your WiFi credentials will be programmed into the sensor firmware so it can connect to your local network and send lux values when requested."
+            "Your WiFi credentials will be programmed into the sensor firmware so it can connect to your local network and send lux values when they change."
                 .attributedString
     }
 
@@ -271,6 +291,9 @@ final class ALSInstallViewController: NSViewController {
                       "SENSOR": sensor.lowercased(),
                       "SDA": sda,
                       "SCL": scl,
+                      "FILTER_WINDOW": "\(cap(filterWindow, minVal: 1, maxVal: 60))",
+                      "DELTA_THRESHOLD": deltaThreshold.str(decimals: 4),
+                      "HEARTBEAT_MS": "\(cap(heartbeatSeconds, minVal: 1, maxVal: 3600) * 1000)",
                   ]
               )
         else {
@@ -1237,110 +1237,39 @@ final class DisplayViewController: NSViewController {
             return
         }
 
-        let brColor = darkMode ? white.withAlphaComponent(0.5) : violet
-        var gradient: CGGradient?
+        // the curves don't depend on the current value, nothing to redraw
+        let onlyCurrentValue = (currentBrightness != nil || currentContrast != nil) &&
+            minBrightness == nil && maxBrightness == nil && minContrast == nil && maxContrast == nil &&
+            userBrightness == nil && userContrast == nil
+        guard force || !onlyCurrentValue else { return }
 
         switch DC.adaptiveMode {
-        case let mode as LocationMode:
-            guard let moment = mode.moment else { return }
-
-            let xs = stride(from: moment.astronomicalSunrise, to: moment.astronomicalSunset, by: 40)
-            let brcrs = xs.map { datetime in
-                mode.getBrightnessContrast(
-                    display: display,
-                    hour: datetime.hour,
-                    minute: datetime.minute,
-                    minBrightness: minBrightness?.u8, minContrast: minContrast?.u8
-                )
-            }
-
-            for (entry, y) in zip(brightnessChartEntry, brcrs.map(\.0)) {
-                entry.y = y
-            }
-            for (entry, y) in zip(contrastChartEntry, brcrs.map(\.1)) {
-                entry.y = y
-            }
-            gradient = BrightnessContrastChartView.brightnessGradient(values: brcrs.map(\.0), mode: .location)
-        case let mode as SyncMode:
-//            if mode.isSyncingNits {
-//                let brcrs = brightnessChartEntry.map { entry in
-//                    mode.computeBrightnessContrast(
-//                        nits: entry.x,
-//                        display: display,
-//                        minBrightness: minBrightness,
-//                        maxBrightness: maxBrightness,
-//                        minContrast: minContrast,
-//                        maxContrast: maxContrast,
-//                        nitsMapping: nitsMapping,
-//                        spline: spline
-//                    )
-//                }
-//                for (entry, y) in zip(brightnessChartEntry, brcrs.map(\.0)) {
-//                    entry.y = y
-//                }
-//                for (entry, y) in zip(contrastChartEntry, brcrs.map(\.1)) {
-//                    entry.y = y
-//                }
-//            } else {
-            let brs = brightnessChartEntry.map { entry in
-                mode.interpolate(
-                    entry.x,
-                    display: display,
-                    minVal: minBrightness?.d,
-                    maxVal: maxBrightness?.d
-                )
-            }
-
-            for (entry, y) in zip(brightnessChartEntry, brs) {
-                entry.y = y
-            }
-
-            let crs = contrastChartEntry.map { entry in
-                mode.interpolate(
-                    entry.x,
-                    display: display,
-                    minVal: minContrast?.d,
-                    maxVal: maxContrast?.d,
-                    contrast: true
-                )
-            }
-            for (entry, y) in zip(contrastChartEntry, crs) {
-                entry.y = y
-            }
-            gradient = BrightnessContrastChartView.brightnessGradient(values: brs, mode: .sync)
-        case let mode as SensorMode:
-            let brcrs = brightnessChartEntry.map { entry in
-                mode.computeBrightnessContrast(ambientLight: entry.x, display: display)
-            }
-
-            for (entry, y) in zip(brightnessChartEntry, brcrs) {
-                entry.y = y.0
-            }
-            for (entry, y) in zip(contrastChartEntry, brcrs) {
-                entry.y = y.1
-            }
-            gradient = BrightnessContrastChartView.brightnessGradient(values: brcrs.map(\.0), mode: .sensor)
         case is ManualMode:
             brightnessChartEntry[0].y = minBrightness?.d ?? display.minBrightness.doubleValue
             brightnessChartEntry[1].y = maxBrightness?.d ?? display.maxBrightness.doubleValue
             contrastChartEntry[0].y = minContrast?.d ?? display.minContrast.doubleValue
             contrastChartEntry[1].y = maxContrast?.d ?? display.maxContrast.doubleValue
-        default:
-            break
-        }
+            mainAsync { [weak self] in
+                self?.brightnessContrastChart?.notifyDataSetChanged()
+            }
+        case let mode as LocationMode where mode.moment == nil:
+            return
+        case let mode:
+            let provider = brightnessContrastChart.dataProvider
+            let width = brightnessContrastChart.bounds.width
+            let apply: (ChartOutput) -> Void = { [weak self] output in
+                self?.brightnessContrastChart?.apply(output)
+            }
 
-//        brightnessContrastChart.highlightCurrentValues(
-//            adaptiveMode: DC.adaptiveMode, for: display,
-//            brightness: currentBrightness?.d, contrast: currentContrast?.d
-//        )
-        mainAsync { [weak self] in
-            if let gradient {
-                self?.brightnessContrastChart?.brightnessGraph.fill = LinearGradientFill(gradient: gradient)
+            let overrides = ChartValueOverrides(
+                minBrightness: minBrightness, maxBrightness: maxBrightness,
+                minContrast: minContrast, maxContrast: maxContrast
+            )
+            if userBrightness != nil || userContrast != nil, minBrightness == nil, maxBrightness == nil, minContrast == nil, maxContrast == nil {
+                provider.update(display: display, mode: mode, width: width, userBrightness: userBrightness, userContrast: userContrast, completion: apply)
             } else {
-                self?.brightnessContrastChart?.brightnessGraph.fill = nil
-                self?.brightnessContrastChart?.brightnessGraph.fillColor = brColor
+                provider.rebuild(display: display, mode: mode, width: width, overrides: overrides, completion: apply)
             }
-            self?.brightnessContrastChart?.notifyDataSetChanged()
         }
     }
 
@@ -29,6 +29,7 @@ let DDCUTIL_SERVER_INSTALLER_DIR = "/tmp/ddcutil-server"
     @IBOutlet var connectingIndicator: NSProgressIndicator!
     var onInstall: ((SSH) -> Void)?
     var commandChannel: Channel?
+    var sshLease: SSHPool.Lease?
     var cancelled = true
 
     @objc dynamic var sshKeySelected = false {
@@ -166,17 +167,17 @@ let DDCUTIL_SERVER_INSTALLER_DIR = "/tmp/ddcutil-server"
             }
 
             do {
-                let ssh = try SSH(host: hostname, port: port)
-                guard !cancelled else { return }
-
                 mainThread {
                     self.connectionMessage = "Authenticating user '\(username)' with \(self.sshKeySelected ? "private key" : "password")"
                 }
-                if sshKeySelected {
-                    try ssh.authenticate(username: username, privateKey: sshKeyPath, passphrase: passphrase)
-                } else {
-                    try ssh.authenticate(username: username, password: password)
-                }
+                let authMethod: SSHAuthMethod = sshKeySelected
+                    ? SSHKey(privateKey: sshKeyPath, passphrase: passphrase)
+                    : SSHPassword(password)
+
+                // retries and the installer commands reuse the same authenticated session
+                let lease = try SSHPool.shared.lease(host: hostname, port: port, username: username, authMethod: authMethod)
+                let ssh = lease.ssh
+                mainThread { self.sshLease = lease }
 
                 guard !cancelled else { return }
 
@@ -1214,30 +1214,39 @@ enum DDC {
 
             if writeNs > 0 {
                 DC.averageDDCWriteNanoseconds(for: displayID, ns: writeNs)
+                HealthMetrics.shared.display(displayID).ddcWrite.observe(ns: writeNs)
             }
             if let display = DC.displays[displayID], !display.responsiveDDC {
                 display.responsiveDDC = true
             }
 
-            if let propertyFaults = DDC.writeFaults[displayID], let faults = propertyFaults[controlID] {
-                DDC.writeFaults[displayID]![controlID] = max(faults - 1, 0)
+            DDC.writeFaults[displayID]?.update(key: controlID) { faults in
+                faults = faults.map { max($0 - 1, 0) }
             }
 
             return result
         }
     }
 
-    static func readFault(severity: Int, displayID: CGDirectDisplayID, controlID: ControlID) {
-        guard let propertyFaults = DDC.readFaults[displayID] else {
-            DDC.readFaults[displayID] = ThreadSafeDictionary(dict: [controlID: severity])
-            return
+    /// Fault counters of one display, created on the first fault
+    static func propertyFaults(
+        _ faults: ThreadSafeDictionary<CGDirectDisplayID, ThreadSafeDictionary<ControlID, Int>>,
+        _ displayID: CGDirectDisplayID
+    ) -> ThreadSafeDictionary<ControlID, Int> {
+        faults.update(key: displayID) { propertyFaults in
+            if propertyFaults == nil {
+                propertyFaults = ThreadSafeDictionary()
+            }
+            return propertyFaults!
         }
-        guard var faults = propertyFaults[controlID] else {
-            DDC.readFaults[displayID]![controlID] = severity
-            return
+    }
+
+    static func readFault(severity: Int, displayID: CGDirectDisplayID, controlID: ControlID) {
+        HealthMetrics.shared.display(displayID).ddcReadFaults.increment()
+        let faults = propertyFaults(DDC.readFaults, displayID).update(key: controlID) { value in
+            value = value.map { min(severity + $0, MAX_READ_FAULTS + 1) } ?? severity
+            return value!
         }
-        faults = min(severity + faults, MAX_READ_FAULTS + 1)
-        DDC.readFaults[displayID]![controlID] = faults
 
         if faults > MAX_READ_FAULTS {
             DDC.skipReadingProperty(displayID: displayID, controlID: controlID)
@@ -1245,16 +1254,11 @@ enum DDC {
     }
 
     static func writeFault(severity: Int, displayID: CGDirectDisplayID, controlID: ControlID) {
-        guard let propertyFaults = DDC.writeFaults[displayID] else {
-            DDC.writeFaults[displayID] = ThreadSafeDictionary(dict: [controlID: severity])
-            return
-        }
-        guard var faults = propertyFaults[controlID] else {
-            DDC.writeFaults[displayID]![controlID] = severity
-            return
+        HealthMetrics.shared.display(displayID).ddcWriteFaults.increment()
+        let faults = propertyFaults(DDC.writeFaults, displayID).update(key: controlID) { value in
+            value = value.map { min(severity + $0, MAX_WRITE_FAULTS + 1) } ?? severity
+            return value!
         }
-        faults = min(severity + faults, MAX_WRITE_FAULTS + 1)
-        DDC.writeFaults[displayID]![controlID] = faults
 
         if faults > MAX_WRITE_FAULTS {
             DDC.skipWritingProperty(displayID: displayID, controlID: controlID)
@@ -1334,13 +1338,14 @@ enum DDC {
 
             if readNs > 0 {
                 DC.averageDDCReadNanoseconds(for: displayID, ns: readNs)
+                HealthMetrics.shared.display(displayID).ddcRead.observe(ns: readNs)
             }
             if let display = DC.displays[displayID], !display.responsiveDDC {
                 display.responsiveDDC = true
             }
 
-            if let propertyFaults = DDC.readFaults[displayID], let faults = propertyFaults[controlID] {
-                DDC.readFaults[displayID]![controlID] = max(faults - 1, 0)
+            DDC.readFaults[displayID]?.update(key: controlID) { faults in
+                faults = faults.map { max($0 - 1, 0) }
             }
 
             return DDCReadResult(
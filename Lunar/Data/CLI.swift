@@ -226,6 +226,29 @@ enum DisplayFilter: ExpressibleByArgument, Codable, Equatable, CaseIterable {
     }
 }
 
+// MARK: - DisplayFields
+
+/// Comma separated list of display properties, e.g. `brightness,contrast,serial`
+struct DisplayFields: ExpressibleByArgument {
+    init?(argument: String) {
+        var keys: [Display.CodingKeys] = []
+        for field in argument.split(separator: ",").map(\.s.trimmed) where !field.isEmpty {
+            guard let key = Display.CodingKeys(rawValue: field) else { return nil }
+            // `mute` is only an alias, the display encodes it as `audioMuted`
+            let encodedKey = key == .mute ? Display.CodingKeys.audioMuted : key
+            if !keys.contains(encodedKey) {
+                keys.append(encodedKey)
+            }
+        }
+        guard !keys.isEmpty else { return nil }
+        self.keys = keys
+    }
+
+    let keys: [Display.CodingKeys]
+
+    var names: [String] { keys.map(\.rawValue) }
+}
+
 // MARK: - NSDeviceDescriptionKey + Encodable
 
 extension NSDeviceDescriptionKey: @retroactive Encodable {
@@ -400,6 +423,118 @@ struct Lunar: ParsableCommand {
         }
     }
 
+    struct Batch: ParsableCommand {
+        static let configuration = CommandConfiguration(
+            abstract: "Runs commands read from stdin, one per line, over a single connection to the running Lunar app.",
+            discussion: """
+            Commands are written without waiting for the previous one to finish, and their output is printed in order.
+            Empty lines and lines starting with `#` are skipped, arguments can be grouped with quotes.
+            The exit code is the one of the first command that failed.
+
+            \("EXAMPLE".bold()):
+                \("lunar batch < script.txt".yellow().bold())
+
+            where \("script.txt".bold()) contains:
+                displays dell brightness 60
+                displays dell contrast 40
+                displays lg input hdmi1
+
+            With \("--bench N".bold()) the script is sent N times and only latency and throughput are printed.
+            Latency is measured from writing a command to reading its answer, so it includes the time spent behind earlier commands.
+            """
+        )
+
+        @OptionGroup(visibility: .hidden) var globals: GlobalOptions
+
+        @Option(name: .long, help: "Send the script this many times and print latency and throughput instead of the command output.")
+        var bench = 0
+
+        @Flag(name: .long, help: "Print the benchmark results as JSON.")
+        var json = false
+
+        static func commands() -> [[String]] {
+            var commands: [[String]] = []
+            while let line = readLine(strippingNewline: true) {
+                let args = CLISession.arguments(line)
+                if !args.isEmpty {
+                    commands.append(args)
+                }
+            }
+            return commands
+        }
+
+        func run() throws {
+            guard !isServer else {
+                throw LunarCommandError.noServer
+            }
+
+            let script = Self.commands()
+            guard !script.isEmpty else { return cliExit(0) }
+
+            let benchmarking = bench > 0
+            let commands = benchmarking ? Array([[[String]]](repeating: script, count: bench).joined()) : script
+            let client = try CLISessionClient(host: globals.host, key: globals.key.isEmpty ? CachedDefaults[.apiKey] : globals.key)
+
+            // only written by the sending thread before the command goes out, read after its answer arrives
+            let sentAtLock = NSRecursiveLock()
+            var sentAt = [UInt64](repeating: 0, count: benchmarking ? commands.count : 0)
+
+            // keep writing while the answers are read, so neither side waits on a full socket buffer
+            DispatchQueue.global(qos: .userInitiated).async {
+                do {
+                    for (id, args) in commands.enumerated() {
+                        if benchmarking {
+                            sentAtLock.around { sentAt[id] = DispatchTime.now().rawValue }
+                        }
+                        try client.send(id: id, args: args)
+                    }
+                } catch {
+                    log.error("CLI: Error sending batch commands: \(error)")
+                    client.close()
+                }
+            }
+
+            var latency = LatencyStats(capacity: commands.count)
+            let started = DispatchTime.now()
+            var exitCode: Int32 = 0
+            for id in commands.indices {
+                guard let response = try client.nextResponse() else {
+                    throw CLISessionError.connectionClosed
+                }
+                guard response.id == id else {
+                    throw CLISessionError.invalidResponse("expected response \(id), got \(response.id)")
+                }
+
+                guard benchmarking else {
+                    cliPrint(response.output, terminator: "")
+                    if exitCode == 0 {
+                        exitCode = response.exitCode
+                    }
+                    continue
+                }
+
+                if response.exitCode == 0 {
+                    let sent = sentAtLock.around { sentAt[id] }
+                    latency.record((DispatchTime.now().rawValue - sent).d / 1_000_000)
+                } else {
+                    latency.recordFailure()
+                }
+            }
+            client.close()
+
+            if benchmarking {
+                let stats = Bench.Stats(latency, retries: 0, seconds: (DispatchTime.now().rawValue - started.rawValue).d / 1_000_000_000)
+                if json {
+                    cliPrint(String(data: try prettyEncoder.encode(stats), encoding: .utf8)!)
+                } else {
+                    cliPrint("\(commands.count) commands: \(stats.text)")
+                }
+                return cliExit(latency.failures > 0 ? 1 : 0)
+            }
+            return cliExit(exitCode)
+        }
+    }
+
     struct Lid: ParsableCommand {
         static let configuration = CommandConfiguration(
             abstract: "Prints if lid is closed or opened."
@@ -445,8 +580,19 @@ struct Lunar: ParsableCommand {
         @Flag(name: .shortAndLong, help: "Get the window average of the last 15 lux readings instead of the last instant reading (can be used with `--listen` as well)")
         var average = false
 
+        @Flag(name: .shortAndLong, help: "Get the sliding median of the lux window (can be used with `--listen` as well)")
+        var median = false
+
+        @Flag(name: .shortAndLong, help: "Get the filtered lux value that Sensor Mode adapts on, which only changes when the difference is perceivable (can be used with `--listen` as well)")
+        var filtered = false
+
         @MainActor func run() throws {
             guard listen else {
+                if median || filtered {
+                    let stats = LuxStatistics.shared.snapshot
+                    cliPrint((filtered ? stats.filtered : stats.median) ?? -1.0)
+                    return cliExit(0)
+                }
                 if SensorMode.specific.externalSensorAvailable, let lux = SensorMode.specific.lastAmbientLight {
                     cliPrint(lux)
                 } else {
@@ -458,12 +604,285 @@ struct Lunar: ParsableCommand {
                 throw LunarCommandError.noServer
             }
             let socketFd = server.currentSocketFD
+            server.broadcaster.subscribe(socketFd)
 
-            let property = average ? AMI.$luxWindowAverage : AMI.$lux
-            property.removeDuplicates().sink { lux in
+            let property = if filtered {
+                AMI.$filteredLux
+            } else if median {
+                AMI.$luxMedian
+            } else {
+                average ? AMI.$luxWindowAverage : AMI.$lux
+            }
+            let listener = property.removeDuplicates().sink { lux in
                 guard let lux else { return }
                 server.write(lux: lux, to: socketFd)
-            }.store(in: &server.luxListeners, for: socketFd)
+            }
+            server.broadcaster.attach(listener, topic: .lux, to: socketFd)
+        }
+    }
+
+    struct Bench: ParsableCommand {
+        struct Stats: Encodable {
+            init(_ latency: LatencyStats, retries: Int, seconds: Double) {
+                count = latency.count
+                failures = latency.failures
+                self.retries = retries
+                min = latency.percentile(0)
+                p50 = latency.percentile(50)
+                p95 = latency.percentile(95)
+                p99 = latency.percentile(99)
+                max = latency.percentile(100)
+                throughput = seconds > 0 ? latency.count.d / seconds : 0
+            }
+
+            let count: Int
+            let failures: Int
+            let retries: Int
+            let min: Double?
+            let p50: Double?
+            let p95: Double?
+            let p99: Double?
+            let max: Double?
+            /// Successful operations per second
+            let throughput: Double
+
+            var text: String {
+                let ms = { (v: Double?) in v.map { String(format: "%.2fms", $0) } ?? "-" }
+                return "ok=\(count) failed=\(failures) retries=\(retries) min=\(ms(min)) p50=\(ms(p50)) p95=\(ms(p95)) p99=\(ms(p99)) max=\(ms(max)) "
+                    + String(format: "throughput=%.1f/s", throughput)
+            }
+        }
+
+        struct Result: Encodable {
+            let display: String
+            let serial: String
+            let id: CGDirectDisplayID
+            let control: String
+            let property: String
+            let reads: Stats
+            let writes: Stats
+            let transitions: Stats?
+        }
+
+        static let configuration = CommandConfiguration(
+            abstract: "Measures read, write and smooth transition latency of each display's active control.",
+            discussion: """
+            The property is written with values around its current value, and restored when the benchmark ends.
+            Adaptive brightness is paused on the display while it's benchmarked, and only one benchmark runs per display at a time.
+            Latencies are reported in milliseconds, failed operations are retried up to `--retries` times.
+
+            Transitions are only measured on controls that report when a transition ended (DDC, Apple Native and Network).
+
+            \("EXAMPLE".bold()):
+                Benchmark brightness on all external monitors: \("lunar bench external".yellow().bold())
+                Compare contrast writes as JSON: \("lunar bench --property contrast --json".yellow().bold())
+            """
+        )
+
+        static let TRANSITION_TIMEOUT: TimeInterval = 30
+
+        static var running: [String: DispatchSemaphore] = [:]
+        static let runningLock = NSRecursiveLock()
+
+        /// Held while a display is benchmarked, so two `lunar bench` calls don't write over each other
+        static func semaphore(for serial: String) -> DispatchSemaphore {
+            runningLock.around {
+                if let semaphore = running[serial] {
+                    return semaphore
+                }
+                let semaphore = DispatchSemaphore(value: 1, name: "bench \(serial)")
+                running[serial] = semaphore
+                return semaphore
+            }
+        }
+
+        @OptionGroup(visibility: .hidden) var globals: GlobalOptions
+
+        @Flag(name: .shortAndLong, help: "Format output as JSON")
+        var json = false
+
+        @Option(name: .shortAndLong, help: "How many reads and how many writes to do")
+        var iterations = 20
+
+        @Option(name: .shortAndLong, help: "How many smooth transitions to do (brightness and contrast only)")
+        var transitions = 3
+
+        @Option(name: .shortAndLong, help: "How many times to retry a failed read or write")
+        var retries = 2
+
+        @Option(name: .shortAndLong, help: "Property to benchmark: brightness, contrast or volume")
+        var property: Display.CodingKeys = .brightness
+
+        @Argument(
+            help: "Display serial or name (without spaces) or one of the following"
+        )
+        var display: DisplayFilter = .external
+
+        func validate() throws {
+            guard [.brightness, .contrast, .volume].contains(property) else {
+                throw LunarCommandError.propertyNotValid("Property must be one of (brightness, contrast, volume)")
+            }
+            guard iterations > 0, transitions >= 0, retries >= 0 else {
+                throw ValidationError("--iterations must be positive, --transitions and --retries can't be negative")
+            }
+        }
+
+        func run() throws {
+            cliGetDisplays(
+                includeVirtual: CachedDefaults[.showVirtualDisplays],
+                includeAirplay: CachedDefaults[.showAirplayDisplays],
+                includeProjector: CachedDefaults[.showProjectorDisplays],
+                includeDummy: CachedDefaults[.showDummyDisplays]
+            )
+
+            let displays = getFilteredDisplays(displays: DC.activeDisplayList, filter: display)
+            guard !displays.isEmpty else {
+                throw LunarCommandError.displayNotFound(display.s)
+            }
+
+            let results = displays.compactMap { benchmark($0) }
+            if json {
+                cliPrint(String(data: try prettyEncoder.encode(results), encoding: .utf8)!)
+                return cliExit(0)
+            }
+
+            for result in results {
+                cliPrint("\(result.display) [\(result.serial)] using \(result.control), \(result.property)")
+                cliPrint("\treads:       \(result.reads.text)")
+                cliPrint("\twrites:      \(result.writes.text)")
+                if let transitions = result.transitions {
+                    cliPrint("\ttransitions: \(transitions.text)")
+                } else if transitions > 0, property != .volume {
+                    cliPrint("\ttransitions: not measured, \(result.control) doesn't report when a transition ends")
+                }
+            }
+            return cliExit(0)
+        }
+
+        func benchmark(_ display: Display) -> Result? {
+            if !isServer || display.control == nil {
+                display.control = display.getBestControl()
+            }
+            guard let control = display.control else { return nil }
+
+            let semaphore = Self.semaphore(for: display.serial)
+            semaphore.wait(for: 0)
+            defer { semaphore.signal() }
+
+            // adaptive brightness would write over the benchmark values
+            let wasPaused = mainThread { display.adaptivePaused }
+            if !wasPaused {
+                mainThread { display.adaptivePaused = true }
+            }
+            defer {
+                if !wasPaused {
+                    mainThread { display.adaptivePaused = false }
+                }
+            }
+
+            let original = switch property {
+            case .contrast: display.limitedContrast
+            case .volume: display.limitedVolume
+            default: display.limitedBrightness
+            }
+            defer { _ = write(original, using: control) }
+
+            let reads = measure(iterations) { _ in control.read(property) != nil }
+
+            // alternate around the current value so every write is a real change
+            let low = original > 10 ? original - 10 : original + 10
+            let writes = measure(iterations) { i in write(i.isMultiple(of: 2) ? low : original, using: control) }
+
+            var transitionStats: Stats?
+            if transitions > 0, property != .volume, canTimeTransitions(control) {
+                _ = write(original, using: control)
+                let far: UInt16 = original > 50 ? original - 40 : original + 40
+                transitionStats = measure(transitions) { i in
+                    transition(display, from: i.isMultiple(of: 2) ? original : far, to: i.isMultiple(of: 2) ? far : original, using: control)
+                }
+            }
+
+            return Result(
+                display: display.name, serial: display.serial, id: display.id, control: control.str,
+                property: property.rawValue, reads: reads, writes: writes, transitions: transitionStats
+            )
+        }
+
+        func measure(_ count: Int, _ operation: (Int) -> Bool) -> Stats {
+            var latency = LatencyStats(capacity: count)
+            var retried = 0
+            let started = DispatchTime.now()
+
+            for i in 0 ..< count {
+                for attempt in 0 ... retries {
+                    let start = DispatchTime.now()
+                    if operation(i) {
+                        latency.record((DispatchTime.now().rawValue - start.rawValue).d / 1_000_000)
+                        break
+                    }
+                    if attempt == retries {
+                        latency.recordFailure()
+                    } else {
+                        retried += 1
+                    }
+                }
+            }
+            return Stats(latency, retries: retried, seconds: (DispatchTime.now().rawValue - started.rawValue).d / 1_000_000_000)
+        }
+
+        func write(_ value: UInt16, using control: Control) -> Bool {
+            switch property {
+            case .contrast:
+                control.setContrast(value, oldValue: nil, transition: .instant, onChange: nil)
+            case .volume:
+                control.setVolume(value)
+            default:
+                control.setBrightness(value, oldValue: nil, force: true, transition: .instant, onChange: nil)
+            }
+        }
+
+        /// Only these controls tell when a transition ended, the others would be timed by the write call alone
+        func canTimeTransitions(_ control: Control) -> Bool {
+            let controlID: ControlID = property == .contrast ? .CONTRAST : .BRIGHTNESS
+            guard control.supportsSmoothTransition(for: controlID) else { return false }
+
+            return control is DDCControl || control is NetworkControl || (control is AppleNativeControl && property == .brightness)
+        }
+
+        /// Starts a smooth transition and waits until the control reports that it ended
+        func transition(_ display: Display, from: UInt16, to: UInt16, using control: Control) -> Bool {
+            let start = {
+                property == .contrast
+                    ? control.setContrast(to, oldValue: from, transition: .smooth, onChange: nil)
+                    : control.setBrightness(to, oldValue: from, force: true, transition: .smooth, onChange: nil)
+            }
+
+            if let network = control as? NetworkControl {
+                let controlID: ControlID = property == .contrast ? .CONTRAST : .BRIGHTNESS
+                let done = DispatchSemaphore(value: 0, name: "bench transition \(display.serial)")
+                network.onTransitionDone = { id in
+                    if id == controlID { done.signal() }
+                }
+                defer { network.onTransitionDone = nil }
+
+                guard start() else { return false }
+                return done.wait(for: Self.TRANSITION_TIMEOUT) != .timedOut
+            }
+
+            guard start() else { return false }
+
+            // DDC and Apple Native transitions run in the background while the display is in the transition state
+            let deadline = Date().addingTimeInterval(0.5)
+            while !display.inSmoothTransition {
+                guard Date() < deadline else { return false }
+                Thread.sleep(forTimeInterval: 0.005)
+            }
+            let timeout = Date().addingTimeInterval(Self.TRANSITION_TIMEOUT)
+            while display.inSmoothTransition {
+                guard Date() < timeout else { return false }
+                Thread.sleep(forTimeInterval: 0.005)
+            }
+            return true
         }
     }
 
@@ -761,19 +1180,7 @@ struct Lunar: ParsableCommand {
                         log.verbose("DisplayServicesRegisterForBrightnessChangeNotifications \(displayID) -> \(value)")
 
                         if isServer, let server = appDelegate?.server {
-                            let socketFds = storeLock.around {
-                                if Swift.Set(server.rawBrightnessListeners.keys).intersection(Swift.Set(server.connectedSockets.keys)).isEmpty {
-                                    for id in server.rawBrightnessListeners.values {
-                                        DisplayServicesUnregisterForBrightnessChangeNotifications(id, id)
-                                    }
-                                    server.rawBrightnessListeners.removeAll()
-                                }
-                                return server.rawBrightnessListeners.filter { $0.value == displayID }.keys
-                            }
-                            let state = DisplayStateChange(property: "brightness", value: value, display: displayID)
-                            for socketFd in socketFds {
-                                server.write(state, to: socketFd, json: false)
-                            }
+                            server.broadcaster.publish(DisplayStateChange(property: "brightness", value: value, display: displayID), notification: .brightness)
                             return
                         }
 
@@ -789,7 +1196,8 @@ struct Lunar: ParsableCommand {
                     }
                     listening = true
                     if isServer, let server = appDelegate?.server, let socketFd {
-                        storeLock.around { server.rawBrightnessListeners[socketFd] = id }
+                        server.broadcaster.subscribe(socketFd)
+                        server.broadcaster.attach(.brightness, display: id, to: socketFd)
                     }
                 case .RegisterForAmbientLightCompensationNotifications:
                     let socketFd = appDelegate?.server.currentSocketFD
@@ -799,20 +1207,7 @@ struct Lunar: ParsableCommand {
                         log.verbose("DisplayServicesRegisterForAmbientLightCompensationNotifications \(displayID) -> \(value)")
 
                         if isServer, let server = appDelegate?.server {
-                            let socketFds = storeLock.around {
-                                if Swift.Set(server.rawLuxListeners.keys).intersection(Swift.Set(server.connectedSockets.keys)).isEmpty {
-                                    for id in server.rawLuxListeners.values {
-                                        DisplayServicesUnregisterForBrightnessChangeNotifications(id, id)
-                                    }
-                                    server.rawLuxListeners.removeAll()
-                                }
-
-                                return server.rawLuxListeners.filter { $0.value == displayID }.keys
-                            }
-                            let state = DisplayStateChange(property: "lux", value: value, display: displayID)
-                            for socketFd in socketFds {
-                                server.write(state, to: socketFd, json: false)
-                            }
+                            server.broadcaster.publish(DisplayStateChange(property: "lux", value: value, display: displayID), notification: .ambientLight)
                             return
                         }
 
@@ -828,7 +1223,8 @@ struct Lunar: ParsableCommand {
                     }
                     listening = true
                     if isServer, let server = appDelegate?.server, let socketFd {
-                        storeLock.around { server.rawLuxListeners[socketFd] = id }
+                        server.broadcaster.subscribe(socketFd)
+                        server.broadcaster.attach(.ambientLight, display: id, to: socketFd)
                     }
                 }
             }
@@ -1175,6 +1571,88 @@ struct Lunar: ParsableCommand {
         }
     }
 
+    struct ScheduleCommand: ParsableCommand {
+        struct Next: ParsableCommand {
+            struct Entry: Codable {
+                let display: String
+                let serial: String
+                let kind: String
+                let date: String
+                let remaining: Int
+            }
+
+            static let configuration = CommandConfiguration(
+                abstract: "Prints the upcoming transition steps and mode changes of each display."
+            )
+
+            @OptionGroup(visibility: .hidden) var globals: GlobalOptions
+
+            @Flag(name: .shortAndLong, help: "Print response as JSON.")
+            var json = false
+
+            func run() throws {
+                let wheel = ScheduleWheel.shared
+                let names = [String: String](DC.displayList.map { ($0.serial, $0.name) }, uniquingKeysWith: first(this:other:))
+                // Clock and Location mode aren't woken up by the wheel, their next change is only read here for reference
+                let clockSchedules = DC.adaptiveModeKey == .clock ? DC.activeDisplayList.filter(\.adaptive).compactMap { display in
+                    display.nextScheduleDate.map { (serial: display.serial, date: $0) }
+                } : []
+                let locationChanges = DC.adaptiveModeKey == .location ? DC.activeDisplayList.filter(\.adaptive).compactMap { display in
+                    display.locationNextChange().flatMap { date in display.locationTarget(at: date).map { (serial: display.serial, date: date, target: $0) } }
+                } : []
+
+                let entries = wheel.pending.map { event in
+                    Entry(
+                        display: names[event.display] ?? event.display,
+                        serial: event.display,
+                        kind: event.kind.rawValue,
+                        date: event.date.toISO(),
+                        remaining: event.remaining
+                    )
+                } + clockSchedules.map { schedule in
+                    Entry(display: names[schedule.serial] ?? schedule.serial, serial: schedule.serial, kind: "clock", date: schedule.date.toISO(), remaining: 0)
+                } + locationChanges.map { change in
+                    Entry(display: names[change.serial] ?? change.serial, serial: change.serial, kind: "location", date: change.date.toISO(), remaining: 0)
+                }
+
+                guard !json else {
+                    cliPrint((try! prettyEncoder.encode(entries)).str())
+                    return cliExit(0)
+                }
+
+                if let next = wheel.nextWakeup {
+                    cliPrint("Next wakeup: \(next.toFormat("yyyy-MM-dd HH:mm:ss.S")) (in \(next.timeIntervalSinceNow.str(decimals: 1))s)")
+                } else {
+                    cliPrint("Next wakeup: none")
+                }
+                cliPrint("Wakeups: \(wheel.wakeups), events fired: \(wheel.fired)")
+
+                let events = Dictionary(grouping: wheel.pending, by: \.display)
+                for serial in Set(events.keys).union(clockSchedules.map(\.serial)).union(locationChanges.map(\.serial)).sorted() {
+                    cliPrint("\n\(names[serial] ?? "Unknown") [UUID: \(serial)]")
+                    for event in events[serial] ?? [] {
+                        cliPrint("  \(event.kind.rawValue):\t\(event.date.toFormat("HH:mm:ss.S")) (\(event.remaining) steps left)")
+                    }
+                    for schedule in clockSchedules where schedule.serial == serial {
+                        cliPrint("  clock:\t\(schedule.date.toFormat("HH:mm:ss.S"))")
+                    }
+                    for change in locationChanges where change.serial == serial {
+                        cliPrint(
+                            "  location:\t\(change.date.toFormat("HH:mm:ss.S")) (brightness: \(change.target.brightness.str(decimals: 1)), contrast: \(change.target.contrast.str(decimals: 1)))"
+                        )
+                    }
+                }
+                return cliExit(0)
+            }
+        }
+
+        static let configuration = CommandConfiguration(
+            commandName: "schedule",
+            abstract: "Inspects the timer that drives slow schedule transitions, and the next Clock and Location mode changes.",
+            subcommands: [Next.self]
+        )
+    }
+
     struct Listen: ParsableCommand {
         static let configuration = CommandConfiguration(
             abstract: "Listen to changes in brightness/contrast/volume of specific displays",
@@ -1223,12 +1701,11 @@ struct Lunar: ParsableCommand {
         )
         var display: DisplayFilter = .all
 
-        static func startListener(for displays: [Display], filter: DisplayFilter, onlyUserAdjustments: Bool, server: LunarServer, json: Bool) throws {
+        static func startListener(for displays: [Display], filter: DisplayFilter, onlyUserAdjustments: Bool, server: LunarServer, socketFd: Int32, json: Bool) throws {
             let displays = getFilteredDisplays(displays: displays, filter: filter)
             guard !displays.isEmpty else {
                 throw LunarCommandError.displayNotFound(filter.s)
             }
-            let socketFd = server.currentSocketFD
 
             let brightnessPublishers: [AnyPublisher<DisplayStateChange, Never>] = displays.map { d in
                 (onlyUserAdjustments ? d.$fullRangeUserBrightness : d.$fullRangeBrightness)
@@ -1266,7 +1743,7 @@ struct Lunar: ParsableCommand {
             }
             let mergedPublisher = Publishers.MergeMany(brightnessPublishers + contrastPublishers + volumePublishers + mutePublishers + nitsPublishers)
 
-            mergedPublisher
+            let listener = mergedPublisher
                 .removeDuplicates()
                 .sink { db in
                     guard let server = appDelegate?.server else {
@@ -1274,7 +1751,7 @@ struct Lunar: ParsableCommand {
                     }
                     server.write(db, to: socketFd, json: json)
                 }
-                .store(in: &server.brightnessListeners, for: socketFd)
+            server.broadcaster.attach(listener, topic: .displayChanges, to: socketFd)
         }
 
         func run() throws {
@@ -1282,20 +1759,22 @@ struct Lunar: ParsableCommand {
                 throw LunarCommandError.noServer
             }
 
-            try Self.startListener(for: DC.activeDisplayList, filter: display, onlyUserAdjustments: onlyUserAdjustments, server: server, json: json)
             let socketFd = server.currentSocketFD
-            DC.$activeDisplayList
+            server.broadcaster.subscribe(socketFd)
+
+            try Self.startListener(for: DC.activeDisplayList, filter: display, onlyUserAdjustments: onlyUserAdjustments, server: server, socketFd: socketFd, json: json)
+            let listener = DC.$activeDisplayList
                 .sink { displays in
                     guard let server = appDelegate?.server else {
                         return
                     }
                     do {
-                        try Self.startListener(for: displays, filter: display, onlyUserAdjustments: onlyUserAdjustments, server: server, json: json)
+                        try Self.startListener(for: displays, filter: display, onlyUserAdjustments: onlyUserAdjustments, server: server, socketFd: socketFd, json: json)
                     } catch {
                         log.error("CLI Error listening for brightness changes: \(error.localizedDescription)")
                     }
                 }
-                .store(in: &server.displayListeners, for: socketFd)
+            server.broadcaster.attach(listener, topic: .displayList, to: socketFd)
         }
     }
 
@@ -1346,6 +1825,9 @@ struct Lunar: ParsableCommand {
         @Flag(name: .shortAndLong, help: "Exit with status code 1 if no displays are found or 0 if any display matches the filter. Don't print anything")
         var quiet = false
 
+        @Option(help: "Only print these comma separated properties, e.g. \("brightness,contrast,serial".yellow()). Much faster than printing everything when polling with --json")
+        var fields: DisplayFields?
+
         @Flag(
             name: .shortAndLong,
             help: "If <property> is passed, try to actively read the property instead of fetching it from cache. Caution: might cause a kernel panic if DDC is too slow to respond!"
@@ -1368,6 +1850,16 @@ struct Lunar: ParsableCommand {
         @Argument(help: "Display property value to set")
         var value: String?
 
+        func validate() throws {
+            guard fields != nil else { return }
+            if property != nil {
+                throw ValidationError("--fields can't be used together with a <property>")
+            }
+            if edid || systemInfo || panelData {
+                throw ValidationError("--fields can't be used together with --edid, --system-info or --panel-data")
+            }
+        }
+
         func run() throws {
             let property = property == .mute ? .audioMuted : property
 
@@ -1397,7 +1889,8 @@ struct Lunar: ParsableCommand {
                         systemInfo: systemInfo,
                         panelData: panelData,
                         panelDataAllResolutions: panelDataAllResolutions,
-                        edid: edid
+                        edid: edid,
+                        fields: fields
                     )
                 } catch {
                     cliPrint("\(error)")
@@ -1424,7 +1917,8 @@ struct Lunar: ParsableCommand {
                         systemInfo: systemInfo,
                         panelData: panelData,
                         panelDataAllResolutions: panelDataAllResolutions,
-                        edid: edid
+                        edid: edid,
+                        fields: fields
                     )
                 } else {
                     cliPrint("\(i): \(display.name)")
@@ -1435,7 +1929,8 @@ struct Lunar: ParsableCommand {
                         systemInfo: systemInfo,
                         panelData: panelData,
                         panelDataAllResolutions: panelDataAllResolutions,
-                        edid: edid
+                        edid: edid,
+                        fields: fields
                     )
                     if i < displays.count - 1 {
                         cliPrint("")
@@ -2044,8 +2539,11 @@ struct Lunar: ParsableCommand {
             RefreshDisplays.self,
             Edid.self,
             Listen.self,
+            Batch.self,
+            Bench.self,
             CleaningMode.self,
             NightMode.self,
+            ScheduleCommand.self,
         ] + ARCH_SPECIFIC_COMMANDS
     )
 
@@ -2119,6 +2617,10 @@ struct Lunar: ParsableCommand {
             return cmd.globals
         case let cmd as Listen:
             return cmd.globals
+        case let cmd as Batch:
+            return cmd.globals
+        case let cmd as Bench:
+            return cmd.globals
         case let cmd as DisplayServices:
             return cmd.globals
         case let cmd as Hotkeys:
@@ -2173,6 +2675,26 @@ private func setupNetworkControls(displays: [Display], waitms: Int = 2000) {
     }
 }
 
+/// Encodes only `fields` of the display, written straight to JSON without going through `display.dictionary`
+private func printDisplayFields(_ display: Display, fields: DisplayFields, json: Bool, terminator: String, prefix: String) throws {
+    if json {
+        var writer = JSONStreamWriter()
+        try ProjectingEncoder.write(display, fields: fields.names, to: &writer)
+        cliPrint("\(prefix)\(writer.string)", terminator: terminator)
+        return
+    }
+
+    let projection = ProjectingEncoder(fields: fields.names)
+    try display.encode(to: projection)
+
+    let keys = fields.names.map { ($0, Lunar.prettyKey($0)) }
+    let longestKeySize = keys.map(\.1.count).max() ?? 1
+    for (field, key) in keys {
+        let value = projection.fragments[field].map { String(decoding: $0, as: UTF8.self) } ?? "null"
+        cliPrint("\(prefix)\(spaced(key, longestKeySize))\(value)")
+    }
+}
+
 private func printDisplay(
     _ display: Display,
     json: Bool = false,
@@ -2181,8 +2703,14 @@ private func printDisplay(
     systemInfo: Bool = false,
     panelData: Bool = false,
     panelDataAllResolutions: Bool = false,
-    edid: Bool = false
+    edid: Bool = false,
+    fields: DisplayFields? = nil
 ) throws {
+    if let fields {
+        try printDisplayFields(display, fields: fields, json: json, terminator: terminator, prefix: prefix)
+        return
+    }
+
     var edidStr = ""
     if edid {
         let data = DDC.getEdidData(displayID: display.id)
@@ -2279,7 +2807,8 @@ private func handleDisplays(
     systemInfo: Bool = false,
     panelData: Bool = false,
     panelDataAllResolutions: Bool = false,
-    edid: Bool = false
+    edid: Bool = false,
+    fields: DisplayFields? = nil
 ) throws {
     let property = property == .mute ? .audioMuted : property
     let displays = getFilteredDisplays(displays: displays, filter: displayFilter)
@@ -2308,11 +2837,12 @@ private func handleDisplays(
                         systemInfo: systemInfo,
                         panelData: panelData,
                         panelDataAllResolutions: panelDataAllResolutions,
-                        edid: edid
+                        edid: edid,
+                        fields: fields
                     )
                 } else {
                     cliPrint("\(i): \(display.name)")
-                    try printDisplay(display, json: json, prefix: "\t", systemInfo: systemInfo, edid: edid)
+                    try printDisplay(display, json: json, prefix: "\t", systemInfo: systemInfo, edid: edid, fields: fields)
                     if i < displays.count - 1 {
                         cliPrint("")
                     }
@@ -2597,6 +3127,10 @@ import Combine
 // MARK: - LunarServer
 
 final class LunarServer {
+    init() {
+        broadcaster.onClose = { [weak self] fd in self?.closeSocket(fd) }
+    }
+
     deinit {
         for socket in connectedSockets.values {
             socket.close()
@@ -2604,23 +3138,64 @@ final class LunarServer {
         self.listenSocket?.close()
     }
 
+    // MARK: - Connection
+
+    final class Connection {
+        init(socket: Socket) {
+            self.socket = socket
+        }
+
+        let socket: Socket
+        var source: DispatchSourceRead?
+        var buffer = Data()
+        var busy = false
+        var eof = false
+        var closed = false
+        /// Set once a `CLISession` handshake succeeded, every following line is a request
+        var sessionKey: String?
+        /// Set when no more bytes arrived for `RAW_IDLE_MS`, an unterminated raw request is then taken as is
+        var idle = false
+        var idleCheck: DispatchWorkItem?
+
+        /// Response bytes the socket didn't take yet, drained by `writeSource` as the client reads
+        var outgoing = Data()
+        var offset = 0
+        var writeSource: DispatchSourceWrite?
+        /// Runs once `outgoing` is fully written
+        var onDrained: (() -> Void)?
+
+        var drained: Bool { offset >= outgoing.count }
+    }
+
     static let bufferSize = 4096
+    static let MAX_REQUEST_SIZE = 1024 * 1024
+    /// How long to wait for the newline of a raw request before running it, for clients that don't send one
+    static let RAW_IDLE_MS = 100
+    static let METRICS_PATH = "/metrics"
     static let queue = DispatchQueue(label: "fyi.lunar.cliServer.queue", qos: .userInitiated)
+    /// Reads, parses and writes for every connection, nothing on it blocks
+    static let loopQueue = DispatchQueue(label: "fyi.lunar.cliServer.loop", qos: .userInitiated)
+    static let commandQueue = DispatchQueue(label: "fyi.lunar.cliServer.commands", qos: .userInitiated, attributes: .concurrent)
 
     @Atomic var continueRunning = true
+    /// Last accepted socket, used as `currentSocketFD` outside of a running command
+    @Atomic var lastSocketFD: Int32 = 0
 
     var listenSocket: Socket?
     var connectedSockets = [Int32: Socket]()
-    var luxListeners: [Int32: AnyCancellable] = [:]
-    var brightnessListeners: [Int32: AnyCancellable] = [:]
-    var rawBrightnessListeners: [Int32: CGDirectDisplayID] = [:]
-    var rawLuxListeners: [Int32: CGDirectDisplayID] = [:]
-    var displayListeners: [Int32: AnyCancellable] = [:]
+    /// Listener subscriptions of every socket
+    let broadcaster = CLIBroadcaster()
     let socketLockQueue = DispatchQueue(label: "com.kitura.serverSwift.socketLockQueue")
 
-    var currentSocketFD: Int32 = 0
+    /// Only touched on `loopQueue`
+    var connections: [Int32: Connection] = [:]
+
+    /// Socket of the request whose command is running on this thread, listener commands keep writing to it
+    var currentSocketFD: Int32 {
+        CLIOutput.current?.socketFD ?? lastSocketFD
+    }
 
-    func run(host: String = "127.0.0.1") {
+    func run(host: String = "127.0.0.1", port: Int32 = LUNAR_CLI_PORT) {
         Self.queue.async {
             if let cliServerTask, !cliServerTask.isCancelled {
                 Self.queue.async {
@@ -2636,7 +3211,7 @@ final class LunarServer {
                         return
                     }
 
-                    try socket.listen(on: LUNAR_CLI_PORT.i, node: host)
+                    try socket.listen(on: port.i, node: host)
                     log.info("CLI: Listening on port \(socket.listeningPort)")
 
                     repeat {
@@ -2665,198 +3240,391 @@ final class LunarServer {
         }
     }
 
-    func onResponse(_ response: String, socket: Socket) throws {
-        let lines = response.split(separator: "\r\n")
-        let serverHTTP = lines.first?.contains("HTTP") ?? false
-
-        defer {
-            serverExitCode = 0
-            serverOutput = ""
+    /// Runs one complete request and calls `completion` with the bytes to send back, `nil` if nothing should be sent.
+    ///
+    /// Auth and argument parsing happen on the event loop, read-only commands then run in parallel on
+    /// `commandQueue` and everything else on the main thread, each with its own `CLIOutput`.
+    func handle(_ request: CLIRequest, socketFD: Int32, completion: @escaping (String?) -> Void) {
+        if request.http, request.path == Self.METRICS_PATH {
+            return handleMetrics(request, completion: completion)
         }
 
-        do {
-            var key = lines
-                .first(where: { $0.lowercased().starts(with: "authorization:") })?
-                .split(separator: ":", maxSplits: 1, omittingEmptySubsequences: true)
-                .last?.s.trimmed
+        let output = CLIOutput(socketFD: socketFD)
 
-            var line = lines.last?.s
-            if let l = line, serverHTTP, !l.starts(with: "cmd=") {
-                line = try socket.readString()
-            }
-            if let l = line, l.starts(with: "cmd=") {
-                line = l.suffix(l.count - 4).replacingOccurrences(of: "+", with: " ").removingPercentEncoding
-            }
+        let args: [String]
+        var command: ParsableCommand
+        do {
+            // session requests always get an answer, the client counts them
+            let missing = request.id.map { CLISession.response(id: $0, exitCode: 1, output: "Missing command\n") }
+            guard let line = request.line else { return completion(missing) }
 
-            guard var args = line?
-                .split(separator: response.contains(CLI_ARG_SEPARATOR) ? CLI_ARG_SEPARATOR.first! : " ")
-                .map({ String($0) })
+            var parsedArgs = line
+                .split(separator: line.contains(CLI_ARG_SEPARATOR) ? CLI_ARG_SEPARATOR.first! : " ")
+                .map { request.escaped ? CLISession.unescape(String($0)) : String($0) }
                 .without("--remote")
-            else { return }
-            key = key ?? args.removeFirst()
+            guard !parsedArgs.isEmpty else { return completion(missing) }
 
+            let key = request.key ?? parsedArgs.removeFirst()
             guard key == CachedDefaults[.apiKey] else {
                 let resp = "Unauthorized\n"
-                if serverHTTP {
-                    try socket.write(from: "HTTP/1.1 401 Unauthorized\r\nContent-Length: \(resp.count)\r\n\r\n")
-                }
-                try socket.write(from: resp)
-                return
+                return completion(request.http ? "HTTP/1.1 401 Unauthorized\r\nContent-Length: \(resp.utf8.count)\r\n\r\n\(resp)" : resp)
             }
 
-            var command = try Lunar.parseAsRoot(args)
-            try mainThreadThrows {
-                try command.run()
+            args = parsedArgs
+            command = try Lunar.parseAsRoot(args)
+        } catch {
+            return completion(Self.response(output: output, error: error, request: request, json: false))
+        }
+
+        if let id = request.id, Self.streams(command) {
+            return completion(CLISession.response(id: id, exitCode: 1, output: "Listeners can't run inside a session\n"))
+        }
+
+        let json = args.contains("--json")
+        let run = {
+            do {
+                try output.capture { try command.run() }
+                completion(Self.response(output: output, error: nil, request: request, json: json))
+            } catch {
+                completion(Self.response(output: output, error: error, request: request, json: json))
             }
-            let statusCode = serverExitCode == 0 ? "" : "Status-Code: \(serverExitCode)\r\n"
+        }
 
-            if !serverOutput.isEmpty {
-                let jsonHeader = args.contains("--json") ? "Content-Type: application/json\r\n" : ""
-                if serverHTTP {
-                    try socket.write(from: "HTTP/1.1 200 OK\r\n\(jsonHeader)\(statusCode)Content-Length: \(serverOutput.count)\r\n\r\n")
-                    try socket.write(from: serverOutput)
-                } else {
-                    try socket.write(from: statusCode + serverOutput)
-                }
-            } else if serverHTTP {
-                try socket.write(from: "HTTP/1.1 204 No Content\r\n\(statusCode)Content-Length: 0\r\n\r\n")
+        if Self.runsOffMain(command) {
+            Self.commandQueue.async(execute: run)
+        } else {
+            mainAsync(run)
+        }
+    }
+
+    /// Prometheus scrapes send the API key as `Authorization: Bearer <key>`, plain `Authorization: <key>` works too
+    func handleMetrics(_ request: CLIRequest, completion: @escaping (String?) -> Void) {
+        let apiKey = CachedDefaults[.apiKey]
+        guard let key = request.key, key == apiKey || key == "Bearer \(apiKey)" else {
+            let resp = "Unauthorized\n"
+            return completion("HTTP/1.1 401 Unauthorized\r\nContent-Length: \(resp.utf8.count)\r\n\r\n\(resp)")
+        }
+
+        Self.commandQueue.async {
+            let body = HealthMetrics.shared.render()
+            completion("HTTP/1.1 200 OK\r\nContent-Type: \(HealthMetrics.CONTENT_TYPE)\r\nContent-Length: \(body.utf8.count)\r\n\r\n\(body)")
+        }
+    }
+
+    /// Commands that don't need the main thread and can run next to each other, mostly the ones that only read cached state
+    static func runsOffMain(_ command: ParsableCommand) -> Bool {
+        switch command {
+        case let command as Lunar.Get:
+            !command.read
+        case let command as Lunar.Displays:
+            // EDID reads are I2C transactions and panel data lives on MonitorPanel, both belong to the main thread
+            command.value == nil && !command.read && !command.edid && !command.systemInfo && !command.panelData
+        case is Lunar.Bench:
+            // talks to the monitors for seconds, and smooth transitions need the main thread to be free
+            true
+        default:
+            false
+        }
+    }
+
+    /// Commands that keep writing to the socket after they return
+    static func streams(_ command: ParsableCommand) -> Bool {
+        switch command {
+        case is Lunar.Listen:
+            true
+        case let command as Lunar.Lux:
+            command.listen
+        case let command as Lunar.DisplayServices:
+            command.method == .RegisterForBrightnessChangeNotifications || command.method == .RegisterForAmbientLightCompensationNotifications
+        default:
+            false
+        }
+    }
+
+    static func response(output: CLIOutput, error: Error?, request: CLIRequest, json: Bool) -> String? {
+        if let id = request.id {
+            guard let error else {
+                return CLISession.response(id: id, exitCode: output.exitCode, output: output.text)
             }
-        } catch {
-            let statusCode = serverExitCode == 0 ? "" : "Status-Code: \(serverExitCode)\r\n"
+            let exitCode = output.exitCode != 0 ? output.exitCode : Lunar.exitCode(for: error).rawValue
+            return CLISession.response(id: id, exitCode: exitCode, output: Lunar.fullMessage(for: error) + "\n")
+        }
+
+        let http = request.http
+        let statusCode = output.exitCode == 0 ? "" : "Status-Code: \(output.exitCode)\r\n"
+
+        if let error {
             let err = Lunar.fullMessage(for: error) + "\n"
+            return http ? "HTTP/1.1 400 Bad Request\r\n\(statusCode)Content-Length: \(err.utf8.count)\r\n\r\n\(err)" : statusCode + err
+        }
 
-            if serverHTTP {
-                try socket.write(from: "HTTP/1.1 400 Bad Request\r\n\(statusCode)Content-Length: \(err.count)\r\n\r\n")
-                try socket.write(from: err)
-            } else {
-                try socket.write(from: statusCode + err)
-            }
+        guard !output.text.isEmpty else {
+            return http ? "HTTP/1.1 204 No Content\r\n\(statusCode)Content-Length: 0\r\n\r\n" : nil
         }
+
+        let jsonHeader = json ? "Content-Type: application/json\r\n" : ""
+        return http
+            ? "HTTP/1.1 200 OK\r\n\(jsonHeader)\(statusCode)Content-Length: \(output.text.utf8.count)\r\n\r\n\(output.text)"
+            : statusCode + output.text
     }
 
     func write(lux: Double, to socketFd: Int32) {
-        socketLockQueue.async(flags: .barrier) { [weak self] in
-            guard let self, let socket = connectedSockets[socketFd] else {
-                _ = storeLock.around {
-                    self?.luxListeners.removeValue(forKey: socketFd)
-                }
-                return
+        broadcaster.publish(lux: lux, to: socketFd)
+    }
+
+    func write(_ change: DisplayStateChange, to socketFd: Int32, json: Bool) {
+        broadcaster.publish(change, to: socketFd, json: json)
+    }
+
+    func addNewConnection(socket: Socket) {
+        socketLockQueue.sync { [socket] in
+            lastSocketFD = socket.socketfd
+            connectedSockets[socket.socketfd] = socket
+        }
+
+        do {
+            try socket.setBlocking(mode: false)
+        } catch {
+            log.error("CLI: Could not make socket \(socket.socketfd) non-blocking: \(error)")
+            socketLockQueue.sync { [socket] in connectedSockets[socket.socketfd] = nil }
+            socket.close()
+            return
+        }
+
+        let connection = Connection(socket: socket)
+        let source = DispatchSource.makeReadSource(fileDescriptor: socket.socketfd, queue: Self.loopQueue)
+        source.setEventHandler { [weak self, weak connection] in
+            guard let self, let connection else { return }
+            read(connection)
+        }
+        connection.source = source
+
+        Self.loopQueue.async { [self] in
+            connections[socket.socketfd] = connection
+            source.resume()
+        }
+    }
+
+    /// Drains everything the socket has buffered, then runs the first complete request if none is in flight
+    func read(_ connection: Connection) {
+        let socket = connection.socket
+        do {
+            var readData = Data(capacity: Self.bufferSize)
+            while try socket.read(into: &readData) > 0 {
+                connection.buffer.append(readData)
+                readData.removeAll(keepingCapacity: true)
             }
-            let val = String(format: "%.3f", lux)
-            #if DEBUG
-                log.debug("CLI: Writing \(val) to \(socketFd)")
-            #endif
-            _ = try? socket.write(from: "\(val)\n")
+            if socket.remoteConnectionClosed {
+                connection.eof = true
+            }
+        } catch {
+            if continueRunning {
+                log.error("CLI: Error reported by connection at \(socket.remoteHostname):\(socket.remotePort): \(error)")
+            }
+            connection.eof = true
+            connection.buffer.removeAll()
         }
+
+        if connection.buffer.count > Self.MAX_REQUEST_SIZE {
+            log.warning("CLI: Read too many bytes!")
+            connection.buffer.removeAll()
+            connection.eof = true
+        }
+        if connection.eof {
+            // a closed socket stays readable, stop the source so it doesn't spin while the last request runs
+            connection.source?.cancel()
+            connection.source = nil
+        }
+        connection.idle = false
+        connection.idleCheck?.cancel()
+        connection.idleCheck = nil
+        process(connection)
     }
 
-    func write(_ change: DisplayStateChange, to socketFd: Int32, json: Bool) {
-        socketLockQueue.async(flags: .barrier) { [weak self] in
-            guard let self, let socket = connectedSockets[socketFd] else {
-                storeLock.around {
-                    self?.brightnessListeners.removeValue(forKey: socketFd)
-                    self?.displayListeners.removeValue(forKey: socketFd)
-                    if let id = self?.rawBrightnessListeners[socketFd] {
-                        DisplayServicesUnregisterForBrightnessChangeNotifications(id, id)
-                        self?.rawBrightnessListeners.removeValue(forKey: socketFd)
-                    }
-                    if let id = self?.rawLuxListeners[socketFd] {
-                        DisplayServicesUnregisterForAmbientLightCompensationNotifications(id, id)
-                        self?.rawLuxListeners.removeValue(forKey: socketFd)
-                    }
+    /// Requests on the same connection are answered in order, one at a time
+    func process(_ connection: Connection) {
+        guard !connection.busy else { return }
+
+        guard let request = CLIRequest.take(
+            from: &connection.buffer,
+            sessionKey: connection.sessionKey,
+            complete: connection.eof || connection.idle
+        ) else {
+            if connection.eof {
+                whenDrained(connection) { [weak self] in self?.finish(connection) }
+            } else if !connection.buffer.isEmpty, !connection.idle, connection.idleCheck == nil {
+                // an unterminated raw request from an older client, run it if nothing else arrives
+                connection.idleCheck = Self.loopQueue.asyncAfter(ms: Self.RAW_IDLE_MS, name: "CLI idle check") { [weak self, weak connection] in
+                    guard let self, let connection else { return }
+                    connection.idleCheck = nil
+                    connection.idle = true
+                    process(connection)
                 }
-                return
             }
-            let val = change.property == "mute" ? (change.value == 1 ? "true" : "false") : String(format: "%.3f", change.value)
+            return
+        }
 
-            do {
-                if json {
-                    #if DEBUG
-                        log.debug("CLI: Writing {\"\(change.property)\": \(val), \"display\": \(change.display)}\n to \(socketFd)")
-                    #endif
-                    _ = try socket.write(from: "{\"\(change.property)\": \(val), \"display\": \(change.display)}\n")
-                } else {
-                    #if DEBUG
-                        log.debug("CLI: Writing \(change.property) \(val) \(change.display) to \(socketFd)")
-                    #endif
-                    _ = try socket.write(from: "\(change.property) \(val) \(change.display)\n")
+        #if DEBUG
+            log.debug("CLI: Server received from connection at \(connection.socket.remoteHostname):\(connection.socket.remotePort): \(request.line ?? "")")
+        #endif
+
+        if request.handshake {
+            guard request.key == CachedDefaults[.apiKey] else {
+                send("Unauthorized\n", on: connection)
+                connection.eof = true
+                connection.buffer.removeAll()
+                return process(connection)
+            }
+            connection.sessionKey = request.key
+            send(CLISession.OK, on: connection)
+            return process(connection)
+        }
+
+        connection.busy = true
+        handle(request, socketFD: connection.socket.socketfd) { [weak self] response in
+            Self.loopQueue.async {
+                guard let self else { return }
+                if let response {
+                    send(response, on: connection)
+                }
+                // the next request only runs once the client has read the whole response
+                whenDrained(connection) { [weak self] in
+                    connection.busy = false
+                    self?.process(connection)
                 }
-            } catch {
-                log.error("CLI: Error writing to socket \(socketFd): \(error)")
-                connectedSockets.removeValue(forKey: socketFd)
             }
         }
     }
 
-    func addNewConnection(socket: Socket) {
-        socketLockQueue.sync { [socket] in
-            currentSocketFD = socket.socketfd
-            connectedSockets[socket.socketfd] = socket
+    /// Queues `response` after anything still unsent and writes as much as the socket takes without blocking
+    func send(_ response: String, on connection: Connection) {
+        guard !connection.closed else { return }
+        connection.outgoing.append(contentsOf: response.utf8)
+        if connection.writeSource == nil {
+            flush(connection)
         }
+    }
 
-        DispatchQueue.global(qos: .default).async { [weak self, socket] in
-//             print("\(Date()) Starting addNewConnection")
-//             defer { print("\(Date()) Finished addNewConnection") }
+    /// Runs `action` on `loopQueue` once every queued response byte was written, right away if nothing is queued
+    func whenDrained(_ connection: Connection, _ action: @escaping () -> Void) {
+        guard !connection.drained, !connection.closed else {
+            action()
+            return
+        }
+        connection.onDrained = action
+    }
 
-            var shouldKeepRunning = true
-            var readData = Data(capacity: Self.bufferSize)
+    /// Same non-blocking drain as `CLIBroadcaster.flush`: the socket is never written with a blocking call
+    func flush(_ connection: Connection) {
+        let fd = connection.socket.socketfd
+        while !connection.drained {
+            let written = connection.outgoing.withUnsafeBytes { buf in
+                Darwin.send(fd, buf.baseAddress! + connection.offset, buf.count - connection.offset, 0)
+            }
+            if written > 0 {
+                connection.offset += written
+                continue
+            }
+            if written < 0, errno == EINTR {
+                continue
+            }
+            if written < 0, errno == EAGAIN || errno == EWOULDBLOCK {
+                waitForWritable(connection)
+                return
+            }
 
-            do {
-                readLoop: repeat {
-                    switch try socket.read(into: &readData) {
-                    case 1 ... Self.bufferSize:
-                        guard let response = String(data: readData, encoding: .utf8)?.trimmed else {
-                            log.error("CLI: Error decoding response...")
-                            readData.removeAll(keepingCapacity: true)
-                            break readLoop
-                        }
+            log.error("CLI: Error writing to socket \(fd): \(String(cString: strerror(errno)))")
+            connection.eof = true
+            connection.buffer.removeAll()
+            break
+        }
 
-                        log.info("CLI: Server received from connection at \(socket.remoteHostname):\(socket.remotePort): \(response) ")
-                        guard let self else { return }
-                        try onResponse(response, socket: socket)
-                    case 0:
-                        log.info("CLI: Read 0 bytes, closing socket")
-                        shouldKeepRunning = false
-                        break readLoop
-                    default:
-                        log.warning("CLI: Read too many bytes!")
-                        readData.removeAll(keepingCapacity: true)
-                        break readLoop
-                    }
+        connection.writeSource?.cancel()
+        connection.writeSource = nil
+        connection.outgoing.removeAll(keepingCapacity: true)
+        connection.offset = 0
 
-                    readData.removeAll(keepingCapacity: true)
-                } while shouldKeepRunning
+        let onDrained = connection.onDrained
+        connection.onDrained = nil
+        onDrained?()
+    }
 
-                guard let self else {
-                    return
-                }
-                if storeLock.around({ self.brightnessListeners[socket.socketfd] ?? self.luxListeners[socket.socketfd] }) != nil ||
-                    storeLock.around({ self.rawBrightnessListeners[socket.socketfd] ?? self.rawLuxListeners[socket.socketfd] }) != nil
-                {
-                    log.info("CLI: Socket \(socket.remoteHostname):\(socket.remotePort) still has listeners, not closing...")
-                    return
-                }
-                log.info("CLI: Socket \(socket.remoteHostname):\(socket.remotePort) closed...")
-                socket.close()
+    private func waitForWritable(_ connection: Connection) {
+        guard connection.writeSource == nil else { return }
 
-                socketLockQueue.sync { [socket] in
-                    self.connectedSockets[socket.socketfd] = nil
-                }
-            } catch {
-                guard let socketError = error as? Socket.Error else {
-                    log.error("CLI: Unexpected error by connection at \(socket.remoteHostname):\(socket.remotePort)...")
-                    return
-                }
-                if let self, continueRunning {
-                    log.error("CLI: Error reported by connection at \(socket.remoteHostname):\(socket.remotePort):\n \(socketError.description)")
-                }
+        let source = DispatchSource.makeWriteSource(fileDescriptor: connection.socket.socketfd, queue: Self.loopQueue)
+        source.setEventHandler { [weak self, weak connection] in
+            guard let self, let connection, !connection.closed else { return }
+            connection.writeSource?.cancel()
+            connection.writeSource = nil
+            flush(connection)
+        }
+        connection.writeSource = source
+        source.resume()
+    }
+
+    /// Stops reading from a connection that reached EOF, the socket stays open while listeners still write to it
+    func finish(_ connection: Connection) {
+        guard !connection.closed else { return }
+        connection.closed = true
+        connection.source?.cancel()
+        connection.source = nil
+        connection.writeSource?.cancel()
+        connection.writeSource = nil
+
+        let socket = connection.socket
+        connections.removeValue(forKey: socket.socketfd)
+
+        if broadcaster.hasSubscriptions(socket.socketfd) {
+            log.info("CLI: Socket \(socket.remoteHostname):\(socket.remotePort) still has listeners, not closing...")
+            return
+        }
+        log.info("CLI: Socket \(socket.remoteHostname):\(socket.remotePort) closed...")
+
+        broadcaster.remove(socket.socketfd)
+        socketLockQueue.async(flags: .barrier) { [self, socket] in
+            connectedSockets[socket.socketfd] = nil
+            socket.close()
+        }
+    }
+
+    /// Closes a listener socket the broadcaster gave up on, never waits on the broadcaster queue
+    func closeSocket(_ socketFD: Int32) {
+        Self.loopQueue.async { [self] in
+            if let connection = connections.removeValue(forKey: socketFD) {
+                connection.closed = true
+                connection.source?.cancel()
+                connection.source = nil
+                connection.writeSource?.cancel()
+                connection.writeSource = nil
+            }
+            socketLockQueue.async(flags: .barrier) { [self] in
+                connectedSockets.removeValue(forKey: socketFD)?.close()
             }
         }
     }
 
+    /// Cancels the read source before the socket gets closed somewhere else, so a reused fd never reaches a stale handler
+    func dropConnection(_ socketFD: Int32) {
+        Self.loopQueue.sync {
+            guard let connection = connections.removeValue(forKey: socketFD) else { return }
+            connection.closed = true
+            connection.source?.cancel()
+            connection.source = nil
+            connection.writeSource?.cancel()
+            connection.writeSource = nil
+        }
+    }
+
     func closeOldSockets() {
+        let oldSocketFDs = socketLockQueue.sync { connectedSockets.keys.filter { $0 != self.lastSocketFD } }
+        for fd in oldSocketFDs {
+            dropConnection(fd)
+            broadcaster.remove(fd)
+        }
+
         socketLockQueue.sync {
-            for socket in connectedSockets.values.filter({ $0.socketfd != self.currentSocketFD }) {
+            for socket in connectedSockets.values.filter({ oldSocketFDs.contains($0.socketfd) }) {
                 connectedSockets.removeValue(forKey: socket.socketfd)
                 socket.close()
             }
@@ -2868,6 +3636,8 @@ final class LunarServer {
         continueRunning = false
 
         for socket in connectedSockets.values {
+            dropConnection(socket.socketfd)
+            broadcaster.remove(socket.socketfd)
             socketLockQueue.sync { [socket] in
                 connectedSockets[socket.socketfd] = nil
                 socket.close()
@@ -2884,6 +3654,8 @@ final class LunarServer {
             self.continueRunning = false
 
             for socket in self.connectedSockets.values {
+                self.dropConnection(socket.socketfd)
+                self.broadcaster.remove(socket.socketfd)
                 self.connectedSockets[socket.socketfd] = nil
                 socket.close()
             }
@@ -2892,6 +3664,139 @@ final class LunarServer {
     }
 }
 
+// MARK: - CLIOutput
+
+/// Output of one CLI server request.
+///
+/// `cliPrint` and `cliExit` write into the sink of the thread the command runs on,
+/// so requests running at the same time never mix their output.
+final class CLIOutput {
+    init(socketFD: Int32) {
+        self.socketFD = socketFD
+    }
+
+    static let THREAD_KEY = "fyi.lunar.cliOutput"
+
+    static var current: CLIOutput? {
+        Thread.current.threadDictionary[THREAD_KEY] as? CLIOutput
+    }
+
+    let socketFD: Int32
+    var text = ""
+    var exitCode: Int32 = 0
+
+    func capture<T>(_ action: () throws -> T) rethrows -> T {
+        let dict = Thread.current.threadDictionary
+        let previous = dict[Self.THREAD_KEY]
+        dict[Self.THREAD_KEY] = self
+        defer { dict[Self.THREAD_KEY] = previous }
+
+        return try action()
+    }
+}
+
+// MARK: - CLIRequest
+
+/// One request read from a CLI server connection: a raw `<key><sep><args>` write, an HTTP request
+/// or a line of a `CLISession`
+struct CLIRequest {
+    static let CRLF = Data("\r\n".utf8)
+    static let HEADER_END = Data("\r\n\r\n".utf8)
+    static let HTTP_METHODS = ["GET ", "POST ", "PUT ", "HEAD "].map { Data($0.utf8) }
+
+    let http: Bool
+    let key: String?
+    let line: String?
+    /// Request ID of a session line
+    var id: String? = nil
+    /// Session handshake, `key` holds the API key to check
+    var handshake = false
+    /// Path of an HTTP request, without the query string
+    var path: String? = nil
+    /// Arguments were written with `CLISession.escape` and need to be unescaped after splitting
+    var escaped = false
+
+    /// Removes the first complete request from `buffer`, or returns `nil` if more bytes are needed.
+    ///
+    /// Raw requests end at a newline, a TCP write can arrive in more than one read.
+    /// Older clients don't send the newline, so with `complete` set (EOF or an idle connection)
+    /// whatever was read is taken as the request.
+    /// HTTP requests are complete once the headers and `Content-Length` bytes of body arrived.
+    static func take(from buffer: inout Data, sessionKey: String? = nil, complete: Bool = false) -> CLIRequest? {
+        guard !buffer.isEmpty else { return nil }
+
+        if let sessionKey {
+            guard let line = takeLine(from: &buffer) else { return nil }
+            let parts = line.split(separator: CLI_ARG_SEPARATOR.first!, maxSplits: 1, omittingEmptySubsequences: false)
+            return CLIRequest(http: false, key: sessionKey, line: parts.count == 2 ? parts[1].s : nil, id: parts[0].s.trimmed, escaped: true)
+        }
+        if buffer.starts(with: CLISession.HANDSHAKE) {
+            guard let line = takeLine(from: &buffer) else { return nil }
+            return CLIRequest(http: false, key: line.dropFirst(CLISession.HANDSHAKE.count).s.trimmed, line: nil, handshake: true)
+        }
+
+        let isHTTP = if let lineEnd = buffer.range(of: CRLF) {
+            String(data: buffer[buffer.startIndex ..< lineEnd.lowerBound], encoding: .utf8)?.contains("HTTP") ?? false
+        } else {
+            false
+        }
+
+        guard isHTTP else {
+            // request line of an HTTP request that didn't fully arrive yet
+            if HTTP_METHODS.contains(where: { buffer.starts(with: $0) }) {
+                return nil
+            }
+
+            if buffer.contains(CLISession.NEWLINE) {
+                return CLIRequest(http: false, key: nil, line: takeLine(from: &buffer)?.trimmed, escaped: true)
+            }
+            guard complete else { return nil }
+
+            let line = String(data: buffer, encoding: .utf8)?.trimmed
+            buffer.removeAll(keepingCapacity: true)
+            if line == nil {
+                log.error("CLI: Error decoding response...")
+            }
+            return CLIRequest(http: false, key: nil, line: line)
+        }
+
+        guard let headerEnd = buffer.range(of: HEADER_END),
+              let header = String(data: buffer[buffer.startIndex ..< headerEnd.lowerBound], encoding: .utf8)
+        else { return nil }
+
+        let headers = header.split(separator: "\r\n").dropFirst().compactMap { line -> (String, String)? in
+            let parts = line.split(separator: ":", maxSplits: 1, omittingEmptySubsequences: true)
+            guard parts.count == 2 else { return nil }
+            return (parts[0].lowercased().trimmed, parts[1].s.trimmed)
+        }
+        let contentLength = headers.first(where: { $0.0 == "content-length" })?.1.i ?? 0
+
+        let bodyStart = headerEnd.upperBound
+        guard buffer.endIndex - bodyStart >= contentLength else { return nil }
+
+        let body = String(data: buffer[bodyStart ..< bodyStart + contentLength], encoding: .utf8)?.trimmed
+        buffer = Data(buffer[(bodyStart + contentLength)...])
+
+        var line = body?.isEmpty ?? true ? nil : body
+        if let l = line, l.starts(with: "cmd=") {
+            line = l.suffix(l.count - 4).replacingOccurrences(of: "+", with: " ").removingPercentEncoding
+        }
+        // GET /metrics?x=y HTTP/1.1
+        let target = header.prefix { $0 != "\r" }.split(separator: " ").dropFirst().first
+        let path = target?.split(separator: "?", maxSplits: 1, omittingEmptySubsequences: false).first?.s
+        return CLIRequest(http: true, key: headers.first(where: { $0.0 == "authorization" })?.1, line: line, path: path)
+    }
+
+    /// Session lines and raw requests are newline terminated and can be longer than one read
+    static func takeLine(from buffer: inout Data) -> String? {
+        guard let end = buffer.firstIndex(of: CLISession.NEWLINE) else { return nil }
+
+        let line = String(decoding: buffer[buffer.startIndex ..< end], as: UTF8.self)
+        buffer = Data(buffer[(end + 1)...])
+        return line
+    }
+}
+
 struct DisplayStateChange: Equatable {
     var property: String
     var value: Double
@@ -2900,8 +3805,6 @@ struct DisplayStateChange: Equatable {
 
 var isServer = false
 var isShortcut = false
-var serverOutput = ""
-var serverExitCode: Int32 = 0
 var serverHTTP = false
 func cliSleep(_ time: TimeInterval) {
     guard !isServer else { return }
@@ -2910,10 +3813,11 @@ func cliSleep(_ time: TimeInterval) {
 
 func cliExit(_ code: Int32) {
     guard !isServer else {
-        if serverOutput.isEmpty {
-            serverOutput = "\n"
+        guard let output = CLIOutput.current else { return }
+        if output.text.isEmpty {
+            output.text = "\n"
         }
-        serverExitCode = code
+        output.exitCode = code
         return
     }
     exit(code)
@@ -2924,7 +3828,7 @@ func cliPrint(_ s: Any, terminator: String = "\n") {
         #if DEBUG
             log.debug("CLI: \(s)\(terminator)")
         #endif
-        serverOutput += "\(s)\(terminator)"
+        CLIOutput.current?.text += "\(s)\(terminator)"
         return
     }
     print(s, terminator: terminator)
@@ -0,0 +1,354 @@
+//
+//  CLIBroadcaster.swift
+//  Lunar
+//
+//  Created by Alin Panaitiu on 19.10.2026.
+//  Copyright © 2026 Alin. All rights reserved.
+//
+
+import Combine
+import CoreGraphics
+import Foundation
+
+// MARK: - CLIEventRing
+
+/// Bounded queue of encoded events waiting to be written to one subscriber.
+///
+/// An event for a `(display, property)` that is still waiting replaces the older one in place,
+/// so a listener that falls behind gets the latest values instead of a backlog.
+/// When the ring is full of distinct keys, the oldest event is dropped.
+struct CLIEventRing {
+    init(capacity: Int) {
+        self.capacity = capacity
+        slots = Array(repeating: nil, count: capacity)
+    }
+
+    struct Key: Hashable {
+        let display: CGDirectDisplayID
+        let property: String
+    }
+
+    struct Event {
+        let key: Key
+        let bytes: Data
+    }
+
+    enum PushResult {
+        case queued
+        case coalesced
+        case droppedOldest
+    }
+
+    let capacity: Int
+
+    private(set) var count = 0
+
+    var isEmpty: Bool { count == 0 }
+
+    mutating func push(_ event: Event) -> PushResult {
+        if let index = positions[event.key] {
+            slots[index] = event
+            return .coalesced
+        }
+
+        var result = PushResult.queued
+        if count == capacity, popFirst() != nil {
+            result = .droppedOldest
+        }
+
+        let index = (head + count) % capacity
+        slots[index] = event
+        positions[event.key] = index
+        count += 1
+        return result
+    }
+
+    mutating func popFirst() -> Event? {
+        guard count > 0, let event = slots[head] else { return nil }
+
+        slots[head] = nil
+        positions.removeValue(forKey: event.key)
+        head = (head + 1) % capacity
+        count -= 1
+        return event
+    }
+
+    private var slots: [Event?]
+    private var positions: [Key: Int] = [:]
+    private var head = 0
+}
+
+// MARK: - CLIBroadcaster
+
+/// Fans out `lunar listen`, `lunar lux --listen` and DisplayServices notification events to CLI server sockets.
+///
+/// Each event is encoded once per format and the same buffer is queued to every subscriber that wants it.
+/// Subscribers get a bounded `CLIEventRing` and are written with non-blocking sends from a single queue,
+/// so a slow reader only delays itself. A subscriber that can't take any bytes for `EVICT_AFTER` is disconnected.
+final class CLIBroadcaster {
+    enum Topic: Hashable {
+        case lux
+        case displayChanges
+        case displayList
+    }
+
+    enum RawNotification {
+        case brightness
+        case ambientLight
+    }
+
+    enum Format {
+        case lux
+        case text
+        case json
+    }
+
+    struct Metrics {
+        var subscribers = 0
+        var published = 0
+        var encoded = 0
+        var delivered = 0
+        var coalesced = 0
+        var dropped = 0
+        var evicted = 0
+        var bytesWritten = 0
+    }
+
+    static let RING_CAPACITY = 64
+    static let EVICT_AFTER: TimeInterval = 10
+
+    /// Called on the broadcaster queue with sockets that failed or were evicted, the server closes them
+    var onClose: ((Int32) -> Void)?
+
+    var metrics: Metrics {
+        queue.sync {
+            var metrics = counters
+            metrics.subscribers = subscribers.count
+            return metrics
+        }
+    }
+
+    func hasSubscriptions(_ fd: Int32) -> Bool {
+        queue.sync { subscribers[fd].map { !$0.cancellables.isEmpty || !$0.rawBrightness.isEmpty || !$0.rawAmbientLight.isEmpty } ?? false }
+    }
+
+    /// Starts queueing events for `fd`, call before creating the publishers so their current values aren't lost
+    func subscribe(_ fd: Int32) {
+        queue.async { [self] in
+            guard subscribers[fd] == nil else { return }
+            subscribers[fd] = Subscriber(fd: fd)
+        }
+    }
+
+    /// Keeps `cancellable` alive for as long as `fd` is subscribed, replacing the previous one for the same topic
+    func attach(_ cancellable: AnyCancellable, topic: Topic, to fd: Int32) {
+        queue.async { [self] in
+            // the socket went away while the publishers were being set up
+            guard let sub = subscribers[fd] else { return }
+            sub.cancellables[topic] = cancellable
+        }
+    }
+
+    func attach(_ notification: RawNotification, display: CGDirectDisplayID, to fd: Int32) {
+        queue.async { [self] in
+            guard let sub = subscribers[fd] else { return }
+            switch notification {
+            case .brightness:
+                sub.rawBrightness.insert(display)
+            case .ambientLight:
+                sub.rawAmbientLight.insert(display)
+            }
+        }
+    }
+
+    func publish(lux: Double, to fd: Int32) {
+        queue.async { [self] in
+            let key = CLIEventRing.Key(display: 0, property: "lux")
+            enqueue(CLIEventRing.Event(key: key, bytes: encoded(key, value: lux, format: .lux)), to: fd)
+        }
+    }
+
+    func publish(_ change: DisplayStateChange, to fd: Int32, json: Bool) {
+        queue.async { [self] in
+            let key = CLIEventRing.Key(display: change.display, property: change.property)
+            enqueue(CLIEventRing.Event(key: key, bytes: encoded(key, value: change.value, format: json ? .json : .text)), to: fd)
+        }
+    }
+
+    /// Sends a DisplayServices notification to every socket that registered for it on that display
+    func publish(_ change: DisplayStateChange, notification: RawNotification) {
+        queue.async { [self] in
+            let fds = subscribers.values.filter { sub in
+                switch notification {
+                case .brightness: sub.rawBrightness.contains(change.display)
+                case .ambientLight: sub.rawAmbientLight.contains(change.display)
+                }
+            }.map(\.fd)
+
+            let key = CLIEventRing.Key(display: change.display, property: change.property)
+            let bytes = encoded(key, value: change.value, format: .text)
+            for fd in fds {
+                enqueue(CLIEventRing.Event(key: key, bytes: bytes), to: fd)
+            }
+        }
+    }
+
+    /// Synchronous, so nothing is sent to `fd` after the caller closes it
+    func remove(_ fd: Int32) {
+        queue.sync { unsubscribe(fd) }
+    }
+
+    private final class Subscriber {
+        init(fd: Int32) {
+            self.fd = fd
+        }
+
+        let fd: Int32
+        var cancellables: [Topic: AnyCancellable] = [:]
+        var rawBrightness: Set<CGDirectDisplayID> = []
+        var rawAmbientLight: Set<CGDirectDisplayID> = []
+
+        var ring = CLIEventRing(capacity: CLIBroadcaster.RING_CAPACITY)
+        var outgoing = Data()
+        var offset = 0
+        var writeSource: DispatchSourceWrite?
+        var stalledSince: Date?
+    }
+
+    private struct EncodingKey: Hashable {
+        let key: CLIEventRing.Key
+        let format: Format
+    }
+
+    private let queue = DispatchQueue(label: "fyi.lunar.cliServer.broadcast", qos: .userInitiated)
+    private var subscribers: [Int32: Subscriber] = [:]
+    private var counters = Metrics()
+
+    /// Last encoding of each key and format, the per-subscriber Combine sinks publish the same change one after another
+    private var encodings: [EncodingKey: (value: Double, bytes: Data)] = [:]
+
+    private func encoded(_ key: CLIEventRing.Key, value: Double, format: Format) -> Data {
+        counters.published += 1
+
+        let encodingKey = EncodingKey(key: key, format: format)
+        if let cached = encodings[encodingKey], cached.value == value {
+            return cached.bytes
+        }
+
+        let val = key.property == "mute" ? (value == 1 ? "true" : "false") : String(format: "%.3f", value)
+        let line = switch format {
+        case .lux: "\(val)\n"
+        case .text: "\(key.property) \(val) \(key.display)\n"
+        case .json: "{\"\(key.property)\": \(val), \"display\": \(key.display)}\n"
+        }
+
+        let bytes = Data(line.utf8)
+        encodings[encodingKey] = (value, bytes)
+        counters.encoded += 1
+        return bytes
+    }
+
+    private func enqueue(_ event: CLIEventRing.Event, to fd: Int32) {
+        guard let sub = subscribers[fd] else { return }
+
+        if let stalledSince = sub.stalledSince, timeSince(stalledSince) > Self.EVICT_AFTER {
+            log.warning("CLI: Evicting listener \(fd), it hasn't read anything for \(Int(timeSince(stalledSince)))s")
+            counters.evicted += 1
+            disconnect(fd)
+            return
+        }
+
+        switch sub.ring.push(event) {
+        case .queued: break
+        case .coalesced: counters.coalesced += 1
+        case .droppedOldest: counters.dropped += 1
+        }
+
+        // a stalled socket is flushed by its write source once it becomes writable again
+        if sub.writeSource == nil {
+            flush(sub)
+        }
+    }
+
+    /// Writes as much as the socket takes without blocking, everything queued goes out in one send
+    private func flush(_ sub: Subscriber) {
+        while true {
+            if sub.offset >= sub.outgoing.count {
+                sub.outgoing.removeAll(keepingCapacity: true)
+                sub.offset = 0
+                guard !sub.ring.isEmpty else { break }
+
+                while let event = sub.ring.popFirst() {
+                    sub.outgoing.append(event.bytes)
+                    counters.delivered += 1
+                }
+            }
+
+            let written = sub.outgoing.withUnsafeBytes { buf in
+                send(sub.fd, buf.baseAddress! + sub.offset, buf.count - sub.offset, 0)
+            }
+            if written > 0 {
+                sub.offset += written
+                sub.stalledSince = nil
+                counters.bytesWritten += written
+                continue
+            }
+            if written < 0, errno == EINTR {
+                continue
+            }
+            if written < 0, errno == EAGAIN || errno == EWOULDBLOCK {
+                waitForWritable(sub)
+                return
+            }
+
+            #if DEBUG
+                log.debug("CLI: Listener \(sub.fd) went away: \(String(cString: strerror(errno)))")
+            #endif
+            disconnect(sub.fd)
+            return
+        }
+
+        sub.stalledSince = nil
+        sub.writeSource?.cancel()
+        sub.writeSource = nil
+    }
+
+    private func waitForWritable(_ sub: Subscriber) {
+        if sub.stalledSince == nil {
+            sub.stalledSince = Date()
+        }
+        guard sub.writeSource == nil else { return }
+
+        let source = DispatchSource.makeWriteSource(fileDescriptor: sub.fd, queue: queue)
+        source.setEventHandler { [weak self, weak sub] in
+            guard let self, let sub else { return }
+            sub.writeSource?.cancel()
+            sub.writeSource = nil
+            flush(sub)
+        }
+        sub.writeSource = source
+        source.resume()
+    }
+
+    private func disconnect(_ fd: Int32) {
+        unsubscribe(fd)
+        onClose?(fd)
+    }
+
+    private func unsubscribe(_ fd: Int32) {
+        guard let sub = subscribers.removeValue(forKey: fd) else { return }
+
+        sub.writeSource?.cancel()
+        sub.writeSource = nil
+        sub.cancellables.removeAll()
+
+        // other sockets may still listen for the same display
+        let remaining = subscribers.values
+        for id in sub.rawBrightness where !remaining.contains(where: { $0.rawBrightness.contains(id) }) {
+            DisplayServicesUnregisterForBrightnessChangeNotifications(id, id)
+        }
+        for id in sub.rawAmbientLight where !remaining.contains(where: { $0.rawAmbientLight.contains(id) }) {
+            DisplayServicesUnregisterForAmbientLightCompensationNotifications(id, id)
+        }
+    }
+}
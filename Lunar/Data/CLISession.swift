@@ -0,0 +1,229 @@
+//
+//  CLISession.swift
+//  Lunar
+//
+//  Created by Alin Panaitiu on 19.10.2026.
+//  Copyright © 2026 Alin. All rights reserved.
+//
+
+import Foundation
+import Socket
+
+// MARK: - CLISession
+
+/// Pipelined command sessions over a single CLI server connection, used by `lunar batch`.
+///
+/// The client authenticates once, then writes any number of newline terminated requests without waiting for answers:
+///
+///     LUNAR-SESSION/1 <api key>\n
+///     <id>\u{01}<arg>\u{01}<arg>...\n
+///
+/// The server answers the handshake with `LUNAR-SESSION/1 OK\n` and every request, in the order they were sent, with
+/// a header line followed by exactly `<length>` bytes of output:
+///
+///     <id> <exit code> <length>\n<output>
+///
+/// Arguments are separated by `CLI_ARG_SEPARATOR` so they can contain spaces, and `escape`d so a newline inside
+/// an argument doesn't end the request. Requests have no length limit other than the server's `MAX_REQUEST_SIZE`.
+enum CLISession {
+    static let VERSION = "LUNAR-SESSION/1"
+    static let HANDSHAKE = Data("\(VERSION) ".utf8)
+    static let OK = "\(VERSION) OK\n"
+    static let NEWLINE = UInt8(ascii: "\n")
+
+    static func handshake(key: String) -> String {
+        "\(VERSION) \(key)\n"
+    }
+
+    static func request(id: Int, args: [String]) -> String {
+        ([id.s] + args.map(escape)).joined(separator: CLI_ARG_SEPARATOR) + "\n"
+    }
+
+    /// Backslash-escapes `\`, `\n` and `\r`, so a request always fits on one line.
+    /// Works on unicode scalars because `\r\n` is a single `Character`.
+    static func escape(_ arg: String) -> String {
+        guard arg.unicodeScalars.contains(where: { $0 == "\\" || $0 == "\n" || $0 == "\r" }) else { return arg }
+
+        var escaped = String.UnicodeScalarView()
+        for scalar in arg.unicodeScalars {
+            switch scalar {
+            case "\\": escaped.append(contentsOf: "\\\\".unicodeScalars)
+            case "\n": escaped.append(contentsOf: "\\n".unicodeScalars)
+            case "\r": escaped.append(contentsOf: "\\r".unicodeScalars)
+            default: escaped.append(scalar)
+            }
+        }
+        return String(escaped)
+    }
+
+    /// Reverses `escape`, a backslash before any other character is kept as is
+    static func unescape(_ arg: String) -> String {
+        guard arg.unicodeScalars.contains("\\") else { return arg }
+
+        var unescaped = String.UnicodeScalarView()
+        var escaping = false
+        for scalar in arg.unicodeScalars {
+            guard escaping else {
+                if scalar == "\\" {
+                    escaping = true
+                } else {
+                    unescaped.append(scalar)
+                }
+                continue
+            }
+
+            escaping = false
+            switch scalar {
+            case "\\": unescaped.append("\\")
+            case "n": unescaped.append("\n")
+            case "r": unescaped.append("\r")
+            default:
+                unescaped.append("\\")
+                unescaped.append(scalar)
+            }
+        }
+        if escaping {
+            unescaped.append("\\")
+        }
+        return String(unescaped)
+    }
+
+    static func response(id: String, exitCode: Int32, output: String) -> String {
+        "\(id) \(exitCode) \(output.utf8.count)\n\(output)"
+    }
+
+    /// Splits a batch script line into arguments like a shell would for simple quoting: whitespace separates
+    /// arguments, single and double quotes group them. Empty lines and `#` comments give no arguments.
+    static func arguments(_ line: String) -> [String] {
+        var args: [String] = []
+        var current = ""
+        var quote: Character?
+        var inArgument = false
+
+        for char in line.trimmingCharacters(in: .whitespaces) {
+            if let q = quote {
+                if char == q {
+                    quote = nil
+                } else {
+                    current.append(char)
+                }
+                continue
+            }
+
+            switch char {
+            case "#" where !inArgument:
+                return args
+            case "\"", "'":
+                quote = char
+                inArgument = true
+            case " ", "\t":
+                if inArgument {
+                    args.append(current)
+                    current = ""
+                    inArgument = false
+                }
+            default:
+                current.append(char)
+                inArgument = true
+            }
+        }
+        if inArgument {
+            args.append(current)
+        }
+
+        // scripts copied from a terminal usually start with the binary name
+        if args.first == "lunar" {
+            args.removeFirst()
+        }
+        return args
+    }
+}
+
+// MARK: - CLISessionClient
+
+/// Client side of a `CLISession`. `send` and `nextResponse` can be called from different threads,
+/// which is how `lunar batch` keeps writing requests while it prints the answers.
+final class CLISessionClient {
+    init(host: String, port: Int32 = LUNAR_CLI_PORT, key: String) throws {
+        socket = try Socket.create()
+        try socket.connect(to: host, port: port)
+        try socket.write(from: CLISession.handshake(key: key))
+
+        guard let line = try readLine(), line + "\n" == CLISession.OK else {
+            socket.close()
+            throw CLISessionError.unauthorized
+        }
+    }
+
+    deinit {
+        socket.close()
+    }
+
+    struct Response {
+        let id: Int
+        let exitCode: Int32
+        let output: String
+    }
+
+    func send(id: Int, args: [String]) throws {
+        try socket.write(from: CLISession.request(id: id, args: args))
+    }
+
+    /// Blocks until the next response arrived, `nil` if the server closed the connection
+    func nextResponse() throws -> Response? {
+        guard let header = try readLine() else { return nil }
+
+        let parts = header.split(separator: " ")
+        guard parts.count == 3, let id = parts[0].s.i, let exitCode = parts[1].s.i32, let length = parts[2].s.i else {
+            throw CLISessionError.invalidResponse(header)
+        }
+
+        while buffer.count < length {
+            guard try fill() else { return nil }
+        }
+        let output = String(decoding: buffer.prefix(length), as: UTF8.self)
+        buffer.removeFirst(length)
+        return Response(id: id, exitCode: exitCode, output: output)
+    }
+
+    func close() {
+        socket.close()
+    }
+
+    private let socket: Socket
+    private var buffer = Data()
+
+    private func fill() throws -> Bool {
+        try socket.read(into: &buffer) > 0
+    }
+
+    private func readLine() throws -> String? {
+        while true {
+            if let end = buffer.firstIndex(of: CLISession.NEWLINE) {
+                let line = String(decoding: buffer[buffer.startIndex ..< end], as: UTF8.self)
+                buffer.removeSubrange(buffer.startIndex ... end)
+                return line
+            }
+            guard try fill() else { return nil }
+        }
+    }
+}
+
+// MARK: - CLISessionError
+
+enum CLISessionError: Error, CustomStringConvertible {
+    case unauthorized
+    case invalidResponse(String)
+    case connectionClosed
+
+    var description: String {
+        switch self {
+        case .unauthorized:
+            "The running Lunar instance refused the session, check the API key"
+        case let .invalidResponse(header):
+            "Invalid session response: \(header)"
+        case .connectionClosed:
+            "The connection to the running Lunar instance was closed"
+        }
+    }
+}
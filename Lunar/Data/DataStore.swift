@@ -7,6 +7,7 @@
 //
 
 import AnyCodable
+import Atomics
 import Cocoa
 import Combine
 import Defaults
@@ -128,6 +129,18 @@ let APP_SETTINGS: [Defaults.Keys] = [
     .clamshellModeDetection,
     .sleepInClamshellMode,
     .disableCliffDetection,
+    .curveLUTResolution,
+    .luxFiltering,
+    .luxWindowSize,
+    .luxEWMAAlpha,
+    .luxLogThreshold,
+    .luxDeadband,
+    .luxRateLimit,
+    .sensorStreaming,
+    .sensorFilterWindow,
+    .sensorDeltaPercent,
+    .sensorHeartbeatSeconds,
+    .networkMaxInFlight,
     .disableBrightnessObservers,
     .contrastStep,
     .didScrollTextField,
@@ -337,20 +350,16 @@ final class DataStore: NSObject {
             return
         }
 
-        guard var displays = CachedDefaults[.displays] else {
-            CachedDefaults[.displays] = [display]
-            if now { Defaults[.displays] = [display] }
-            return
-        }
-
+        var displays = CachedDefaults[.displays] ?? []
         if let displayIndex = displays.firstIndex(where: { $0.serial == display.serial }) {
             displays[displayIndex] = display
         } else {
             displays.append(display)
         }
 
-        CachedDefaults[.displays] = displays
-        if now { Defaults[.displays] = displays }
+        // only this display is encoded again, the others keep their last encoding
+        CachedDefaults.store(Defaults.Keys.displays.name, Optional(displays))
+        DisplayPersistence.shared.markDirty([display.serial], now: now)
     }
 
     static func firstRunAfterHotkeysUpgrade() {
@@ -488,8 +497,8 @@ final class DataStore: NSObject {
     @discardableResult
     func storeDisplays(_ displays: [Display], now: Bool = false) -> [Display] {
         guard let storedDisplays = self.displays() else {
-            CachedDefaults[.displays] = displays
-            if now { Defaults[.displays] = displays }
+            CachedDefaults.store(Defaults.Keys.displays.name, Optional(displays))
+            DisplayPersistence.shared.markDirty(now: now)
             return displays
         }
         let newDisplaySerials = displays.map(\.serial)
@@ -504,8 +513,8 @@ final class DataStore: NSObject {
         }
 
         let allDisplays = (inactiveDisplays + displays)
-        CachedDefaults[.displays] = allDisplays
-        if now { Defaults[.displays] = allDisplays }
+        CachedDefaults.store(Defaults.Keys.displays.name, Optional(allDisplays))
+        DisplayPersistence.shared.markDirty(now: now)
 
         return allDisplays
     }
@@ -529,39 +538,97 @@ extension AnyCodable: Defaults.Serializable {}
 
 // MARK: - ThreadSafeDictionary
 
+/// Dictionary that is read without locking.
+///
+/// Readers get the current immutable storage with one atomic load. Writers are serialized by a lock,
+/// apply their change to a copy and publish it before returning, so a write is visible to the next read on any thread.
+/// Copying makes writes O(n), which is fine for the small, read-mostly maps this is used for
+/// (DDC faults, I2C controllers, learned curve points).
 final class ThreadSafeDictionary<V: Hashable, T> {
     init(dict: [V: T] = [:]) {
-        storage = dict
+        storage = ManagedAtomic(Storage(dict))
     }
 
     subscript(key: V) -> T? {
-        get { queue.sync { storage[key] } }
-        set {
-            queue.async(flags: .barrier) {
-                self.storage[key] = newValue
-            }
-        }
+        get { storage.load(ordering: .acquiring).dict[key] }
+        set { mutate { $0[key] = newValue } }
+    }
+
+    var count: Int {
+        storage.load(ordering: .acquiring).dict.count
     }
 
     func removeAll() {
-        queue.async(flags: .barrier) {
-            self.storage.removeAll()
-        }
+        mutate { $0.removeAll() }
     }
 
     func removeValue(forKey key: V) {
-        queue.async(flags: .barrier) {
-            self.storage.removeValue(forKey: key)
-        }
+        mutate { $0.removeValue(forKey: key) }
     }
 
+    /// Free to take, the storage is never mutated after it's published
     func snapshot() -> [V: T] {
-        queue.sync { storage }
+        storage.load(ordering: .acquiring).dict
+    }
+
+    /// Atomic read-modify-write of one value, setting it to `nil` removes the key
+    @discardableResult
+    func update<R>(key: V, _ body: (inout T?) -> R) -> R {
+        var result: R!
+        mutate { dict in
+            var value = dict[key]
+            result = body(&value)
+            dict[key] = value
+        }
+        return result
+    }
+
+    /// Applies several changes at once, readers see either none or all of them
+    func mutate(_ block: (inout [V: T]) -> Void) {
+        lock.lock()
+        defer { lock.unlock() }
+
+        var dict = storage.load(ordering: .relaxed).dict
+        block(&dict)
+        storage.store(Storage(dict), ordering: .releasing)
+    }
+
+    private final class Storage: AtomicReference {
+        init(_ dict: [V: T]) {
+            self.dict = dict
+        }
+
+        let dict: [V: T]
+    }
+
+    private let storage: ManagedAtomic<Storage>
+    private let lock = NSRecursiveLock()
+}
+
+// MARK: - SettingsSnapshot
+
+/// Immutable copy of every cached setting, already unboxed to the key's value type.
+///
+/// A change never mutates a snapshot, it publishes a new one with the next `generation`,
+/// so readers can hold on to one and get consistent values across several keys.
+final class SettingsSnapshot: AtomicReference {
+    init(values: [String: Any] = [:], generation: Int = 0) {
+        self.values = values
+        self.generation = generation
     }
 
-    private var storage: [V: T]
-    private let queue = DispatchQueue(label: "ThreadSafeDictionary", attributes: .concurrent)
+    let values: [String: Any]
+    let generation: Int
 
+    subscript<Value: Defaults.Serializable>(key: Defaults.Key<Value>) -> Value? {
+        values[key.name] as? Value
+    }
+
+    func with(_ change: (inout [String: Any]) -> Void) -> SettingsSnapshot {
+        var values = values
+        change(&values)
+        return SettingsSnapshot(values: values, generation: generation + 1)
+    }
 }
 
 // MARK: - CachedDefaults
@@ -592,32 +659,49 @@ enum CachedDefaults {
         .apiKey,
     ]
 
-    static var cache: ThreadSafeDictionary<String, AnyCodable> = ThreadSafeDictionary()
-    static var locks: [String: NSRecursiveLock] = [:]
     static var observers = Set<AnyCancellable>()
-    static var lock = NSRecursiveLock()
-    static var semaphore = DispatchSemaphore(value: 1, name: "Cached Defaults Lock")
 
-    static subscript<Value: Defaults.Serializable>(key: Defaults.Key<Value>) -> Value {
-        get {
-            mainThread {
-                if ISCLI, cache[key.name] == nil {
-                    cacheKey(key)
-                }
+    /// Current settings, reading it is a single atomic load
+    static var snapshot: SettingsSnapshot {
+        current.load(ordering: .acquiring)
+    }
 
-                if let value = cache[key.name]?.value as? Value {
-                    return value
-                }
+    /// Generation of the newest in-memory write of each key, so the echo of an older value being persisted doesn't replace it
+    static let lastWrite = ThreadSafeDictionary<String, Int>()
+
+    /// Generation of the value the main thread is writing to `UserDefaults` right now, per key
+    static var persisting: [String: Int] = [:]
 
-                let value = key.suite[key]
+    /// `true` when the publisher fired for our own write of a value that a newer in-memory write already replaced
+    static func isStaleEcho(_ name: String) -> Bool {
+        guard let persisted = persisting[name], let latest = lastWrite[name] else { return false }
+        return latest > persisted
+    }
 
-                cache[key.name] = AnyCodable(value)
+    static subscript<Value: Defaults.Serializable>(key: Defaults.Key<Value>) -> Value {
+        get {
+            if let value = snapshot[key] {
                 return value
             }
+
+            if ISCLI {
+                mainThread { cacheKey(key, load: false) }
+            }
+            let value = key.suite[key]
+            store(key.name, value)
+            return value
         }
         set {
+            // visible to the next read right away, persisting still happens on the main thread
+            let generation = store(key.name, newValue)
+            lastWrite.update(key: key.name) { $0 = max($0 ?? 0, generation) }
+
+            if key == .displays, newValue as? [Display] != nil {
+                DisplayPersistence.shared.markDirty()
+                return
+            }
+
             mainAsync {
-                cache[key.name] = AnyCodable(newValue)
                 if key == .displays {
                     Defaults.withoutPropagation {
                         key.suite[key] = newValue
@@ -632,7 +716,9 @@ enum CachedDefaults {
                     return
                 }
 
+                persisting[key.name] = generation
                 key.suite[key] = newValue
+                persisting.removeValue(forKey: key.name)
 
                 guard !crumbKeys.contains(key) else { return }
                 crumb("Set \(key.name) to \(newValue)", level: .info, category: "Settings")
@@ -646,29 +732,53 @@ enum CachedDefaults {
     }
 
     static func reset(_ keys: [Defaults._AnyKey]) {
-        lock.around {
-            Defaults.reset(keys)
+        Defaults.reset(keys)
+        update { values in
             for key in keys {
-                cache.removeValue(forKey: key.name)
+                values.removeValue(forKey: key.name)
             }
         }
     }
+
+    /// - Returns: the generation of the snapshot that holds the value
+    @discardableResult
+    static func store(_ name: String, _ value: some Any) -> Int {
+        update { $0[name] = value as Any }
+    }
+
+    private static let current = ManagedAtomic(SettingsSnapshot())
+
+    /// Lock-free: a writer that raced with another one retries its change on top of the newer snapshot
+    @discardableResult
+    private static func update(_ change: (inout [String: Any]) -> Void) -> Int {
+        var expected = current.load(ordering: .acquiring)
+        while true {
+            let desired = expected.with(change)
+            let (exchanged, original) = current.compareExchange(
+                expected: expected,
+                desired: desired,
+                ordering: .acquiringAndReleasing
+            )
+            if exchanged { return desired.generation }
+            expected = original
+        }
+    }
 }
 
 let displayEncodingLock = NSRecursiveLock()
 
 func cacheKey(_ key: Defaults.Key<some Any>, load: Bool = true) {
     if load {
-        CachedDefaults.cache[key.name] = AnyCodable(Defaults[key])
+        CachedDefaults.store(key.name, Defaults[key])
     }
 
-    CachedDefaults.locks[key.name] = NSRecursiveLock()
     if key == .secondPhase {
         decode(gamma: [255, 255, 255])
     }
     Defaults.publisher(key).dropFirst().sink { change in
         // log.debug("Caching \(key.name) = \(change.newValue)")
-        CachedDefaults.cache[key.name] = AnyCodable(change.newValue)
+        guard !CachedDefaults.isStaleEcho(key.name) else { return }
+        CachedDefaults.store(key.name, change.newValue)
 
         guard !CachedDefaults.crumbKeys.contains(key) else { return }
         crumb("Set \(key.name) to \(change.newValue)", level: .info, category: "Settings")
@@ -794,6 +904,8 @@ func initCache() {
     cacheKey(.clamshellModeDetection)
     cacheKey(.sleepInClamshellMode)
     cacheKey(.disableCliffDetection)
+    cacheKey(.curveLUTResolution)
+    cacheKey(.luxFiltering)
     cacheKey(.disableBrightnessObservers)
     cacheKey(.brightnessStep)
     cacheKey(.contrastStep)
@@ -952,6 +1064,14 @@ let mediaKeysPublisher = Defaults.publisher(
     .brightnessHotkeysControlAllMonitors,
     .contrastHotkeysControlAllMonitors
 )
+let curveLUTResolutionPublisher = pub(.curveLUTResolution)
+let luxFilterPublisher = Defaults.publisher(
+    keys: .luxWindowSize,
+    .luxEWMAAlpha,
+    .luxLogThreshold,
+    .luxDeadband,
+    .luxRateLimit
+)
 let silentUpdatePublisher = pub(.silentUpdate)
 let checkForUpdatePublisher = pub(.checkForUpdate)
 let showDummyDisplaysPublisher = pub(.showDummyDisplays)
@@ -966,5 +1086,6 @@ let ddcSleepLongerPublisher = pub(.ddcSleepLonger)
 let ddcSleepFactorPublisher = pub(.ddcSleepFactor)
 let updateChannelPublisher = pub(.updateChannel)
 let sensorHostnamePublisher = pub(.sensorHostname)
+let sensorStreamingPublisher = pub(.sensorStreaming)
 let scheduleTransitionPublisher = pub(.scheduleTransition)
 let fullyAutomatedClockModePublisher = pub(.fullyAutomatedClockMode)
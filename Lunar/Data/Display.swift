@@ -183,6 +183,7 @@ let ALL_DISPLAYS: Display = {
 #endif
 
 let MAX_SMOOTH_STEP_TIME_NS: UInt64 = 90 * 1_000_000 // 90ms
+let MIN_SCHEDULE_STEP_INTERVAL: TimeInterval = 1 // 1s
 
 let PRO_DISPLAY_XDR_NAME = "Pro Display XDR"
 let STUDIO_DISPLAY_NAME = "Studio Display"
@@ -387,8 +388,10 @@ struct GammaTable: Equatable {
 
         guard result == .success else {
             log.error("Error setting Gamma for \(id): \(result)")
+            HealthMetrics.shared.display(id).gammaFailures.increment()
             return false
         }
+        HealthMetrics.shared.display(id).gammaApplications.increment()
         return true
     }
 
@@ -548,19 +551,35 @@ let AUDIO_IDENTIFIER_UUID_PATTERN = "([0-9a-f]{2})([0-9a-f]{2})-([0-9a-f]{4})-[0
         applyBrightnessOnInputChange2 = try (container.decodeIfPresent(Bool.self, forKey: .applyBrightnessOnInputChange2)) ?? true
         applyBrightnessOnInputChange3 = try (container.decodeIfPresent(Bool.self, forKey: .applyBrightnessOnInputChange3)) ?? false
 
-        syncBrightnessMapping = try (container.decodeIfPresent([DisplayUUID: [AutoLearnMapping]].self, forKey: .syncBrightnessMapping)) ?? [:]
-        syncContrastMapping = try (container.decodeIfPresent([DisplayUUID: [AutoLearnMapping]].self, forKey: .syncContrastMapping)) ?? [:]
+        if let curves = try container.decodeIfPresent(DisplayCurves.self, forKey: .curves) {
+            syncBrightnessMapping = curves.syncBrightness.mapValues(\.mapping)
+            syncContrastMapping = curves.syncContrast.mapValues(\.mapping)
 
-        sensorBrightnessMapping = try (container.decodeIfPresent([AutoLearnMapping].self, forKey: .sensorBrightnessMapping)) ?? []
-        sensorContrastMapping = try (container.decodeIfPresent([AutoLearnMapping].self, forKey: .sensorContrastMapping)) ?? SensorMode.DEFAULT_CONTRAST_MAPPING
+            sensorBrightnessMapping = curves.sensorBrightness.mapping
+            sensorContrastMapping = curves.sensorContrast.mapping
 
-        locationBrightnessMapping = try (container.decodeIfPresent([AutoLearnMapping].self, forKey: .locationBrightnessMapping)) ?? LocationMode.DEFAULT_BRIGHTNESS_MAPPING
-        locationContrastMapping = try (container.decodeIfPresent([AutoLearnMapping].self, forKey: .locationContrastMapping)) ?? LocationMode.DEFAULT_CONTRAST_MAPPING
+            locationBrightnessMapping = curves.locationBrightness.mapping
+            locationContrastMapping = curves.locationContrast.mapping
 
-        #if arch(arm64)
-            nitsBrightnessMapping = try (container.decodeIfPresent([AutoLearnMapping].self, forKey: .nitsBrightnessMapping)) ?? []
-            nitsContrastMapping = try (container.decodeIfPresent([AutoLearnMapping].self, forKey: .nitsContrastMapping)) ?? []
-        #endif
+            #if arch(arm64)
+                nitsBrightnessMapping = curves.nitsBrightness?.mapping ?? []
+                nitsContrastMapping = curves.nitsContrast?.mapping ?? []
+            #endif
+        } else {
+            syncBrightnessMapping = try (container.decodeIfPresent([DisplayUUID: [AutoLearnMapping]].self, forKey: .syncBrightnessMapping)) ?? [:]
+            syncContrastMapping = try (container.decodeIfPresent([DisplayUUID: [AutoLearnMapping]].self, forKey: .syncContrastMapping)) ?? [:]
+
+            sensorBrightnessMapping = try (container.decodeIfPresent([AutoLearnMapping].self, forKey: .sensorBrightnessMapping)) ?? []
+            sensorContrastMapping = try (container.decodeIfPresent([AutoLearnMapping].self, forKey: .sensorContrastMapping)) ?? SensorMode.DEFAULT_CONTRAST_MAPPING
+
+            locationBrightnessMapping = try (container.decodeIfPresent([AutoLearnMapping].self, forKey: .locationBrightnessMapping)) ?? LocationMode.DEFAULT_BRIGHTNESS_MAPPING
+            locationContrastMapping = try (container.decodeIfPresent([AutoLearnMapping].self, forKey: .locationContrastMapping)) ?? LocationMode.DEFAULT_CONTRAST_MAPPING
+
+            #if arch(arm64)
+                nitsBrightnessMapping = try (container.decodeIfPresent([AutoLearnMapping].self, forKey: .nitsBrightnessMapping)) ?? []
+                nitsContrastMapping = try (container.decodeIfPresent([AutoLearnMapping].self, forKey: .nitsContrastMapping)) ?? []
+            #endif
+        }
 
         super.init()
 
@@ -953,6 +972,7 @@ let AUDIO_IDENTIFIER_UUID_PATTERN = "([0-9a-f]{2})([0-9a-f]{2})-([0-9a-f]{4})-[0
         case locationContrastMapping
         case nitsBrightnessMapping
         case nitsContrastMapping
+        case curves
 
         case main
         case rotation
@@ -1071,6 +1091,7 @@ let AUDIO_IDENTIFIER_UUID_PATTERN = "([0-9a-f]{2})([0-9a-f]{2})-([0-9a-f]{4})-[0
             .locationContrastMapping,
             .nitsBrightnessMapping,
             .nitsContrastMapping,
+            .curves,
         ]
 
         static var settableWithControl: Set<CodingKeys> = [
@@ -1703,13 +1724,18 @@ let AUDIO_IDENTIFIER_UUID_PATTERN = "([0-9a-f]{2})([0-9a-f]{2})-([0-9a-f]{4})-[0
 
     var isAllDisplays = false
 
-    var syncBrightnessMapping: [DisplayUUID: [AutoLearnMapping]] = [:]
-    var syncContrastMapping: [DisplayUUID: [AutoLearnMapping]] = [:]
-    var sensorBrightnessMapping: [AutoLearnMapping] = SensorMode.DEFAULT_BRIGHTNESS_MAPPING
-    var sensorContrastMapping: [AutoLearnMapping] = SensorMode.DEFAULT_CONTRAST_MAPPING
-    var locationBrightnessMapping: [AutoLearnMapping] = LocationMode.DEFAULT_BRIGHTNESS_MAPPING
-    var locationContrastMapping: [AutoLearnMapping] = LocationMode.DEFAULT_CONTRAST_MAPPING
-    var scheduledBrightnessTask: Repeater? = nil
+    var syncBrightnessMapping: [DisplayUUID: [AutoLearnMapping]] = [:] { didSet { invalidateCompiledCurves() } }
+    var syncContrastMapping: [DisplayUUID: [AutoLearnMapping]] = [:] { didSet { invalidateCompiledCurves() } }
+    var sensorBrightnessMapping: [AutoLearnMapping] = SensorMode.DEFAULT_BRIGHTNESS_MAPPING { didSet { invalidateCompiledCurves() } }
+    var sensorContrastMapping: [AutoLearnMapping] = SensorMode.DEFAULT_CONTRAST_MAPPING { didSet { invalidateCompiledCurves() } }
+    var locationBrightnessMapping: [AutoLearnMapping] = LocationMode.DEFAULT_BRIGHTNESS_MAPPING { didSet { invalidateCompiledCurves() } }
+    var locationContrastMapping: [AutoLearnMapping] = LocationMode.DEFAULT_CONTRAST_MAPPING { didSet { invalidateCompiledCurves() } }
+    var compiledCurves: [String: CompiledCurve] = [:]
+    var locationPlan: BrightnessPlan?
+    let compiledCurvesLock = NSRecursiveLock()
+    var scheduledBrightnessTask: ScheduleWheel.Event? = nil {
+        didSet { if oldValue !== scheduledBrightnessTask { oldValue?.cancel() } }
+    }
     @Published var userMute: Double = 0
 
     @Published @objc dynamic var keepHDREnabled = false
@@ -1885,7 +1911,9 @@ let AUDIO_IDENTIFIER_UUID_PATTERN = "([0-9a-f]{2})([0-9a-f]{2})-([0-9a-f]{4})-[0
     )
     @objc dynamic lazy var subzeroDimmingDisabled = isBuiltin && ((minBrightness.intValue == 0 && softwareBrightness > 0) || !presetSupportsBrightnessControl)
 
-    var scheduledContrastTask: Repeater? = nil
+    var scheduledContrastTask: ScheduleWheel.Event? = nil {
+        didSet { if oldValue !== scheduledContrastTask { oldValue?.cancel() } }
+    }
 
     @Atomic var inSchedule = false
 
@@ -3587,6 +3615,17 @@ let AUDIO_IDENTIFIER_UUID_PATTERN = "([0-9a-f]{2})([0-9a-f]{2})-([0-9a-f]{4})-[0
         }
     }
 
+    /// Date of the next enabled schedule, wrapping around to tomorrow after the last one of the day
+    var nextScheduleDate: Date? {
+        let now = DateInRegion().convertTo(region: Region.local)
+        let dates = schedules.prefix(schedulesToConsider).filter(\.enabled).compactMap(\.dateInRegion)
+
+        if let next = dates.filter({ $0 > now }).min() {
+            return next.date
+        }
+        return dates.min().map { ($0 + 1.days).date }
+    }
+
     var nextSchedule: BrightnessSchedule? {
         let now = DateInRegion().convertTo(region: Region.local)
         return schedules.prefix(schedulesToConsider).filter(\.enabled).sorted().first { sch in
@@ -3628,6 +3667,7 @@ let AUDIO_IDENTIFIER_UUID_PATTERN = "([0-9a-f]{2})([0-9a-f]{2})-([0-9a-f]{4})-[0
     @Published @objc dynamic var name: String {
         didSet {
             context = getContext()
+            HealthMetrics.shared.register(names: [id: name])
             save()
         }
     }
@@ -4408,18 +4448,36 @@ let AUDIO_IDENTIFIER_UUID_PATTERN = "([0-9a-f]{2})([0-9a-f]{2})-([0-9a-f]{4})-[0
         }
 
         let featureValue = featureValue.rounded(to: 4)
-        for (x, y) in values.snapshot() {
-            if (x < featureValue && y >= targetValue) || (x > featureValue && y <= targetValue) {
-                if logValue {
-                    log.debug("Removing data point \(x) => \(y)")
-                }
-                values.removeValue(forKey: x)
+        values.mutate { storage in
+            let removed = insertMonotonic(featureValue, targetValue, in: &storage)
+            guard logValue else { return }
+
+            for (x, y) in removed {
+                log.debug("Removing data point \(x) => \(y)")
             }
-        }
-        if logValue {
             log.debug("Adding data point \(featureValue) => \(targetValue)")
         }
-        values[featureValue] = targetValue
+    }
+
+    /// Adds `featureValue → targetValue` in a single pass over the points, evicting the ones that would break monotonicity:
+    /// lower features with higher or equal targets, and higher features with lower or equal targets.
+    ///
+    /// This is O(n) in the number of points: the adaptive modes read the learned points as an unordered
+    /// `ThreadSafeDictionary`, so there's no ordering to binary search. Curves stay in the tens of points.
+    ///
+    /// - Returns: the evicted points
+    @discardableResult
+    static func insertMonotonic(_ featureValue: Double, _ targetValue: Double, in points: inout [Double: Double]) -> [(Double, Double)] {
+        var removed: [(Double, Double)] = []
+        points = points.filter { x, y in
+            guard x != featureValue else { return false }
+            guard (x < featureValue && y >= targetValue) || (x > featureValue && y <= targetValue) else { return true }
+
+            removed.append((x, y))
+            return false
+        }
+        points[featureValue] = targetValue
+        return removed
     }
 
     static func getSecondaryMirrorScreenID(_ id: CGDirectDisplayID) -> CGDirectDisplayID? {
@@ -4626,6 +4684,92 @@ let AUDIO_IDENTIFIER_UUID_PATTERN = "([0-9a-f]{2})([0-9a-f]{2})-([0-9a-f]{4})-[0
         }
     }
 
+    func compiledBrightnessCurve(_ modeKey: AdaptiveModeKey? = nil) -> CompiledCurve? {
+        compiledCurve(modeKey, contrast: false)
+    }
+
+    func compiledContrastCurve(_ modeKey: AdaptiveModeKey? = nil) -> CompiledCurve? {
+        compiledCurve(modeKey, contrast: true)
+    }
+
+    /// Compiles the curve once per change and caches it until the mapping is edited or the LUT resolution changes
+    func compiledCurve(_ modeKey: AdaptiveModeKey? = nil, contrast: Bool) -> CompiledCurve? {
+        let modeKey = modeKey ?? DC.adaptiveModeKey
+        guard modeKey.usesCurve else { return nil }
+
+        let cacheKey = "\(modeKey.rawValue)-\(contrast ? "contrast" : "brightness")-\(modeKey == .sync ? DC.sourceDisplay.serial : "")"
+
+        return compiledCurvesLock.around {
+            if let curve = compiledCurves[cacheKey] {
+                return curve
+            }
+
+            let mapping = contrast ? contrastCurveMapping(modeKey) : brightnessCurveMapping(modeKey)
+            guard let curve = CompiledCurve(mapping) else {
+                compiledCurves.removeValue(forKey: cacheKey)
+                return nil
+            }
+
+            compiledCurves[cacheKey] = curve
+            return curve
+        }
+    }
+
+    func invalidateCompiledCurves() {
+        compiledCurvesLock.around {
+            compiledCurves.removeAll(keepingCapacity: true)
+            locationPlan = nil
+        }
+    }
+
+    /// Today's Location mode plan, sampled once per minute from `LocationMode.getBrightnessContrast`.
+    /// Rebuilt after midnight, when the curves change or when the range, sub-zero or location changed.
+    func brightnessPlan(for date: Date = Date()) -> BrightnessPlan? {
+        guard let table = LocationMode.specific.geolocation?.solar?.table, table.contains(date) else {
+            compiledCurvesLock.around { locationPlan = nil }
+            return nil
+        }
+
+        let key = BrightnessPlan.Key(
+            minBrightness: minBrightness.doubleValue,
+            maxBrightness: maxBrightness.doubleValue,
+            minContrast: minContrast.doubleValue,
+            maxContrast: maxContrast.doubleValue,
+            subzero: adaptiveSubzero,
+            latitude: table.latitude,
+            longitude: table.longitude
+        )
+        if let plan = compiledCurvesLock.around({ locationPlan }), plan.key == key, plan.contains(date) {
+            return plan
+        }
+
+        // the mode only has minute resolution, and can wait on the main thread so it's never called under the lock
+        let step = max(table.step, 60)
+        let mode = LocationMode.specific
+        let plan = BrightnessPlan(
+            key: key,
+            start: table.start,
+            step: step,
+            count: Int(table.end.timeIntervalSince(table.start) / step) + 1
+        ) { date in
+            let components = Calendar.current.dateComponents([.hour, .minute], from: date)
+            return mode.getBrightnessContrast(display: self, hour: components.hour ?? 0, minute: components.minute ?? 0)
+        }
+
+        compiledCurvesLock.around { locationPlan = plan }
+        return plan
+    }
+
+    /// Location mode brightness and contrast for `date`: one array read plus interpolation
+    func locationTarget(at date: Date = Date()) -> (brightness: Double, contrast: Double)? {
+        brightnessPlan(for: date)?.target(at: date)
+    }
+
+    /// Next time the Location mode target changes by at least one unit of this display's range
+    func locationNextChange(after date: Date = Date()) -> Date? {
+        brightnessPlan(for: date)?.nextChange(after: date)
+    }
+
     func updateCornerWindow() {
         mainThread {
             guard cornerRadius.intValue > 0, active, !isInNonWirelessHardwareMirrorSet,
@@ -5649,16 +5793,20 @@ let AUDIO_IDENTIFIER_UUID_PATTERN = "([0-9a-f]{2})([0-9a-f]{2})-([0-9a-f]{4})-[0
             try container.encode(applyBrightnessOnInputChange2, forKey: .applyBrightnessOnInputChange2)
             try container.encode(applyBrightnessOnInputChange3, forKey: .applyBrightnessOnInputChange3)
 
-            try container.encode(syncBrightnessMapping, forKey: .syncBrightnessMapping)
-            try container.encode(syncContrastMapping, forKey: .syncContrastMapping)
-            try container.encode(sensorBrightnessMapping, forKey: .sensorBrightnessMapping)
-            try container.encode(sensorContrastMapping, forKey: .sensorContrastMapping)
-            try container.encode(locationBrightnessMapping, forKey: .locationBrightnessMapping)
-            try container.encode(locationContrastMapping, forKey: .locationContrastMapping)
-            #if arch(arm64)
-                try container.encode(nitsBrightnessMapping, forKey: .nitsBrightnessMapping)
-                try container.encode(nitsContrastMapping, forKey: .nitsContrastMapping)
-            #endif
+            if encoder.userInfo[.compactCurves] as? Bool == true {
+                try container.encode(DisplayCurves(self), forKey: .curves)
+            } else {
+                try container.encode(syncBrightnessMapping, forKey: .syncBrightnessMapping)
+                try container.encode(syncContrastMapping, forKey: .syncContrastMapping)
+                try container.encode(sensorBrightnessMapping, forKey: .sensorBrightnessMapping)
+                try container.encode(sensorContrastMapping, forKey: .sensorContrastMapping)
+                try container.encode(locationBrightnessMapping, forKey: .locationBrightnessMapping)
+                try container.encode(locationContrastMapping, forKey: .locationContrastMapping)
+                #if arch(arm64)
+                    try container.encode(nitsBrightnessMapping, forKey: .nitsBrightnessMapping)
+                    try container.encode(nitsContrastMapping, forKey: .nitsContrastMapping)
+                #endif
+            }
 
             try container.encode(rotation, forKey: .rotation)
 
@@ -5845,10 +5993,16 @@ let AUDIO_IDENTIFIER_UUID_PATTERN = "([0-9a-f]{2})([0-9a-f]{2})-([0-9a-f]{4})-[0
     func slowBrightnessTransition(from currentValue: Double, to value: Double, over period: DateComponents, adjust: @escaping ((Display, Double) -> Void)) {
         guard currentValue != value else { return }
 
-        var steps = stride(from: currentValue, through: value, by: currentValue < value ? 0.005 : -0.005).map { $0 }
+        var steps = Self.transitionSteps(from: currentValue, to: value, by: 0.005, over: period.timeInterval)
 
         log.debug("Starting slow brightness transition until \(period.fromNow): \(currentValue) -> \(value)")
-        scheduledBrightnessTask = Repeater(every: period.timeInterval / steps.count.d, times: steps.count, name: "scheduledBrightnessSlowTransition", onFinish: { [weak self] in self?.scheduledBrightnessTask = nil }) { [weak self] in
+        scheduledBrightnessTask = ScheduleWheel.shared.repeating(
+            every: period.timeInterval / steps.count.d, times: steps.count, display: serial, kind: .brightnessTransition,
+            onFinish: { [weak self] task in
+                guard let self, scheduledBrightnessTask === task else { return }
+                scheduledBrightnessTask = nil
+            }
+        ) { [weak self] in
             guard !DC.screensSleeping, !DC.locked || DC.allowAdjustmentsWhileLocked, let self, !steps.isEmpty else { return }
 
             self.inSchedule = true
@@ -5860,10 +6014,16 @@ let AUDIO_IDENTIFIER_UUID_PATTERN = "([0-9a-f]{2})([0-9a-f]{2})-([0-9a-f]{4})-[0
     func slowContrastTransition(from currentValue: Double, to value: Double, over period: DateComponents, adjust: @escaping ((Display, Double) -> Void)) {
         guard currentValue != value, !lockedContrast, canChangeContrast else { return }
 
-        var steps = stride(from: currentValue, through: value, by: currentValue < value ? 0.01 : -0.01).map { $0 }
+        var steps = Self.transitionSteps(from: currentValue, to: value, by: 0.01, over: period.timeInterval)
 
         log.debug("Starting slow contrast transition until \(period.fromNow): \(currentValue) -> \(value)")
-        scheduledContrastTask = Repeater(every: period.timeInterval / steps.count.d, times: steps.count, name: "scheduledContrastSlowTransition", onFinish: { [weak self] in self?.scheduledContrastTask = nil }) { [weak self] in
+        scheduledContrastTask = ScheduleWheel.shared.repeating(
+            every: period.timeInterval / steps.count.d, times: steps.count, display: serial, kind: .contrastTransition,
+            onFinish: { [weak self] task in
+                guard let self, scheduledContrastTask === task else { return }
+                scheduledContrastTask = nil
+            }
+        ) { [weak self] in
             guard !DC.screensSleeping, !DC.locked || DC.allowAdjustmentsWhileLocked, let self, !steps.isEmpty else { return }
 
             self.inSchedule = true
@@ -5872,6 +6032,16 @@ let AUDIO_IDENTIFIER_UUID_PATTERN = "([0-9a-f]{2})([0-9a-f]{2})-([0-9a-f]{4})-[0
         }
     }
 
+    /// Evenly spaced values from `currentValue` (exclusive) to `value` (inclusive), `step` apart at most
+    /// and never closer than `MIN_SCHEDULE_STEP_INTERVAL` in time, so short transitions don't wake up the wheel needlessly
+    static func transitionSteps(from currentValue: Double, to value: Double, by step: Double, over period: TimeInterval) -> [Double] {
+        let byValue = Int((abs(value - currentValue) / step).rounded(.up))
+        let byTime = Int(period / MIN_SCHEDULE_STEP_INTERVAL)
+        let count = max(min(byValue, byTime), 1)
+
+        return (1 ... count).map { currentValue + (value - currentValue) * $0.d / count.d }
+    }
+
     func smoothTransition(
         from currentValue: UInt16,
         to value: UInt16,
@@ -5942,6 +6112,7 @@ let AUDIO_IDENTIFIER_UUID_PATTERN = "([0-9a-f]{2})([0-9a-f]{2})-([0-9a-f]{4})-[0
             } catch DDCTransitionError.shouldStop {
                 return
             } catch {
+                HealthMetrics.shared.display(self.id).transitionsAborted.increment()
                 self.inSmoothTransition = false
                 return
             }
@@ -5950,6 +6121,7 @@ let AUDIO_IDENTIFIER_UUID_PATTERN = "([0-9a-f]{2})([0-9a-f]{2})-([0-9a-f]{4})-[0
             #if DEBUG
                 log.debug("It took \(elapsedTimeInterval.ns) to change brightness from \(currentValue) to \(value) by \(step)")
             #endif
+            HealthMetrics.shared.display(self.id).transitions.observe(ns: elapsedTimeInterval.absNS)
             self.checkSlowWrite(elapsedNS: elapsedTimeInterval.absNS / steps.u64)
 
             self.inSmoothTransition = false
@@ -0,0 +1,181 @@
+//
+//  DisplayPersistence.swift
+//  Lunar
+//
+//  Created by Alin Panaitiu on 19.10.2026.
+//  Copyright © 2026 Alin. All rights reserved.
+//
+
+import Defaults
+import Foundation
+
+// MARK: - CompactCurve
+
+/// Curve mapping stored as two columns, `{"x":[...],"y":[...]}` instead of an array of `{"source":..,"target":..}` objects.
+struct CompactCurve: Codable {
+    init(_ mapping: [AutoLearnMapping]) {
+        x = mapping.map(\.source)
+        y = mapping.map(\.target)
+    }
+
+    let x: [Double]
+    let y: [Double]
+
+    var mapping: [AutoLearnMapping] {
+        zip(x, y).map { AutoLearnMapping(source: $0, target: $1) }
+    }
+}
+
+// MARK: - DisplayCurves
+
+/// All the learned curves of a display, written under a single `curves` key instead of the per-mode mapping keys
+/// when encoding with `CodingUserInfoKey.compactCurves`.
+///
+/// Decoding still falls back to the per-mode keys, so settings written by older builds keep their curves.
+struct DisplayCurves: Codable {
+    init(_ display: Display) {
+        syncBrightness = display.syncBrightnessMapping.mapValues(CompactCurve.init)
+        syncContrast = display.syncContrastMapping.mapValues(CompactCurve.init)
+        sensorBrightness = CompactCurve(display.sensorBrightnessMapping)
+        sensorContrast = CompactCurve(display.sensorContrastMapping)
+        locationBrightness = CompactCurve(display.locationBrightnessMapping)
+        locationContrast = CompactCurve(display.locationContrastMapping)
+        #if arch(arm64)
+            nitsBrightness = CompactCurve(display.nitsBrightnessMapping)
+            nitsContrast = CompactCurve(display.nitsContrastMapping)
+        #endif
+    }
+
+    var syncBrightness: [DisplayUUID: CompactCurve]
+    var syncContrast: [DisplayUUID: CompactCurve]
+    var sensorBrightness: CompactCurve
+    var sensorContrast: CompactCurve
+    var locationBrightness: CompactCurve
+    var locationContrast: CompactCurve
+    var nitsBrightness: CompactCurve?
+    var nitsContrast: CompactCurve?
+}
+
+extension CodingUserInfoKey {
+    static let compactCurves = CodingUserInfoKey(rawValue: "compactCurves")!
+}
+
+// MARK: - DisplayPersistence
+
+/// Writes the `displays` setting in batches, re-encoding only the displays that changed since the last write.
+///
+/// Each display is stored by Defaults as its own JSON string, so the encoded string of an unchanged display
+/// is reused as is. Changes are written `DEBOUNCE_MS` after the last one, but never later than
+/// `MAX_DELAY` seconds after the first unwritten change, so a display that keeps changing still gets saved.
+/// Reading goes through the usual `Defaults[.displays]`, which decodes both the compact and the older curve format.
+/// A display that fails to encode keeps its previously written string, and the whole write is skipped if there isn't one.
+final class DisplayPersistence {
+    static let shared = DisplayPersistence()
+
+    static let DEBOUNCE_MS = 1000
+    static let MAX_DELAY: TimeInterval = 10
+
+    /// Marks the displays with these serials as changed and schedules a write, `nil` marks all of them
+    func markDirty(_ serials: [String]? = nil, now: Bool = false) {
+        lock.around {
+            if let serials {
+                dirty.formUnion(serials)
+            } else {
+                allDirty = true
+            }
+        }
+
+        if now {
+            mainThread { flush() }
+        } else {
+            schedule()
+        }
+    }
+
+    /// Writes the changed displays from `CachedDefaults` right away, must be called on the main thread
+    func flush() {
+        let (dirty, allDirty): (Set<String>, Bool) = lock.around {
+            defer {
+                self.dirty.removeAll()
+                self.allDirty = false
+                firstChange = nil
+                pending?.cancel()
+                pending = nil
+            }
+            return (self.dirty, self.allDirty)
+        }
+        guard allDirty || !dirty.isEmpty, let displays = CachedDefaults[.displays] else { return }
+
+        let startedAt = DispatchTime.now()
+        var strings: [String] = []
+        strings.reserveCapacity(displays.count)
+        var bytes = 0
+
+        for display in displays {
+            if !allDirty, !dirty.contains(display.serial), let cached = encoded[display.serial] {
+                strings.append(cached)
+                bytes += cached.utf8.count
+                continue
+            }
+
+            guard let data = try? displayEncoder.encode(display) else {
+                // keep the last string that was written for this display, and never write the list without it
+                if let cached = encoded[display.serial] {
+                    log.error("Could not encode display \(display), keeping its previous state")
+                    strings.append(cached)
+                    bytes += cached.utf8.count
+                    continue
+                }
+                log.error("Could not encode display \(display), not writing displays")
+                lock.around {
+                    self.dirty.formUnion(dirty)
+                    self.allDirty = self.allDirty || allDirty
+                }
+                return
+            }
+            let string = String(decoding: data, as: UTF8.self)
+            encoded[display.serial] = string
+            strings.append(string)
+            bytes += data.count
+            HealthMetrics.shared.displaysEncoded.increment()
+        }
+
+        let serials = Set(displays.map(\.serial))
+        encoded = encoded.filter { serials.contains($0.key) }
+
+        Defaults.withoutPropagation {
+            Defaults.Keys.displays.suite.set(strings, forKey: Defaults.Keys.displays.name)
+        }
+
+        HealthMetrics.shared.displaySaves.observe(ns: DispatchTime.now().uptimeNanoseconds - startedAt.uptimeNanoseconds)
+        HealthMetrics.shared.displayBytesWritten.add(bytes)
+    }
+
+    private let lock = NSRecursiveLock()
+    private var dirty: Set<String> = []
+    private var allDirty = false
+    private var firstChange: Date?
+    private var pending: DispatchWorkItem?
+
+    /// Only touched on the main thread inside `flush`
+    private var encoded: [String: String] = [:]
+
+    private lazy var displayEncoder: JSONEncoder = {
+        let encoder = JSONEncoder()
+        encoder.userInfo[.compactCurves] = true
+        return encoder
+    }()
+
+    private func schedule() {
+        lock.around {
+            let first = firstChange ?? Date()
+            firstChange = first
+
+            let untilDeadline = Int((Self.MAX_DELAY - timeSince(first)) * 1000)
+            pending?.cancel()
+            pending = mainAsyncAfter(ms: max(min(Self.DEBOUNCE_MS, untilDeadline), 0), name: "DisplayPersistence") { [weak self] in
+                self?.flush()
+            }
+        }
+    }
+}
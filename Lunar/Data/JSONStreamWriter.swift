@@ -0,0 +1,289 @@
+//
+//  JSONStreamWriter.swift
+//  Lunar
+//
+//  Created by Alin Panaitiu on 19.10.2026.
+//  Copyright © 2026 Alin. All rights reserved.
+//
+
+import Foundation
+
+// MARK: - JSONStreamWriter
+
+/// Appends JSON tokens straight to a UTF-8 buffer, without building intermediate dictionaries.
+///
+/// Commas are tracked per nesting level, so callers only open and close containers and write keys and values.
+struct JSONStreamWriter {
+    private(set) var bytes = Data()
+
+    var string: String { String(decoding: bytes, as: UTF8.self) }
+
+    mutating func beginObject() {
+        separate()
+        bytes.append(OPEN_BRACE)
+        needsComma.append(false)
+    }
+
+    mutating func endObject() {
+        needsComma.removeLast()
+        bytes.append(CLOSE_BRACE)
+    }
+
+    mutating func key(_ key: String) {
+        separate()
+        quoted(key)
+        bytes.append(COLON)
+        afterKey = true
+    }
+
+    mutating func value(_ value: String) {
+        separate()
+        quoted(value)
+    }
+
+    mutating func value(_ value: Bool) {
+        separate()
+        bytes.append(contentsOf: value ? TRUE : FALSE)
+    }
+
+    mutating func value(_ value: Int64) {
+        separate()
+        bytes.append(contentsOf: String(value).utf8)
+    }
+
+    mutating func value(_ value: UInt64) {
+        separate()
+        bytes.append(contentsOf: String(value).utf8)
+    }
+
+    mutating func value(_ value: some BinaryFloatingPoint & CustomStringConvertible) {
+        separate()
+        guard value.isFinite else {
+            bytes.append(contentsOf: NULL)
+            return
+        }
+        // integral values are written without the trailing `.0`, like JSONEncoder does
+        if value.rounded() == value, abs(value) < 1e15 {
+            bytes.append(contentsOf: String(Int64(value)).utf8)
+        } else {
+            bytes.append(contentsOf: value.description.utf8)
+        }
+    }
+
+    mutating func null() {
+        separate()
+        bytes.append(contentsOf: NULL)
+    }
+
+    /// Writes an already encoded JSON value
+    mutating func raw(_ json: Data) {
+        separate()
+        bytes.append(json)
+    }
+
+    private var needsComma: [Bool] = [false]
+    private var afterKey = false
+
+    private mutating func separate() {
+        if afterKey {
+            afterKey = false
+            return
+        }
+        if needsComma[needsComma.count - 1] {
+            bytes.append(COMMA)
+        }
+        needsComma[needsComma.count - 1] = true
+    }
+
+    private mutating func quoted(_ string: String) {
+        bytes.append(QUOTE)
+        for byte in string.utf8 {
+            switch byte {
+            case QUOTE: bytes.append(contentsOf: [BACKSLASH, QUOTE])
+            case BACKSLASH: bytes.append(contentsOf: [BACKSLASH, BACKSLASH])
+            case UInt8(ascii: "\n"): bytes.append(contentsOf: [BACKSLASH, UInt8(ascii: "n")])
+            case UInt8(ascii: "\r"): bytes.append(contentsOf: [BACKSLASH, UInt8(ascii: "r")])
+            case UInt8(ascii: "\t"): bytes.append(contentsOf: [BACKSLASH, UInt8(ascii: "t")])
+            case 0 ..< 0x20: bytes.append(contentsOf: String(format: "\\u%04x", byte).utf8)
+            default: bytes.append(byte)
+            }
+        }
+        bytes.append(QUOTE)
+    }
+}
+
+private let OPEN_BRACE = UInt8(ascii: "{")
+private let CLOSE_BRACE = UInt8(ascii: "}")
+private let COLON = UInt8(ascii: ":")
+private let COMMA = UInt8(ascii: ",")
+private let QUOTE = UInt8(ascii: "\"")
+private let BACKSLASH = UInt8(ascii: "\\")
+private let TRUE = Array("true".utf8)
+private let FALSE = Array("false".utf8)
+private let NULL = Array("null".utf8)
+
+// MARK: - ProjectingEncoder
+
+/// Runs a value's `encode(to:)` but keeps only the requested top level keys, each written to a `JSONStreamWriter`.
+///
+/// Values of the skipped keys are never encoded, so projecting a few scalar fields of a `Display`
+/// doesn't pay for serializing its curve mappings, schedules and hotkeys.
+/// Nested values of requested keys fall back to `JSONEncoder`.
+final class ProjectingEncoder: Encoder {
+    init(fields: [String]) {
+        self.fields = Set(fields)
+    }
+
+    let fields: Set<String>
+
+    var codingPath: [CodingKey] = []
+    var userInfo: [CodingUserInfoKey: Any] = [:]
+
+    /// JSON encoding of each requested field that the value wrote, fields it didn't write are missing
+    var fragments: [String: Data] = [:]
+
+    /// Encodes `value` and writes the requested fields as one object, in the order of `fields`
+    static func write(_ value: Encodable, fields: [String], to writer: inout JSONStreamWriter) throws {
+        let projection = ProjectingEncoder(fields: fields)
+        try value.encode(to: projection)
+
+        writer.beginObject()
+        for field in fields {
+            guard let fragment = projection.fragments[field] else { continue }
+            writer.key(field)
+            writer.raw(fragment)
+        }
+        writer.endObject()
+    }
+
+    func container<Key>(keyedBy _: Key.Type) -> KeyedEncodingContainer<Key> where Key: CodingKey {
+        KeyedEncodingContainer(Container(projection: self))
+    }
+
+    /// Only keyed top level values can be projected, anything else is discarded
+    func unkeyedContainer() -> UnkeyedEncodingContainer {
+        Discarding<DiscardedKey>(codingPath: codingPath)
+    }
+
+    func singleValueContainer() -> SingleValueEncodingContainer {
+        Discarding<DiscardedKey>(codingPath: codingPath)
+    }
+
+    private struct Container<Key: CodingKey>: KeyedEncodingContainerProtocol {
+        let projection: ProjectingEncoder
+
+        var codingPath: [CodingKey] { projection.codingPath }
+
+        mutating func encodeNil(forKey key: Key) throws { write(key) { $0.null() } }
+        mutating func encode(_ value: Bool, forKey key: Key) throws { write(key) { $0.value(value) } }
+        mutating func encode(_ value: String, forKey key: Key) throws { write(key) { $0.value(value) } }
+        mutating func encode(_ value: Double, forKey key: Key) throws { write(key) { $0.value(value) } }
+        mutating func encode(_ value: Float, forKey key: Key) throws { write(key) { $0.value(value) } }
+        mutating func encode(_ value: Int, forKey key: Key) throws { write(key) { $0.value(Int64(value)) } }
+        mutating func encode(_ value: Int8, forKey key: Key) throws { write(key) { $0.value(Int64(value)) } }
+        mutating func encode(_ value: Int16, forKey key: Key) throws { write(key) { $0.value(Int64(value)) } }
+        mutating func encode(_ value: Int32, forKey key: Key) throws { write(key) { $0.value(Int64(value)) } }
+        mutating func encode(_ value: Int64, forKey key: Key) throws { write(key) { $0.value(value) } }
+        mutating func encode(_ value: UInt, forKey key: Key) throws { write(key) { $0.value(UInt64(value)) } }
+        mutating func encode(_ value: UInt8, forKey key: Key) throws { write(key) { $0.value(UInt64(value)) } }
+        mutating func encode(_ value: UInt16, forKey key: Key) throws { write(key) { $0.value(UInt64(value)) } }
+        mutating func encode(_ value: UInt32, forKey key: Key) throws { write(key) { $0.value(UInt64(value)) } }
+        mutating func encode(_ value: UInt64, forKey key: Key) throws { write(key) { $0.value(value) } }
+
+        mutating func encode(_ value: some Encodable, forKey key: Key) throws {
+            guard projection.fields.contains(key.stringValue) else { return }
+            projection.fragments[key.stringValue] = try encoder.encode(value)
+        }
+
+        mutating func nestedContainer<NestedKey>(keyedBy _: NestedKey.Type, forKey key: Key) -> KeyedEncodingContainer<NestedKey> where NestedKey: CodingKey {
+            guard projection.fields.contains(key.stringValue) else {
+                return KeyedEncodingContainer(Discarding<NestedKey>(codingPath: codingPath + [key]))
+            }
+            return KeyedEncodingContainer(Nested<NestedKey>(projection: projection, key: key.stringValue, codingPath: codingPath + [key]))
+        }
+
+        mutating func nestedUnkeyedContainer(forKey key: Key) -> UnkeyedEncodingContainer {
+            Discarding<Key>(codingPath: codingPath + [key])
+        }
+
+        mutating func superEncoder() -> Encoder { projection }
+        mutating func superEncoder(forKey _: Key) -> Encoder { projection }
+
+        private func write(_ key: Key, _ body: (inout JSONStreamWriter) -> Void) {
+            guard projection.fields.contains(key.stringValue) else { return }
+
+            var writer = JSONStreamWriter()
+            body(&writer)
+            projection.fragments[key.stringValue] = writer.bytes
+        }
+    }
+
+    /// Nested object of a requested field, its members are encoded whole and merged into one fragment
+    private struct Nested<Key: CodingKey>: KeyedEncodingContainerProtocol {
+        let projection: ProjectingEncoder
+        let key: String
+        let codingPath: [CodingKey]
+
+        mutating func encodeNil(forKey key: Key) throws { try append(key, Data("null".utf8)) }
+        mutating func encode(_ value: some Encodable, forKey key: Key) throws { try append(key, encoder.encode(value)) }
+
+        mutating func nestedContainer<NestedKey>(keyedBy _: NestedKey.Type, forKey key: Key) -> KeyedEncodingContainer<NestedKey> where NestedKey: CodingKey {
+            KeyedEncodingContainer(Discarding<NestedKey>(codingPath: codingPath + [key]))
+        }
+
+        mutating func nestedUnkeyedContainer(forKey key: Key) -> UnkeyedEncodingContainer {
+            Discarding<Key>(codingPath: codingPath + [key])
+        }
+
+        mutating func superEncoder() -> Encoder { projection }
+        mutating func superEncoder(forKey _: Key) -> Encoder { projection }
+
+        private func append(_ member: Key, _ json: Data) throws {
+            var writer = JSONStreamWriter()
+            writer.beginObject()
+            if let existing = projection.fragments[key], existing.count > 2 {
+                // reopen the object written by the previous member
+                writer.raw(existing.dropFirst().dropLast())
+            }
+            writer.key(member.stringValue)
+            writer.raw(json)
+            writer.endObject()
+            projection.fragments[key] = writer.bytes
+        }
+    }
+
+    private struct Discarding<Key: CodingKey>: KeyedEncodingContainerProtocol, UnkeyedEncodingContainer, SingleValueEncodingContainer {
+        init(codingPath: [CodingKey]) {
+            self.codingPath = codingPath
+        }
+
+        let codingPath: [CodingKey]
+        var count = 0
+
+        mutating func encodeNil(forKey _: Key) throws {}
+        mutating func encode(_: some Encodable, forKey _: Key) throws {}
+        mutating func encodeNil() throws {}
+        mutating func encode(_: some Encodable) throws {}
+
+        mutating func nestedContainer<NestedKey>(keyedBy _: NestedKey.Type, forKey _: Key) -> KeyedEncodingContainer<NestedKey> where NestedKey: CodingKey {
+            KeyedEncodingContainer(Discarding<NestedKey>(codingPath: codingPath))
+        }
+
+        mutating func nestedContainer<NestedKey>(keyedBy _: NestedKey.Type) -> KeyedEncodingContainer<NestedKey> where NestedKey: CodingKey {
+            KeyedEncodingContainer(Discarding<NestedKey>(codingPath: codingPath))
+        }
+
+        mutating func nestedUnkeyedContainer(forKey _: Key) -> UnkeyedEncodingContainer { self }
+        mutating func nestedUnkeyedContainer() -> UnkeyedEncodingContainer { self }
+        mutating func superEncoder(forKey _: Key) -> Encoder { ProjectingEncoder(fields: []) }
+        mutating func superEncoder() -> Encoder { ProjectingEncoder(fields: []) }
+    }
+}
+
+private struct DiscardedKey: CodingKey {
+    init?(stringValue: String) { self.stringValue = stringValue }
+    init?(intValue _: Int) { return nil }
+
+    let stringValue: String
+    var intValue: Int? { nil }
+}
@@ -243,6 +243,7 @@ private func sampleMainThread() -> String? {
 
 func onAppHangDetected() {
     log.warning("App Hanging!")
+    HealthMetrics.shared.mainThreadHangs.increment()
 
     let mainThreadStack = sampleMainThread()
     if let mainThreadStack {
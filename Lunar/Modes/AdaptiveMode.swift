@@ -10,6 +10,7 @@ import Accelerate
 import ArgumentParser
 import Atomics
 import Cocoa
+import Combine
 import Defaults
 import Foundation
 import Surge
@@ -239,13 +240,66 @@ let adaptiveModeMenuValidator = AdaptiveModeMenuValidator()
 
 @MainActor
 final class AdaptiveModeInfo: ObservableObject {
-    init() {}
+    init() {
+        $lux.compactMap { $0 }.sink { [weak self] lux in
+            guard let self, !luxStreamConnected || receivingStreamedLux else { return }
+            record(lux: lux)
+        }.store(in: &observers)
+
+        luxFilterPublisher.debounce(for: .milliseconds(500), scheduler: RunLoop.main).sink { _ in
+            LuxStatistics.shared.reconfigure()
+        }.store(in: &observers)
+    }
 
     @Published var lux: Double?
     @Published var luxWindowAverage: Double?
 
+    /// Sliding median + EWMA of `lux`, only updated when it moves past the perceptual threshold
+    @Published var filteredLux: Double?
+    @Published var luxMedian: Double?
+    @Published var luxEWMA: Double?
+
     @Published var nits: Double?
     @Published var sunElevation: Double?
+
+    var observers: Set<AnyCancellable> = []
+    var luxFlusher: DispatchWorkItem? { didSet { oldValue?.cancel() } }
+
+    /// Set while `SensorEventStream` is connected. Sensor mode keeps polling in that case, so its values
+    /// are still shown in `lux` but only the streamed ones are recorded, to avoid counting each reading twice.
+    var luxStreamConnected = false
+
+    func stream(lux value: Double) {
+        receivingStreamedLux = true
+        lux = value
+        receivingStreamedLux = false
+    }
+
+    func record(lux: Double) {
+        HealthMetrics.shared.luxSamples.increment()
+        guard CachedDefaults[.luxFiltering] else { return }
+
+        let stats = LuxStatistics.shared
+        if let value = stats.push(lux) {
+            publish(filteredLux: value)
+        } else if stats.hasPending {
+            luxFlusher = mainAsyncAfter(ms: Int(stats.rateLimit * 1000) + 10) { [weak self] in
+                guard let self, let value = LuxStatistics.shared.flush() else { return }
+                publish(filteredLux: value)
+            }
+        }
+
+        let snapshot = stats.snapshot
+        luxMedian = snapshot.median
+        luxEWMA = snapshot.ewma
+    }
+
+    private var receivingStreamedLux = false
+
+    private func publish(filteredLux value: Double) {
+        HealthMetrics.shared.luxFiltered.increment()
+        filteredLux = value
+    }
 }
 
 @MainActor
@@ -0,0 +1,89 @@
+//
+//  BrightnessPlan.swift
+//  Lunar
+//
+//  Created by Alin Panaitiu on 19.10.2026.
+//  Copyright © 2026 Alin. All rights reserved.
+//
+
+import Foundation
+
+// MARK: - BrightnessPlan
+
+/// Location mode targets for a whole day at minute resolution, sampled from the mode's own function.
+///
+/// Values are in the display's range, so the plan is only valid for the `key` it was built with.
+struct BrightnessPlan {
+    init?(key: Key, start: Date, step: TimeInterval, count: Int, evaluate: (Date) -> (brightness: Double, contrast: Double)) {
+        guard count > 1, step > 0 else { return nil }
+
+        self.key = key
+        self.start = start
+        self.step = step
+
+        var brightness = [Float](repeating: 0, count: count)
+        var contrast = [Float](repeating: 0, count: count)
+        for i in 0 ..< count {
+            let target = evaluate(start.addingTimeInterval(step * i.d))
+            brightness[i] = target.brightness.f
+            contrast[i] = target.contrast.f
+        }
+        self.brightness = brightness
+        self.contrast = contrast
+    }
+
+    /// Everything besides the curves and the date that the targets depend on
+    struct Key: Equatable {
+        let minBrightness: Double
+        let maxBrightness: Double
+        let minContrast: Double
+        let maxContrast: Double
+        let subzero: Bool
+        let latitude: Double
+        let longitude: Double
+    }
+
+    let key: Key
+    let start: Date
+    let step: TimeInterval
+    let brightness: [Float]
+    let contrast: [Float]
+
+    var count: Int { brightness.count }
+    var end: Date { start.addingTimeInterval(step * (count - 1).d) }
+
+    func contains(_ date: Date) -> Bool {
+        date >= start && date <= end
+    }
+
+    /// Brightness and contrast at `date`, interpolated between the two nearest samples
+    func target(at date: Date) -> (brightness: Double, contrast: Double)? {
+        guard contains(date) else { return nil }
+
+        let pos = date.timeIntervalSince(start) / step
+        let i = min(Int(pos), count - 2)
+        let frac = pos - i.d
+
+        let br = brightness[i].d + frac * (brightness[i + 1].d - brightness[i].d)
+        let cr = contrast[i].d + frac * (contrast[i + 1].d - contrast[i].d)
+        return (br, cr)
+    }
+
+    /// First sample after `date` where brightness or contrast moved by at least the given thresholds
+    /// relative to the value at `date`.
+    ///
+    /// Returns `nil` when nothing changes until the end of the plan.
+    func nextChange(after date: Date, brightnessThreshold: Double = 1, contrastThreshold: Double = 1) -> Date? {
+        guard let current = target(at: date) else { return nil }
+
+        let from = Int((date.timeIntervalSince(start) / step).rounded(.down)) + 1
+        guard from < count else { return nil }
+
+        for i in from ..< count {
+            if abs(brightness[i].d - current.brightness) >= brightnessThreshold || abs(contrast[i].d - current.contrast) >= contrastThreshold {
+                return start.addingTimeInterval(step * i.d)
+            }
+        }
+        return nil
+    }
+}
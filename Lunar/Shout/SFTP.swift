@@ -11,13 +11,35 @@ import Foundation
 
 /// Manages an SFTP session
 final class SFTP {
-    init(session: Session, cSession: OpaquePointer) throws {
+    /// Bytes moved so far by an upload or download and the average throughput since it started
+    struct TransferProgress {
+        let bytes: Int
+        let total: Int?
+        let elapsed: TimeInterval
+
+        var bytesPerSecond: Double {
+            elapsed > 0 ? bytes.d / elapsed : 0
+        }
+
+        var fraction: Double? {
+            guard let total, total > 0 else { return nil }
+            return bytes.d / total.d
+        }
+    }
+
+    init(session: Session, cSession: OpaquePointer, ssh: SSH? = nil) throws {
+        let lock = ssh?.lock ?? NSRecursiveLock()
+        lock.lock()
+        defer { lock.unlock() }
+
         guard let sftpSession = libssh2_sftp_init(cSession) else {
             throw SSHError.mostRecentError(session: cSession, backupMessage: "libssh2_sftp_init failed")
         }
         self.cSession = cSession
         self.sftpSession = sftpSession
         self.session = session
+        self.ssh = ssh
+        self.lock = lock
     }
 
     deinit {
@@ -25,23 +47,48 @@ final class SFTP {
             log.verbose("START DEINIT")
             defer { log.verbose("END DEINIT") }
         #endif
+        lock.lock()
+        defer { lock.unlock() }
         libssh2_sftp_shutdown(sftpSession)
     }
 
+    /// libssh2 splits a read or write bigger than one packet into several SFTP requests that are all kept in flight,
+    /// so larger chunks mean fewer round-trips of idle link on high latency connections.
+    static let DEFAULT_CHUNK_SIZE = 256 * 1024
+
+    /// Bytes handed to libssh2 per read or write call
+    var chunkSize = SFTP.DEFAULT_CHUNK_SIZE {
+        didSet { chunkSize = Swift.max(chunkSize, SFTPHandle.bufferSize) }
+    }
+
     /// Download a file from the remote server to the local device
     ///
+    /// When the remote size is known the local file is created at that size and memory-mapped,
+    /// so libssh2 reads straight into the file's pages without intermediate buffers.
+    ///
     /// - Parameters:
     ///   - remotePath: the path to the existing file on the remote server to download
     ///   - localURL: the location on the local device whether the file should be downloaded to
+    ///   - progress: called after every chunk with the bytes received so far and the throughput
     /// - Throws: SSHError if file can't be created or download fails
-    func download(remotePath: String, localURL: URL) throws {
+    func download(remotePath: String, localURL: URL, progress: ((TransferProgress) -> Void)? = nil) throws {
         let sftpHandle = try SFTPHandle(
             cSession: cSession,
             sftpSession: sftpSession,
+            lock: lock,
             remotePath: remotePath,
             flags: LIBSSH2_FXF_READ,
             mode: 0
         )
+        let start = DispatchTime.now()
+        let report = { (bytes: Int, total: Int?) in
+            progress?(TransferProgress(bytes: bytes, total: total, elapsed: (DispatchTime.now().rawValue - start.rawValue).d / 1_000_000_000))
+        }
+
+        if let size = sftpHandle.size(), size > 0 {
+            try downloadMapped(sftpHandle, size: size, to: localURL, report: report)
+            return
+        }
 
         guard FileManager.default.createFile(atPath: localURL.path, contents: nil, attributes: nil),
               let fileHandle = try? FileHandle(forWritingTo: localURL)
@@ -51,17 +98,24 @@ final class SFTP {
 
         defer { fileHandle.closeFile() }
 
+        let buffer = UnsafeMutableRawPointer.allocate(byteCount: chunkSize, alignment: 16)
+        defer { buffer.deallocate() }
+
+        var received = 0
         var dataLeft = true
         while dataLeft {
-            switch sftpHandle.read() {
-            case let .data(data):
-                fileHandle.write(data)
-            case .done:
+            let result = sftpHandle.read(into: buffer, count: chunkSize)
+            switch result {
+            case 1...:
+                fileHandle.write(Data(bytesNoCopy: buffer, count: result, deallocator: .none))
+                received += result
+                report(received, nil)
+            case 0:
                 dataLeft = false
-            case .eagain:
+            case LIBSSH2_ERROR_EAGAIN.i:
                 break
-            case let .error(error):
-                throw error
+            default:
+                throw SSHError.codeError(code: Int32(result), session: cSession)
             }
         }
     }
@@ -72,10 +126,17 @@ final class SFTP {
     ///   - localURL: the path to the existing file on the local device
     ///   - remotePath: the location on the remote server whether the file should be uploaded to
     ///   - permissions: the file permissions to create the new file with; defaults to FilePermissions.default
+    ///   - progress: called after every chunk with the bytes sent so far and the throughput
     /// - Throws: SSHError if local file can't be read or upload fails
-    func upload(localURL: URL, remotePath: String, permissions: FilePermissions = .default) throws {
+    func upload(
+        localURL: URL,
+        remotePath: String,
+        permissions: FilePermissions = .default,
+        progress: ((TransferProgress) -> Void)? = nil
+    ) throws {
+        // mapped, so the chunks are written to the channel straight from the page cache
         let data = try Data(contentsOf: localURL, options: .alwaysMapped)
-        try upload(data: data, remotePath: remotePath, permissions: permissions)
+        try upload(data: data, remotePath: remotePath, permissions: permissions, progress: progress)
     }
 
     /// Upload data to a file on the remote server
@@ -98,24 +159,38 @@ final class SFTP {
     ///   - data: Data to be uploaded as a file
     ///   - remotePath: the location on the remote server whether the file should be uploaded to
     ///   - permissions: the file permissions to create the new file with; defaults to FilePermissions.default
+    ///   - progress: called after every chunk with the bytes sent so far and the throughput
     /// - Throws: SSHError if upload fails
-    func upload(data: Data, remotePath: String, permissions: FilePermissions = .default) throws {
+    func upload(
+        data: Data,
+        remotePath: String,
+        permissions: FilePermissions = .default,
+        progress: ((TransferProgress) -> Void)? = nil
+    ) throws {
         let sftpHandle = try SFTPHandle(
             cSession: cSession,
             sftpSession: sftpSession,
+            lock: lock,
             remotePath: remotePath,
-            flags: LIBSSH2_FXF_WRITE | LIBSSH2_FXF_CREAT,
+            flags: LIBSSH2_FXF_WRITE | LIBSSH2_FXF_CREAT | LIBSSH2_FXF_TRUNC,
             mode: LIBSSH2_SFTP_S_IFREG | permissions.rawValue
         )
+        let start = DispatchTime.now()
+        let chunkSize = chunkSize
+
+        try data.withUnsafeBytes { (bytes: UnsafeRawBufferPointer) in
+            guard let base = bytes.baseAddress else { return }
 
-        var offset = 0
-        while offset < data.count {
-            let upTo = Swift.min(offset + SFTPHandle.bufferSize, data.count)
-            let subdata = data.subdata(in: offset ..< upTo)
-            if subdata.count > 0 {
-                switch sftpHandle.write(subdata) {
+            var offset = 0
+            while offset < bytes.count {
+                let count = Swift.min(chunkSize, bytes.count - offset)
+                switch sftpHandle.write(base + offset, count: count) {
                 case let .written(bytesSent):
                     offset += bytesSent
+                    progress?(TransferProgress(
+                        bytes: offset, total: bytes.count,
+                        elapsed: (DispatchTime.now().rawValue - start.rawValue).d / 1_000_000_000
+                    ))
                 case .eagain:
                     break
                 case let .error(error):
@@ -131,13 +206,15 @@ final class SFTP {
     ///   - remotePath: the path for the folder, which should be created
     /// - Throws: SSHError if folder can't be created
     func createDirectory(_ path: String) throws {
-        let result = path.withCString { (pointer: UnsafePointer<Int8>) -> Int32 in
-            libssh2_sftp_mkdir_ex(
-                sftpSession,
-                pointer,
-                UInt32(strlen(pointer)),
-                Int(LIBSSH2_SFTP_S_IRWXU | LIBSSH2_SFTP_S_IRGRP | LIBSSH2_SFTP_S_IXGRP | LIBSSH2_SFTP_S_IROTH | LIBSSH2_SFTP_S_IXOTH)
-            )
+        let result = locked {
+            path.withCString { (pointer: UnsafePointer<Int8>) -> Int32 in
+                libssh2_sftp_mkdir_ex(
+                    sftpSession,
+                    pointer,
+                    UInt32(strlen(pointer)),
+                    Int(LIBSSH2_SFTP_S_IRWXU | LIBSSH2_SFTP_S_IRGRP | LIBSSH2_SFTP_S_IXGRP | LIBSSH2_SFTP_S_IROTH | LIBSSH2_SFTP_S_IXOTH)
+                )
+            }
         }
         try handleSFTPCommandResult(result)
     }
@@ -153,9 +230,11 @@ final class SFTP {
         var flag = Int(LIBSSH2_SFTP_RENAME_OVERWRITE)
         if !override { flag = 0 }
 
-        let result = src.withCString { (srcPointer: UnsafePointer<Int8>) -> Int32 in
-            dest.withCString { (destPointer: UnsafePointer<Int8>) -> Int32 in
-                libssh2_sftp_rename_ex(sftpSession, srcPointer, UInt32(strlen(srcPointer)), destPointer, UInt32(strlen(destPointer)), flag)
+        let result = locked {
+            src.withCString { (srcPointer: UnsafePointer<Int8>) -> Int32 in
+                dest.withCString { (destPointer: UnsafePointer<Int8>) -> Int32 in
+                    libssh2_sftp_rename_ex(sftpSession, srcPointer, UInt32(strlen(srcPointer)), destPointer, UInt32(strlen(destPointer)), flag)
+                }
             }
         }
         try handleSFTPCommandResult(result)
@@ -167,8 +246,10 @@ final class SFTP {
     ///   - remotePath: the path of the file, which should be removed
     /// - Throws: SSHError if file can't be deleted
     func removeFile(_ path: String) throws {
-        let result = path.withCString { (pointer: UnsafePointer<Int8>) -> Int32 in
-            libssh2_sftp_unlink_ex(sftpSession, pointer, UInt32(strlen(pointer)))
+        let result = locked {
+            path.withCString { (pointer: UnsafePointer<Int8>) -> Int32 in
+                libssh2_sftp_unlink_ex(sftpSession, pointer, UInt32(strlen(pointer)))
+            }
         }
         try handleSFTPCommandResult(result)
     }
@@ -179,8 +260,10 @@ final class SFTP {
     ///   - remotePath: the path of the folder, which should be removed
     /// - Throws: SSHError if folder can't be deleted
     func removeDirectory(_ path: String) throws {
-        let result = path.withCString { (pointer: UnsafePointer<Int8>) -> Int32 in
-            libssh2_sftp_rmdir_ex(sftpSession, pointer, UInt32(strlen(pointer)))
+        let result = locked {
+            path.withCString { (pointer: UnsafePointer<Int8>) -> Int32 in
+                libssh2_sftp_rmdir_ex(sftpSession, pointer, UInt32(strlen(pointer)))
+            }
         }
         try handleSFTPCommandResult(result)
     }
@@ -189,6 +272,7 @@ final class SFTP {
         let sftpHandle = try SFTPHandle(
             cSession: cSession,
             sftpSession: sftpSession,
+            lock: lock,
             remotePath: directory,
             flags: LIBSSH2_FXF_READ,
             mode: 0,
@@ -222,11 +306,15 @@ final class SFTP {
         init(
             cSession: OpaquePointer,
             sftpSession: OpaquePointer,
+            lock: NSRecursiveLock,
             remotePath: String,
             flags: Int32,
             mode: Int32,
             openType: Int32 = LIBSSH2_SFTP_OPENFILE
         ) throws {
+            lock.lock()
+            defer { lock.unlock() }
+
             guard let sftpHandle = libssh2_sftp_open_ex(
                 sftpSession,
                 remotePath,
@@ -239,6 +327,7 @@ final class SFTP {
             }
             self.cSession = cSession
             self.sftpHandle = sftpHandle
+            self.lock = lock
         }
 
         deinit {
@@ -246,15 +335,52 @@ final class SFTP {
                 log.verbose("START DEINIT")
                 defer { log.verbose("END DEINIT") }
             #endif
+            lock.lock()
+            defer { lock.unlock() }
             libssh2_sftp_close_handle(sftpHandle)
         }
 
         func read() -> ReadWriteProcessor.ReadResult {
+            lock.lock()
+            defer { lock.unlock() }
+
             let result = libssh2_sftp_read(sftpHandle, &buffer, SFTPHandle.bufferSize)
             return ReadWriteProcessor.processRead(result: result, buffer: &buffer, session: cSession)
         }
 
+        /// Remote file size from `fstat`, `nil` when the server doesn't report it
+        func size() -> Int? {
+            lock.lock()
+            defer { lock.unlock() }
+
+            var attrs = LIBSSH2_SFTP_ATTRIBUTES()
+            guard libssh2_sftp_fstat_ex(sftpHandle, &attrs, 0) == 0,
+                  attrs.flags & UInt(LIBSSH2_SFTP_ATTR_SIZE) != 0
+            else { return nil }
+            return Int(attrs.filesize)
+        }
+
+        /// Reads up to `count` bytes directly into `pointer`, returns the libssh2 result (bytes read, 0 at EOF or an error code)
+        func read(into pointer: UnsafeMutableRawPointer, count: Int) -> Int {
+            lock.lock()
+            defer { lock.unlock() }
+
+            return libssh2_sftp_read(sftpHandle, pointer.assumingMemoryBound(to: Int8.self), count)
+        }
+
+        /// Writes directly from `pointer`, libssh2 keeps one SFTP write request in flight per packet of `count`
+        func write(_ pointer: UnsafeRawPointer, count: Int) -> ReadWriteProcessor.WriteResult {
+            lock.lock()
+            defer { lock.unlock() }
+
+            let result = libssh2_sftp_write(sftpHandle, pointer.assumingMemoryBound(to: Int8.self), count)
+            return ReadWriteProcessor.processWrite(result: result, session: cSession)
+        }
+
         func write(_ data: Data) -> ReadWriteProcessor.WriteResult {
+            lock.lock()
+            defer { lock.unlock() }
+
             let result: Result<Int, SSHError> = data.withUnsafeBytes {
                 guard let unsafePointer = $0.bindMemory(to: Int8.self).baseAddress else {
                     return .failure(SSHError.genericError("SFTP write failed to bind memory"))
@@ -270,6 +396,9 @@ final class SFTP {
         }
 
         func readDir(_ attrs: inout LIBSSH2_SFTP_ATTRIBUTES) -> ReadWriteProcessor.ReadResult {
+            lock.lock()
+            defer { lock.unlock() }
+
             let result = libssh2_sftp_readdir_ex(sftpHandle, &buffer, SFTPHandle.bufferSize, nil, 0, &attrs)
             return ReadWriteProcessor.processRead(result: Int(result), buffer: &buffer, session: cSession)
         }
@@ -280,6 +409,7 @@ final class SFTP {
 
         private let cSession: OpaquePointer
         private let sftpHandle: OpaquePointer
+        private let lock: NSRecursiveLock
         private var buffer = [Int8](repeating: 0, count: SFTPHandle.bufferSize)
     }
 
@@ -289,6 +419,50 @@ final class SFTP {
     // Retain session to ensure it is not freed before the sftp session is closed
     private let session: Session
 
+    /// Pooled SSH session this SFTP session runs on, every libssh2 call holds its lock
+    /// so transfers take turns with the commands of other leases, one read or write at a time
+    private let ssh: SSH?
+    private let lock: NSRecursiveLock
+
+    private func locked<T>(_ body: () throws -> T) rethrows -> T {
+        lock.lock()
+        defer { lock.unlock() }
+        return try body()
+    }
+
+    private func downloadMapped(_ sftpHandle: SFTPHandle, size: Int, to localURL: URL, report: (Int, Int?) -> Void) throws {
+        let fd = open(localURL.path, O_RDWR | O_CREAT | O_TRUNC, 0o644)
+        guard fd >= 0 else {
+            throw SSHError.genericError("couldn't create file at \(localURL.path)")
+        }
+        defer { close(fd) }
+
+        guard ftruncate(fd, off_t(size)) == 0,
+              let map = mmap(nil, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0), map != MAP_FAILED
+        else {
+            throw SSHError.genericError("couldn't map \(size) bytes at \(localURL.path)")
+        }
+        defer { munmap(map, size) }
+
+        var received = 0
+        while received < size {
+            let result = sftpHandle.read(into: map + received, count: Swift.min(chunkSize, size - received))
+            switch result {
+            case 1...:
+                received += result
+                report(received, size)
+            case 0:
+                // the file shrank while downloading
+                ftruncate(fd, off_t(received))
+                return
+            case LIBSSH2_ERROR_EAGAIN.i:
+                break
+            default:
+                throw SSHError.codeError(code: Int32(result), session: cSession)
+            }
+        }
+    }
+
     private func handleSFTPCommandResult(_ result: Int32) throws {
         let processedResult = ReadWriteProcessor.processWrite(result: Int(result), session: cSession)
         switch processedResult {
@@ -44,6 +44,15 @@ final class SSH {
 
     let session: Session
 
+    /// libssh2 sessions aren't thread safe: channels opened by different leases of a pooled session take turns on it.
+    ///
+    /// The session is blocking, so a channel holds the lock from open to close and commands on a shared session run
+    /// one after another, never interleaved. Concurrent commands need separate sessions (different pool keys).
+    let lock = NSRecursiveLock()
+
+    /// `false` once the transport failed or a channel was cancelled or failed mid-transfer, `SSHPool` replaces dead sessions on the next lease
+    private(set) var alive = true
+
     /// Connects to a remote server and opens an SSH session
     ///
     /// - Parameters:
@@ -138,6 +147,9 @@ final class SSH {
 
     /// Execute a command on the remote server
     ///
+    /// Holds `lock` until the channel is closed: a blocking `readData` can't give the session up mid-command,
+    /// so other leases of the same session wait for this command to finish.
+    ///
     /// - Parameters:
     ///   - command: the command to execute
     ///   - output: block handler called every time a chunk of command output is received
@@ -148,7 +160,16 @@ final class SSH {
         onChannelOpened: ((Channel) -> Void)? = nil,
         output: (_ output: String) -> Void
     ) throws -> Int32 {
-        let channel = try session.openCommandChannel()
+        lock.lock()
+        defer { lock.unlock() }
+
+        let channel: Channel
+        do {
+            channel = try session.openCommandChannel()
+        } catch {
+            alive = false
+            throw error
+        }
 
         if let ptyType {
             try channel.requestPty(type: ptyType.rawValue)
@@ -174,11 +195,16 @@ final class SSH {
             case .eagain:
                 break
             case let .error(error):
+                // the session may be left mid-packet, so it must not be leased again
+                alive = false
                 throw error
             }
         }
 
-        if !channel.cancelled {
+        if channel.cancelled {
+            // a cancelled channel leaves unread data on the session
+            alive = false
+        } else {
             try channel.close()
         }
 
@@ -201,6 +227,9 @@ final class SSH {
             throw SSHError.genericError("couldn't open file at \(localURL)")
         }
 
+        lock.lock()
+        defer { lock.unlock() }
+
         let channel = try session.openSCPChannel(fileSize: Int64(fileSize), remotePath: remotePath, permissions: permissions)
 
         inputStream.open()
@@ -228,6 +257,7 @@ final class SSH {
                 case .eagain:
                     break
                 case let .error(error):
+                    alive = false
                     throw error
                 }
             }
@@ -246,7 +276,20 @@ final class SSH {
     /// - Returns: the opened SFTP session
     /// - Throws: SSHError if an SFTP session could not be opened
     func openSftp() throws -> SFTP {
-        try session.openSftp()
+        try lock.aroundThrows { try session.openSftp(ssh: self) }
+    }
+
+    /// Sends a keepalive unless a command is using the session right now, in which case the traffic already keeps it open
+    func keepalive() {
+        guard lock.try() else { return }
+        defer { lock.unlock() }
+
+        do {
+            try session.sendKeepalive()
+        } catch {
+            log.debug("SSH keepalive to \(host):\(port) failed: \(error)")
+            alive = false
+        }
     }
 
     private let sock: Socket
@@ -10,6 +10,9 @@ import Foundation
 // MARK: - SSHAuthMethod
 
 protocol SSHAuthMethod {
+    /// Distinguishes credentials in `SSHPool` keys without keeping secrets in them
+    var poolIdentity: String { get }
+
     func authenticate(ssh: SSH, username: String) throws
 }
 
@@ -26,6 +29,8 @@ struct SSHPassword: SSHAuthMethod {
 
     let password: String
 
+    var poolIdentity: String { "password:\(password.hashValue)" }
+
     func authenticate(ssh: SSH, username: String) throws {
         try ssh.session.authenticate(username: username, password: password)
     }
@@ -39,6 +44,8 @@ struct SSHAgent: SSHAuthMethod {
     /// Creates a new agent-based authentication
     init() {}
 
+    var poolIdentity: String { "agent" }
+
     func authenticate(ssh: SSH, username: String) throws {
         let agent = try ssh.session.openAgent()
         try agent.connect()
@@ -83,6 +90,8 @@ struct SSHKey: SSHAuthMethod {
     let publicKey: String
     let passphrase: String?
 
+    var poolIdentity: String { "key:\(privateKey):\(passphrase?.hashValue ?? 0)" }
+
     func authenticate(ssh: SSH, username: String) throws {
         // If programatically given a passphrase, use it
         if let passphrase {
@@ -0,0 +1,156 @@
+//
+//  SSHPool.swift
+//  Lunar
+//
+//  Created by Alin Panaitiu on 19.10.2026.
+//  Copyright © 2026 Alin. All rights reserved.
+//
+
+import Foundation
+
+// MARK: - SSHPool
+
+/// Reference counted pool of authenticated SSH sessions, keyed by user, host, port and credentials.
+///
+/// Leasing a session that is already open skips the TCP connect, key exchange and authentication,
+/// so running the installer commands one after another (or retrying an install) costs one handshake in total.
+/// Every command still gets its own channel on the shared session, and channels on one session run sequentially
+/// (see `SSH.lock`), which matches how the installers run their commands anyway. Idle sessions are kept alive with
+/// SSH keepalives for `IDLE_TIMEOUT` after their last lease is released, then disconnected.
+final class SSHPool {
+    // MARK: - Lease
+
+    /// Keeps a pooled session open while retained, `release()` or deinit gives it back
+    final class Lease {
+        fileprivate init(ssh: SSH, key: String, pool: SSHPool) {
+            self.ssh = ssh
+            self.key = key
+            self.pool = pool
+        }
+
+        deinit {
+            release()
+        }
+
+        let ssh: SSH
+
+        func release() {
+            guard !released else { return }
+            released = true
+            pool?.release(key, ssh: ssh)
+        }
+
+        private let key: String
+        private weak var pool: SSHPool?
+        private var released = false
+    }
+
+    static let shared = SSHPool()
+
+    static let KEEPALIVE_INTERVAL: UInt32 = 15
+    static let IDLE_TIMEOUT: TimeInterval = 5 * 60
+
+    /// Sessions opened and sessions reused since launch
+    private(set) var connects = 0
+    private(set) var reuses = 0
+
+    func lease(host: String, port: Int32 = 22, username: String, authMethod: SSHAuthMethod) throws -> Lease {
+        let key = "\(username)@\(host):\(port)/\(authMethod.poolIdentity)"
+
+        if let ssh = acquireExisting(key) {
+            return Lease(ssh: ssh, key: key, pool: self)
+        }
+
+        let ssh = try SSH(host: host, port: port)
+        try ssh.authenticate(username: username, authMethod: authMethod)
+        ssh.session.configureKeepalive(interval: Self.KEEPALIVE_INTERVAL)
+
+        lock.around {
+            // another thread may have connected in the meantime, the newest session wins and the old one closes with its last lease
+            entries[key] = Entry(ssh: ssh, refs: 1, idleSince: nil)
+            connects += 1
+            startKeepalive()
+        }
+        return Lease(ssh: ssh, key: key, pool: self)
+    }
+
+    func removeAll() {
+        lock.around {
+            entries.removeAll()
+            timer?.cancel()
+            timer = nil
+        }
+    }
+
+    private struct Entry {
+        let ssh: SSH
+        var refs: Int
+        var idleSince: Date?
+    }
+
+    private let lock = NSRecursiveLock()
+    private let queue = DispatchQueue(label: "fyi.lunar.ssh.pool.queue", qos: .utility)
+    private var entries: [String: Entry] = [:]
+    private var timer: DispatchSourceTimer?
+
+    private func acquireExisting(_ key: String) -> SSH? {
+        lock.around {
+            guard var entry = entries[key] else { return nil }
+            guard entry.ssh.alive else {
+                entries.removeValue(forKey: key)
+                return nil
+            }
+
+            entry.refs += 1
+            entry.idleSince = nil
+            entries[key] = entry
+            reuses += 1
+            return entry.ssh
+        }
+    }
+
+    private func release(_ key: String, ssh: SSH) {
+        lock.around {
+            guard var entry = entries[key], entry.ssh === ssh else { return }
+
+            entry.refs = max(entry.refs - 1, 0)
+            if entry.refs == 0 {
+                entry.idleSince = Date()
+            }
+            entries[key] = entry
+        }
+    }
+
+    private func startKeepalive() {
+        guard timer == nil else { return }
+
+        let timer = DispatchSource.makeTimerSource(queue: queue)
+        timer.schedule(deadline: .now() + .seconds(Int(Self.KEEPALIVE_INTERVAL)), repeating: .seconds(Int(Self.KEEPALIVE_INTERVAL)), leeway: .seconds(1))
+        timer.setEventHandler { [weak self] in self?.tick() }
+        timer.resume()
+        self.timer = timer
+    }
+
+    /// Sends keepalives and drops dead sessions and sessions that were idle for too long
+    private func tick() {
+        let sessions = lock.around { entries.map { ($0.key, $0.value) } }
+
+        for (key, entry) in sessions {
+            if let idleSince = entry.idleSince, timeSince(idleSince) > Self.IDLE_TIMEOUT {
+                lock.around { _ = entries.removeValue(forKey: key) }
+                continue
+            }
+            entry.ssh.keepalive()
+            if !entry.ssh.alive {
+                log.info("Pooled SSH session \(entry.ssh.host):\(entry.ssh.port) died, it will be reopened on the next lease")
+                lock.around { _ = entries.removeValue(forKey: key) }
+            }
+        }
+
+        lock.around {
+            guard entries.isEmpty else { return }
+            timer?.cancel()
+            timer = nil
+        }
+    }
+}
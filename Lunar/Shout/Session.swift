@@ -68,8 +68,22 @@ final class Session {
         try SSHError.check(code: code, session: cSession)
     }
 
-    func openSftp() throws -> SFTP {
-        try SFTP(session: self, cSession: cSession)
+    /// Makes libssh2 send keepalive messages every `interval` seconds when `sendKeepalive()` is called
+    func configureKeepalive(interval: UInt32, wantReply: Bool = true) {
+        libssh2_keepalive_config(cSession, wantReply ? 1 : 0, interval)
+    }
+
+    /// Sends a keepalive if one is due and returns the seconds until the next one
+    @discardableResult
+    func sendKeepalive() throws -> Int32 {
+        var secondsToNext: Int32 = 0
+        let code = libssh2_keepalive_send(cSession, &secondsToNext)
+        try SSHError.check(code: code, session: cSession)
+        return secondsToNext
+    }
+
+    func openSftp(ssh: SSH? = nil) throws -> SFTP {
+        try SFTP(session: self, cSession: cSession, ssh: ssh)
     }
 
     func openCommandChannel() throws -> Channel {
@@ -0,0 +1,166 @@
+//
+//  CompiledCurve.swift
+//  Lunar
+//
+//  Created by Alin Panaitiu on 19.10.2026.
+//  Copyright © 2026 Alin. All rights reserved.
+//
+
+import Accelerate
+import Foundation
+
+// MARK: - CompiledCurve
+
+/// Monotone piecewise-cubic (PCHIP) representation of an `[AutoLearnMapping]` curve,
+/// sampled into a dense lookup table so that evaluation doesn't need to search the data points.
+///
+/// Values outside the learned range are clamped to the first/last data point.
+final class CompiledCurve {
+    init?(_ mapping: [AutoLearnMapping], resolution: Int = CachedDefaults[.curveLUTResolution]) {
+        let points = Dictionary(mapping.map { ($0.source, $0.target) }, uniquingKeysWith: { _, new in new })
+            .filter { $0.key.isFinite && $0.value.isFinite }
+            .sorted(by: { $0.key < $1.key })
+        guard !points.isEmpty else { return nil }
+
+        xs = points.map(\.key)
+        ys = points.map(\.value)
+        slopes = Self.pchipSlopes(xs: xs, ys: ys)
+
+        minX = xs.first!
+        maxX = xs.last!
+        self.resolution = cap(resolution, minVal: 2, maxVal: 1 << 16)
+        step = maxX > minX ? (maxX - minX) / (self.resolution - 1).d : 1
+        lut = Self.sample(xs: xs, ys: ys, slopes: slopes, minX: minX, step: step, count: self.resolution)
+    }
+
+    let xs: [Double]
+    let ys: [Double]
+    let slopes: [Double]
+
+    let minX: Double
+    let maxX: Double
+    let resolution: Int
+    let step: Double
+
+    /// `resolution` samples, plus the last value repeated once so that `vDSP_vlintD` can always read `index + 1`
+    let lut: [Double]
+
+    /// Table lookup with linear interpolation between neighbouring samples: O(1)
+    @inline(__always) func callAsFunction(_ x: Double) -> Double {
+        guard x.isFinite else { return x > 0 ? ys.last! : ys.first! }
+
+        let pos = cap((x - minX) / step, minVal: 0, maxVal: (resolution - 1).d)
+        let i = Int(pos)
+        let frac = pos - i.d
+        return lut[i] + frac * (lut[i + 1] - lut[i])
+    }
+
+    /// Vectorized table lookup for a batch of feature values (chart, simulator), NaN reads as the first data point
+    func evaluate(_ values: [Double]) -> [Double] {
+        guard !values.isEmpty else { return [] }
+
+        // a NaN index would make vDSP_vlintD read outside the table
+        let values = values.contains(where: \.isNaN) ? values.map { $0.isNaN ? minX : $0 } : values
+        var indices = vDSP.add(-minX, values)
+        indices = vDSP.divide(indices, step)
+        indices = vDSP.clip(indices, to: 0 ... (resolution - 1).d)
+
+        var result = [Double](repeating: 0, count: values.count)
+        vDSP_vlintD(lut, indices, 1, &result, 1, vDSP_Length(values.count), vDSP_Length(lut.count))
+        return result
+    }
+
+    /// Evaluates `count` evenly spaced values between `from` and `to` (inclusive)
+    func evaluate(from: Double, to: Double, count: Int) -> [Double] {
+        guard count > 1 else { return count == 1 ? [self(from)] : [] }
+        return evaluate(vDSP.ramp(in: from ... to, count: count))
+    }
+
+    /// Exact evaluation of the cubic Hermite spline, O(log n)
+    func exact(_ x: Double) -> Double {
+        guard xs.count > 1 else { return ys[0] }
+        guard x > minX else { return ys.first! }
+        guard x < maxX else { return ys.last! }
+
+        let k = segment(x)
+        return Self.hermite(x, k: k, xs: xs, ys: ys, slopes: slopes)
+    }
+
+    /// Fritsch-Carlson slopes: keeps the interpolant monotone between data points and avoids overshoot
+    static func pchipSlopes(xs: [Double], ys: [Double]) -> [Double] {
+        let n = xs.count
+        guard n > 1 else { return [0] }
+
+        let h = (0 ..< n - 1).map { xs[$0 + 1] - xs[$0] }
+        let delta = (0 ..< n - 1).map { (ys[$0 + 1] - ys[$0]) / h[$0] }
+        guard n > 2 else { return [delta[0], delta[0]] }
+
+        var d = [Double](repeating: 0, count: n)
+        for k in 1 ..< n - 1 {
+            guard delta[k - 1] * delta[k] > 0 else { continue }
+
+            let w1 = 2 * h[k] + h[k - 1]
+            let w2 = h[k] + 2 * h[k - 1]
+            d[k] = (w1 + w2) / (w1 / delta[k - 1] + w2 / delta[k])
+        }
+
+        d[0] = endSlope(h0: h[0], h1: h[1], delta0: delta[0], delta1: delta[1])
+        d[n - 1] = endSlope(h0: h[n - 2], h1: h[n - 3], delta0: delta[n - 2], delta1: delta[n - 3])
+        return d
+    }
+
+    @inline(__always) private static func endSlope(h0: Double, h1: Double, delta0: Double, delta1: Double) -> Double {
+        let d = ((2 * h0 + h1) * delta0 - h0 * delta1) / (h0 + h1)
+        if d.sign != delta0.sign || delta0 == 0 {
+            return 0
+        }
+        if delta0.sign != delta1.sign, abs(d) > abs(3 * delta0) {
+            return 3 * delta0
+        }
+        return d
+    }
+
+    @inline(__always) private static func hermite(_ x: Double, k: Int, xs: [Double], ys: [Double], slopes: [Double]) -> Double {
+        let h = xs[k + 1] - xs[k]
+        let t = (x - xs[k]) / h
+        let t2 = t * t
+        let t3 = t2 * t
+
+        let h00 = 2 * t3 - 3 * t2 + 1
+        let h10 = t3 - 2 * t2 + t
+        let h01 = -2 * t3 + 3 * t2
+        let h11 = t3 - t2
+        return h00 * ys[k] + h10 * h * slopes[k] + h01 * ys[k + 1] + h11 * h * slopes[k + 1]
+    }
+
+    private static func sample(xs: [Double], ys: [Double], slopes: [Double], minX: Double, step: Double, count: Int) -> [Double] {
+        guard xs.count > 1 else { return [Double](repeating: ys[0], count: count + 1) }
+
+        var lut = [Double](repeating: 0, count: count + 1)
+        var k = 0
+        for i in 0 ..< count {
+            let x = i == count - 1 ? xs.last! : minX + i.d * step
+            while k < xs.count - 2, x > xs[k + 1] {
+                k += 1
+            }
+            lut[i] = hermite(x, k: k, xs: xs, ys: ys, slopes: slopes)
+        }
+        lut[count] = lut[count - 1]
+        return lut
+    }
+
+    /// Index of the segment `[xs[k], xs[k + 1]]` containing `x`
+    private func segment(_ x: Double) -> Int {
+        var lo = 0
+        var hi = xs.count - 1
+        while hi - lo > 1 {
+            let mid = (lo + hi) / 2
+            if xs[mid] <= x {
+                lo = mid
+            } else {
+                hi = mid
+            }
+        }
+        return lo
+    }
+}
@@ -1174,6 +1174,7 @@ final class DisplayController: ObservableObject {
             activeDisplaysByReadableID = activeDisplayList.dict { display in (display.readableID, display) }
             activeDisplaysBySerial = activeDisplayList.dict { display in (display.serial, display) }
             displaysBySerial = displayList.dict { display in (display.serial, display) }
+            HealthMetrics.shared.register(names: displays.mapValues(\.name))
             if CachedDefaults[.autoXdrSensor] {
                 xdrSensorTask = getSensorTask()
             }
@@ -1959,6 +1960,12 @@ final class DisplayController: ObservableObject {
             subzeroContrastEnabled = CachedDefaults[.subzeroContrast]
         }.store(in: &observers)
 
+        curveLUTResolutionPublisher.sink { [self] _ in
+            for d in displayList {
+                d.invalidateCompiledCurves()
+            }
+        }.store(in: &observers)
+
         xdrContrastPublisher.sink { self.xdrContrastEnabled = $0.newValue }.store(in: &observers)
         subzeroContrastPublisher.sink { self.subzeroContrastEnabled = $0.newValue }.store(in: &observers)
         autoXdrPublisher.sink { self.autoXdr = $0.newValue }.store(in: &observers)
@@ -2571,24 +2578,22 @@ final class DisplayController: ObservableObject {
     }
 
     func averageDDCWriteNanoseconds(for id: CGDirectDisplayID, ns: UInt64) {
-        mainAsync { [self] in
-            guard let writens = averageDDCWriteNanoseconds[id], writens > 0 else {
-                averageDDCWriteNanoseconds[id] = ns
+        averageDDCWriteNanoseconds.update(key: id) { writens in
+            guard let current = writens, current > 0 else {
+                writens = ns
                 return
             }
-
-            averageDDCWriteNanoseconds[id] = (writens + ns) / 2
+            writens = (current + ns) / 2
         }
     }
 
     func averageDDCReadNanoseconds(for id: CGDirectDisplayID, ns: UInt64) {
-        mainAsync { [self] in
-            guard let readns = averageDDCReadNanoseconds[id], readns > 0 else {
-                averageDDCReadNanoseconds[id] = ns
+        averageDDCReadNanoseconds.update(key: id) { readns in
+            guard let current = readns, current > 0 else {
+                readns = ns
                 return
             }
-
-            averageDDCReadNanoseconds[id] = (readns + ns) / 2
+            readns = (current + ns) / 2
         }
     }
 
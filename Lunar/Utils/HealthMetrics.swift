@@ -0,0 +1,211 @@
+//
+//  HealthMetrics.swift
+//  Lunar
+//
+//  Created by Alin Panaitiu on 19.10.2026.
+//  Copyright © 2026 Alin. All rights reserved.
+//
+
+import Atomics
+import CoreGraphics
+import Foundation
+
+// MARK: - MetricCounter
+
+final class MetricCounter {
+    var value: Int { count.load(ordering: .relaxed) }
+
+    func increment() {
+        count.wrappingIncrement(ordering: .relaxed)
+    }
+
+    func add(_ amount: Int) {
+        count.wrappingIncrement(by: amount, ordering: .relaxed)
+    }
+
+    private let count = ManagedAtomic<Int>(0)
+}
+
+// MARK: - MetricHistogram
+
+/// Histogram with fixed bucket bounds in seconds.
+///
+/// Observing is a bucket search over a dozen bounds and two relaxed atomic increments,
+/// the cumulative counts Prometheus expects are only computed when rendering.
+final class MetricHistogram {
+    init(bounds: [Double]) {
+        self.bounds = bounds
+        buckets = (0 ... bounds.count).map { _ in ManagedAtomic<Int>(0) }
+    }
+
+    static let LATENCY_BOUNDS: [Double] = [0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5]
+    static let TRANSITION_BOUNDS: [Double] = [0.1, 0.25, 0.5, 1, 2, 3, 5, 10, 30]
+
+    let bounds: [Double]
+
+    func observe(seconds: Double) {
+        let index = bounds.firstIndex { seconds <= $0 } ?? bounds.count
+        buckets[index].wrappingIncrement(ordering: .relaxed)
+        sumMicroseconds.wrappingIncrement(by: Int(max(seconds, 0) * 1_000_000), ordering: .relaxed)
+    }
+
+    func observe(ns: UInt64) {
+        observe(seconds: Double(ns) / 1_000_000_000)
+    }
+
+    func render(_ name: String, labels: String = "", into out: inout String) {
+        let bucketLabels = labels.isEmpty ? "" : "\(labels),"
+        let totalLabels = labels.isEmpty ? "" : "{\(labels)}"
+
+        var cumulative = 0
+        for (bound, bucket) in zip(bounds.map { "\($0)" } + ["+Inf"], buckets) {
+            cumulative += bucket.load(ordering: .relaxed)
+            out += "\(name)_bucket{\(bucketLabels)le=\"\(bound)\"} \(cumulative)\n"
+        }
+        out += "\(name)_sum\(totalLabels) \(Double(sumMicroseconds.load(ordering: .relaxed)) / 1_000_000)\n"
+        out += "\(name)_count\(totalLabels) \(cumulative)\n"
+    }
+
+    private let buckets: [ManagedAtomic<Int>]
+    private let sumMicroseconds = ManagedAtomic<Int>(0)
+}
+
+// MARK: - HealthMetrics
+
+/// Internal health counters served as Prometheus text on the CLI server's `/metrics` endpoint.
+///
+/// Hot paths (DDC reads and writes, gamma tables, lux samples) only do relaxed atomic increments.
+/// Per-display counters live in an immutable registry that is replaced when a new display shows up,
+/// so finding them is an atomic load and a dictionary lookup. Display names used as labels are copied into the registry
+/// by `register(names:)` on the main thread, so a scrape never reads `Display` objects. Everything is formatted on scrape.
+final class HealthMetrics {
+    final class DisplayMetrics {
+        let ddcRead = MetricHistogram(bounds: MetricHistogram.LATENCY_BOUNDS)
+        let ddcWrite = MetricHistogram(bounds: MetricHistogram.LATENCY_BOUNDS)
+        let ddcReadFaults = MetricCounter()
+        let ddcWriteFaults = MetricCounter()
+        let networkWrite = MetricHistogram(bounds: MetricHistogram.LATENCY_BOUNDS)
+        let nativeWrite = MetricHistogram(bounds: MetricHistogram.LATENCY_BOUNDS)
+        let ddcctlWrite = MetricHistogram(bounds: MetricHistogram.LATENCY_BOUNDS)
+        let transitions = MetricHistogram(bounds: MetricHistogram.TRANSITION_BOUNDS)
+        let transitionsAborted = MetricCounter()
+        let gammaApplications = MetricCounter()
+        let gammaFailures = MetricCounter()
+    }
+
+    static let shared = HealthMetrics()
+
+    static let CONTENT_TYPE = "text/plain; version=0.0.4; charset=utf-8"
+
+    let luxSamples = MetricCounter()
+    let luxFiltered = MetricCounter()
+    let mainThreadHangs = MetricCounter()
+    let displaySaves = MetricHistogram(bounds: MetricHistogram.LATENCY_BOUNDS)
+    let displaysEncoded = MetricCounter()
+    let displayBytesWritten = MetricCounter()
+
+    func display(_ id: CGDirectDisplayID) -> DisplayMetrics {
+        if let metrics = registry.load(ordering: .acquiring).displays[id] {
+            return metrics
+        }
+
+        return lock.around {
+            let current = registry.load(ordering: .acquiring)
+            if let metrics = current.displays[id] {
+                return metrics
+            }
+
+            let metrics = DisplayMetrics()
+            var displays = current.displays
+            displays[id] = metrics
+            registry.store(Registry(displays: displays, names: current.names), ordering: .releasing)
+            return metrics
+        }
+    }
+
+    /// Updates the `name` label of the given displays, names of displays that aren't passed are kept
+    func register(names: [CGDirectDisplayID: String]) {
+        lock.around {
+            let current = registry.load(ordering: .acquiring)
+            let merged = current.names.merging(names) { $1 }
+            guard merged != current.names else { return }
+            registry.store(Registry(displays: current.displays, names: merged), ordering: .releasing)
+        }
+    }
+
+    func render() -> String {
+        let current = registry.load(ordering: .acquiring)
+        let displays = current.displays.sorted { $0.key < $1.key }.map { id, metrics in
+            (labels: "display=\"\(id)\",name=\"\(Self.escaped(current.names[id] ?? ""))\"", metrics: metrics)
+        }
+        var out = ""
+
+        func family(_ name: String, _ type: String, _ help: String) {
+            out += "# HELP \(name) \(help)\n# TYPE \(name) \(type)\n"
+        }
+        func counter(_ name: String, _ help: String, _ keyPath: KeyPath<DisplayMetrics, MetricCounter>) {
+            family(name, "counter", help)
+            for (labels, metrics) in displays {
+                out += "\(name){\(labels)} \(metrics[keyPath: keyPath].value)\n"
+            }
+        }
+        func histogram(_ name: String, _ help: String, _ keyPath: KeyPath<DisplayMetrics, MetricHistogram>) {
+            family(name, "histogram", help)
+            for (labels, metrics) in displays {
+                metrics[keyPath: keyPath].render(name, labels: labels, into: &out)
+            }
+        }
+        func global(_ name: String, _ type: String, _ help: String, _ value: some CustomStringConvertible) {
+            family(name, type, help)
+            out += "\(name) \(value)\n"
+        }
+
+        histogram("lunar_ddc_read_duration_seconds", "Duration of successful DDC reads", \.ddcRead)
+        histogram("lunar_ddc_write_duration_seconds", "Duration of successful DDC writes", \.ddcWrite)
+        counter("lunar_ddc_read_faults_total", "DDC reads that failed or took too long", \.ddcReadFaults)
+        counter("lunar_ddc_write_faults_total", "DDC writes that failed or took too long", \.ddcWriteFaults)
+        family("lunar_control_write_duration_seconds", "histogram", "Duration of successful writes through network controllers (including the wait in the controller queue), Apple native brightness and ddcctl")
+        for (labels, metrics) in displays {
+            metrics.networkWrite.render("lunar_control_write_duration_seconds", labels: "\(labels),control=\"network\"", into: &out)
+            metrics.nativeWrite.render("lunar_control_write_duration_seconds", labels: "\(labels),control=\"appleNative\"", into: &out)
+            metrics.ddcctlWrite.render("lunar_control_write_duration_seconds", labels: "\(labels),control=\"ddcctl\"", into: &out)
+        }
+        histogram("lunar_transition_duration_seconds", "Duration of completed smooth DDC transitions", \.transitions)
+        counter("lunar_transitions_aborted_total", "Smooth DDC transitions that stopped because of a write error", \.transitionsAborted)
+        counter("lunar_gamma_applications_total", "Gamma tables applied", \.gammaApplications)
+        counter("lunar_gamma_failures_total", "Gamma tables the system refused", \.gammaFailures)
+
+        global("lunar_lux_samples_total", "counter", "Ambient light samples received", luxSamples.value)
+        global("lunar_lux_filtered_total", "counter", "Ambient light values that passed lux filtering", luxFiltered.value)
+        global("lunar_main_thread_hangs_total", "counter", "Times the main thread stopped responding", mainThreadHangs.value)
+        family("lunar_display_save_duration_seconds", "histogram", "Duration of encoding and writing the stored displays")
+        displaySaves.render("lunar_display_save_duration_seconds", into: &out)
+        global("lunar_displays_encoded_total", "counter", "Displays encoded for storage, unchanged displays reuse their last encoding", displaysEncoded.value)
+        global("lunar_display_store_bytes_total", "counter", "Bytes of display settings written to the preferences file", displayBytesWritten.value)
+        if let bytes = memoryFootprint() {
+            global("lunar_memory_footprint_bytes", "gauge", "Physical memory footprint of the app", Int(bytes))
+        }
+
+        return out
+    }
+
+    private final class Registry: AtomicReference {
+        init(displays: [CGDirectDisplayID: DisplayMetrics], names: [CGDirectDisplayID: String]) {
+            self.displays = displays
+            self.names = names
+        }
+
+        let displays: [CGDirectDisplayID: DisplayMetrics]
+        let names: [CGDirectDisplayID: String]
+    }
+
+    private let registry = ManagedAtomic(Registry(displays: [:], names: [:]))
+    private let lock = NSRecursiveLock()
+
+    private static func escaped(_ label: String) -> String {
+        label
+            .replacingOccurrences(of: "\\", with: "\\\\")
+            .replacingOccurrences(of: "\"", with: "\\\"")
+            .replacingOccurrences(of: "\n", with: "\\n")
+    }
+}
@@ -0,0 +1,226 @@
+//
+//  LuxStatistics.swift
+//  Lunar
+//
+//  Created by Alin Panaitiu on 19.10.2026.
+//  Copyright © 2026 Alin. All rights reserved.
+//
+
+import Foundation
+
+// MARK: - LuxWindow
+
+/// Fixed-capacity ring buffer of lux samples with streaming statistics.
+///
+/// Mean and EWMA are updated in O(1) per sample. The median is read in O(1) from a sorted shadow
+/// of the window that is kept up to date with two binary searches per sample.
+struct LuxWindow {
+    init(capacity: Int, alpha: Double) {
+        self.capacity = max(capacity, 1)
+        self.alpha = cap(alpha, minVal: 0.01, maxVal: 1)
+        samples = [Double](repeating: 0, count: self.capacity)
+        sorted.reserveCapacity(self.capacity)
+    }
+
+    let capacity: Int
+    let alpha: Double
+
+    private(set) var count = 0
+    private(set) var ewma: Double?
+
+    var isEmpty: Bool { count == 0 }
+    var isFull: Bool { count == capacity }
+
+    var latest: Double? {
+        guard count > 0 else { return nil }
+        return samples[(head + capacity - 1) % capacity]
+    }
+
+    var mean: Double? {
+        guard count > 0 else { return nil }
+        return sum / count.d
+    }
+
+    var median: Double? {
+        guard count > 0 else { return nil }
+        let mid = count / 2
+        return count % 2 == 1 ? sorted[mid] : (sorted[mid - 1] + sorted[mid]) / 2
+    }
+
+    var lowest: Double? { sorted.first }
+    var highest: Double? { sorted.last }
+
+    mutating func push(_ lux: Double) {
+        guard lux.isFinite else { return }
+
+        if count == capacity {
+            let evicted = samples[head]
+            sum -= evicted
+            sorted.remove(at: Self.lowerBound(sorted, evicted))
+        } else {
+            count += 1
+        }
+
+        samples[head] = lux
+        head = (head + 1) % capacity
+        sum += lux
+        sorted.insert(lux, at: Self.lowerBound(sorted, lux))
+        ewma = ewma.map { $0 + alpha * (lux - $0) } ?? lux
+
+        // re-sum periodically so that floating point drift from the running subtraction doesn't accumulate
+        pushes += 1
+        if pushes % (capacity * 64) == 0 {
+            sum = sorted.reduce(0, +)
+        }
+    }
+
+    mutating func reset() {
+        count = 0
+        head = 0
+        sum = 0
+        pushes = 0
+        ewma = nil
+        sorted.removeAll(keepingCapacity: true)
+    }
+
+    private var samples: [Double]
+    private var sorted: [Double] = []
+    private var head = 0
+    private var sum: Double = 0
+    private var pushes = 0
+
+    private static func lowerBound(_ values: [Double], _ value: Double) -> Int {
+        var lo = 0
+        var hi = values.count
+        while lo < hi {
+            let mid = (lo + hi) / 2
+            if values[mid] < value {
+                lo = mid + 1
+            } else {
+                hi = mid
+            }
+        }
+        return lo
+    }
+}
+
+// MARK: - LuxStatistics
+
+/// Streaming lux pipeline stage between the sensor and Sensor mode.
+///
+/// Raw readings go through a sliding median (spikes), then an EWMA (jitter), and the result is only
+/// published as `filtered` when it moves past a log-domain threshold from the last published value,
+/// at most once every `luxRateLimit` seconds. `AdaptiveModeInfo` exposes published values as `filteredLux`,
+/// it doesn't start adapt passes of its own: Sensor mode still adapts on its own schedule.
+final class LuxStatistics {
+    init(
+        windowSize: Int = CachedDefaults[.luxWindowSize],
+        alpha: Double = CachedDefaults[.luxEWMAAlpha],
+        logThreshold: Double = CachedDefaults[.luxLogThreshold],
+        deadband: Double = CachedDefaults[.luxDeadband],
+        rateLimit: TimeInterval = CachedDefaults[.luxRateLimit]
+    ) {
+        window = LuxWindow(capacity: windowSize, alpha: alpha)
+        self.logThreshold = logThreshold
+        self.deadband = deadband
+        self.rateLimit = rateLimit
+    }
+
+    static let shared = LuxStatistics()
+
+    var logThreshold: Double
+    var deadband: Double
+    var rateLimit: TimeInterval
+
+    /// Last value that passed the hysteresis and rate limiting
+    private(set) var filtered: Double?
+    private(set) var lastEmit: Date?
+
+    var hasPending: Bool {
+        lock.around { pending != nil }
+    }
+
+    var snapshot: (latest: Double?, mean: Double?, median: Double?, ewma: Double?, filtered: Double?) {
+        lock.around { (window.latest, window.mean, window.median, window.ewma, filtered) }
+    }
+
+    /// Feeds a raw reading and returns the new filtered value when it crossed the perceptual threshold.
+    ///
+    /// A crossing that happens inside the rate limit interval is kept pending and published by the
+    /// first sample after the interval ends, or by `flush()`.
+    @discardableResult
+    func push(_ lux: Double, at date: Date = Date()) -> Double? {
+        lock.around {
+            guard lux.isFinite, lux >= 0 else { return nil }
+
+            window.push(lux)
+
+            guard let median = window.median else { return nil }
+            smoothed = smoothed.map { $0 + window.alpha * (median - $0) } ?? median
+
+            guard let value = smoothed, crossed(value) else {
+                pending = nil
+                return nil
+            }
+            if let lastEmit, date.timeIntervalSince(lastEmit) < rateLimit {
+                pending = value
+                return nil
+            }
+            return emit(value, at: date)
+        }
+    }
+
+    /// Publishes a value held back by the rate limiter
+    @discardableResult
+    func flush(at date: Date = Date()) -> Double? {
+        lock.around {
+            guard let pending else { return nil }
+            if let lastEmit, date.timeIntervalSince(lastEmit) < rateLimit {
+                return nil
+            }
+            return emit(pending, at: date)
+        }
+    }
+
+    func reset() {
+        lock.around {
+            window.reset()
+            smoothed = nil
+            filtered = nil
+            pending = nil
+            lastEmit = nil
+        }
+    }
+
+    func reconfigure() {
+        lock.around {
+            window = LuxWindow(capacity: CachedDefaults[.luxWindowSize], alpha: CachedDefaults[.luxEWMAAlpha])
+            logThreshold = CachedDefaults[.luxLogThreshold]
+            deadband = CachedDefaults[.luxDeadband]
+            rateLimit = CachedDefaults[.luxRateLimit]
+            smoothed = nil
+            pending = nil
+        }
+    }
+
+    private var window: LuxWindow
+    private var smoothed: Double?
+    private var pending: Double?
+
+    private let lock = NSRecursiveLock()
+
+    /// Perceived brightness is roughly logarithmic in lux: compare in log10 space,
+    /// with an absolute deadband for the near-dark range where the log blows up small differences
+    private func crossed(_ value: Double) -> Bool {
+        guard let filtered else { return true }
+        guard abs(value - filtered) >= deadband else { return false }
+        return abs(log10(value + 1) - log10(filtered + 1)) >= logThreshold
+    }
+
+    private func emit(_ value: Double, at date: Date) -> Double {
+        filtered = value
+        lastEmit = date
+        pending = nil
+        return value
+    }
+}
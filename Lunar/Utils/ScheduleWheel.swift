@@ -0,0 +1,358 @@
+//
+//  ScheduleWheel.swift
+//  Lunar
+//
+//  Created by Alin Panaitiu on 19.10.2026.
+//  Copyright © 2026 Alin. All rights reserved.
+//
+
+import Foundation
+
+// MARK: - ScheduleWheel
+
+/// Hierarchical timing wheel that owns the slow transition steps of all displays.
+///
+/// Deadlines are quantized to `resolution`, everything expiring on the same tick fires from a single wakeup,
+/// and the timer is only armed for the earliest occupied slot so an idle wheel never ticks.
+final class ScheduleWheel {
+    init(resolution: TimeInterval = 0.1, clock: @escaping () -> Date = { Date() }, automatic: Bool = true) {
+        self.resolution = resolution
+        self.clock = clock
+        self.automatic = automatic
+        current = Int((clock().timeIntervalSince1970 / resolution).rounded(.down))
+        levels = [[[Event]]](repeating: [[Event]](repeating: [], count: Self.SLOTS), count: Self.LEVELS)
+        counts = [Int](repeating: 0, count: Self.LEVELS)
+    }
+
+    enum Kind: String, CaseIterable {
+        case brightnessTransition
+        case contrastTransition
+    }
+
+    final class Event {
+        init(wheel: ScheduleWheel, id: UInt64, display: String, kind: Kind, tick: Int, interval: Int, times: Int, onFinish: ((Event) -> Void)?, action: @escaping () -> Void) {
+            self.wheel = wheel
+            self.id = id
+            self.display = display
+            self.kind = kind
+            self.tick = tick
+            self.interval = interval
+            _remaining = times
+            self.onFinish = onFinish
+            self.action = action
+        }
+
+        let id: UInt64
+        let display: String
+        let kind: Kind
+
+        /// Number of times the event will still fire, including the next one
+        var remaining: Int { wheel?.lock.around { _remaining } ?? _remaining }
+        var cancelled: Bool { wheel?.lock.around { _cancelled } ?? _cancelled }
+
+        var date: Date { wheel.map { wheel in wheel.lock.around { wheel.date(tick) } } ?? .distantPast }
+        var key: String { "\(display):\(kind.rawValue)" }
+
+        func cancel() {
+            wheel?.cancel(self)
+        }
+
+        fileprivate weak var wheel: ScheduleWheel?
+        fileprivate var _remaining: Int
+        fileprivate var _cancelled = false
+        fileprivate var tick: Int
+        fileprivate let interval: Int
+        fileprivate let onFinish: ((Event) -> Void)?
+        fileprivate let action: () -> Void
+        fileprivate var level = -1
+        fileprivate var slot = -1
+    }
+
+    static let shared = ScheduleWheel()
+    static let queue = DispatchQueue(label: "fyi.lunar.schedule.wheel.queue", qos: .userInitiated)
+
+    /// 64 slots on each of 4 levels cover 64⁴ ticks (~19 days at 0.1s), anything further waits in `overflow`
+    static let SLOTS = 64
+    static let SLOT_BITS = 6
+    static let LEVELS = 4
+
+    let resolution: TimeInterval
+
+    /// Number of wakeups and fired events since launch, the difference is how much merging saved
+    var wakeups: Int { lock.around { _wakeups } }
+    var fired: Int { lock.around { _fired } }
+
+    /// Pending events sorted by deadline
+    var pending: [Event] {
+        lock.around { events.values.sorted { $0.tick == $1.tick ? $0.key < $1.key : $0.tick < $1.tick } }
+    }
+
+    var nextWakeup: Date? {
+        lock.around { earliestTick().map { date($0) } }
+    }
+
+    /// Schedules `action` to run on the main thread once at `date`, replacing any event of the same `kind` for `display`.
+    @discardableResult
+    func schedule(at date: Date, display: String, kind: Kind, action: @escaping () -> Void) -> Event {
+        lock.around {
+            let event = Event(
+                wheel: self, id: nextID(), display: display, kind: kind,
+                tick: tick(date), interval: 0, times: 1, onFinish: nil, action: action
+            )
+            add(event)
+            return event
+        }
+    }
+
+    /// Runs `action` on the main thread `times` times, every `interval` rounded to the wheel resolution.
+    ///
+    /// Transitions started with the same interval on the same tick share their wakeups.
+    @discardableResult
+    func repeating(
+        every interval: TimeInterval,
+        times: Int,
+        display: String,
+        kind: Kind,
+        onFinish: ((Event) -> Void)? = nil,
+        action: @escaping () -> Void
+    ) -> Event {
+        lock.around {
+            let ticks = max(Int((interval / resolution).rounded()), 1)
+            let event = Event(
+                wheel: self, id: nextID(), display: display, kind: kind,
+                tick: current + ticks, interval: ticks, times: max(times, 1), onFinish: onFinish, action: action
+            )
+            add(event)
+            return event
+        }
+    }
+
+    func cancel(_ event: Event) {
+        lock.around {
+            guard let existing = events[event.key], existing === event else { return }
+            remove(event)
+            rearm()
+        }
+    }
+
+    func cancel(display: String, kind: Kind? = nil) {
+        lock.around {
+            for kind in kind.map({ [$0] }) ?? Kind.allCases {
+                guard let event = events["\(display):\(kind.rawValue)"] else { continue }
+                remove(event)
+            }
+            rearm()
+        }
+    }
+
+    func nextDeadline(for display: String, kind: Kind? = nil) -> Date? {
+        lock.around {
+            events.values
+                .filter { $0.display == display && (kind == nil || $0.kind == kind) }
+                .map(\.tick).min()
+                .map { date($0) }
+        }
+    }
+
+    /// Moves the wheel forward to `date`, firing everything that expired on the way.
+    ///
+    /// Called by the timer, or directly when the wheel was created with `automatic: false` and driven by a virtual clock.
+    func advance(to date: Date? = nil) {
+        let expired: [(event: Event, finished: Bool)] = lock.around {
+            let target = tick(date ?? clock())
+            var expired: [(event: Event, finished: Bool)] = []
+            while current < target {
+                skipIdle(until: target)
+                guard current < target else { break }
+
+                for event in step() {
+                    event._remaining -= 1
+                    if event._remaining > 0, !event._cancelled {
+                        // don't burst through the missed steps after a sleep, continue from `target` instead
+                        event.tick = max(current + event.interval, target)
+                        place(event)
+                    } else {
+                        events.removeValue(forKey: event.key)
+                    }
+                    expired.append((event, event._remaining == 0))
+                }
+            }
+
+            _wakeups += expired.isEmpty ? 0 : 1
+            _fired += expired.count
+            rearm()
+            return expired
+        }
+        guard !expired.isEmpty else { return }
+
+        #if DEBUG
+            if expired.count > 1 {
+                log.verbose("Schedule wheel merged \(expired.count) events into one wakeup")
+            }
+        #endif
+        mainAsync {
+            for (event, finished) in expired where !event.cancelled {
+                event.action()
+                if finished {
+                    event.onFinish?(event)
+                }
+            }
+        }
+    }
+
+    func date(_ tick: Int) -> Date {
+        Date(timeIntervalSince1970: tick.d * resolution)
+    }
+
+    private let clock: () -> Date
+    private let automatic: Bool
+    fileprivate let lock = NSRecursiveLock()
+
+    private var current: Int
+    private var levels: [[[Event]]]
+    private var counts: [Int]
+    private var overflow: [Event] = []
+    private var events: [String: Event] = [:]
+    private var lastID: UInt64 = 0
+    private var _wakeups = 0
+    private var _fired = 0
+
+    private var timer: DispatchSourceTimer?
+    private var armedTick: Int?
+
+    private func nextID() -> UInt64 {
+        lastID += 1
+        return lastID
+    }
+
+    private func tick(_ date: Date) -> Int {
+        Int((date.timeIntervalSince1970 / resolution).rounded(.up))
+    }
+
+    private func add(_ event: Event) {
+        if let existing = events[event.key] {
+            remove(existing)
+        }
+        if event.tick <= current {
+            event.tick = current + 1
+        }
+        events[event.key] = event
+        place(event)
+        rearm()
+    }
+
+    private func remove(_ event: Event) {
+        event._cancelled = true
+        events.removeValue(forKey: event.key)
+
+        if event.level == Self.LEVELS {
+            overflow.removeAll { $0 === event }
+        } else if event.level >= 0 {
+            levels[event.level][event.slot].removeAll { $0 === event }
+            counts[event.level] -= 1
+        }
+        event.level = -1
+        event.slot = -1
+    }
+
+    /// Puts the event on the level of the highest 6-bit group where its tick differs from the current one.
+    /// Level `n` is cascaded into the lower levels when the current tick reaches the start of the event's slot.
+    private func place(_ event: Event) {
+        var level = 0
+        while level < Self.LEVELS - 1, event.tick >> ((level + 1) * Self.SLOT_BITS) != current >> ((level + 1) * Self.SLOT_BITS) {
+            level += 1
+        }
+        guard event.tick >> (Self.LEVELS * Self.SLOT_BITS) == current >> (Self.LEVELS * Self.SLOT_BITS) else {
+            event.level = Self.LEVELS
+            overflow.append(event)
+            return
+        }
+
+        let slot = (event.tick >> (level * Self.SLOT_BITS)) & (Self.SLOTS - 1)
+        event.level = level
+        event.slot = slot
+        levels[level][slot].append(event)
+        counts[level] += 1
+    }
+
+    /// Advances one tick, cascading the higher levels at their slot boundaries, and returns the expired events
+    private func step() -> [Event] {
+        current += 1
+
+        if current & ((1 << (Self.LEVELS * Self.SLOT_BITS)) - 1) == 0, !overflow.isEmpty {
+            let events = overflow
+            overflow = []
+            events.forEach(place)
+        }
+        for level in stride(from: Self.LEVELS - 1, through: 1, by: -1) {
+            guard current & ((1 << (level * Self.SLOT_BITS)) - 1) == 0 else { continue }
+
+            let slot = (current >> (level * Self.SLOT_BITS)) & (Self.SLOTS - 1)
+            let events = levels[level][slot]
+            guard !events.isEmpty else { continue }
+
+            levels[level][slot] = []
+            counts[level] -= events.count
+            events.forEach(place)
+        }
+
+        let slot = current & (Self.SLOTS - 1)
+        let expired = levels[0][slot]
+        guard !expired.isEmpty else { return [] }
+
+        levels[0][slot] = []
+        counts[0] -= expired.count
+        for event in expired {
+            event.level = -1
+            event.slot = -1
+        }
+        return expired
+    }
+
+    /// Jumps over ticks that can't contain anything: up to just before the next boundary of the first non-empty level
+    private func skipIdle(until target: Int) {
+        guard counts[0] == 0 else { return }
+
+        let level = counts.firstIndex(where: { $0 > 0 }) ?? Self.LEVELS
+        let bits = level * Self.SLOT_BITS
+        let boundary = ((current >> bits) + 1) << bits
+        current = min(max(boundary - 1, current), target)
+    }
+
+    /// Exact for level 0, the start of the next cascade for the higher levels
+    private func earliestTick() -> Int? {
+        for level in 0 ..< Self.LEVELS where counts[level] > 0 {
+            let bits = level * Self.SLOT_BITS
+            let currentSlot = (current >> bits) & (Self.SLOTS - 1)
+            for slot in (currentSlot + 1) ..< Self.SLOTS where !levels[level][slot].isEmpty {
+                return ((current >> (bits + Self.SLOT_BITS)) << (bits + Self.SLOT_BITS)) | (slot << bits)
+            }
+        }
+        guard !overflow.isEmpty else { return nil }
+
+        let bits = Self.LEVELS * Self.SLOT_BITS
+        return ((current >> bits) + 1) << bits
+    }
+
+    private func rearm() {
+        guard automatic else { return }
+
+        guard let tick = earliestTick() else {
+            timer?.cancel()
+            timer = nil
+            armedTick = nil
+            return
+        }
+        guard tick != armedTick || timer == nil else { return }
+
+        armedTick = tick
+        if timer == nil {
+            let timer = DispatchSource.makeTimerSource(flags: .strict, queue: Self.queue)
+            timer.setEventHandler { [weak self] in self?.advance() }
+            timer.resume()
+            self.timer = timer
+        }
+        let delay = max(date(tick).timeIntervalSince(clock()), 0)
+        timer?.schedule(wallDeadline: .now() + delay, leeway: .milliseconds(Int(resolution * 500)))
+    }
+}
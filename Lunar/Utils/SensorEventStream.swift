@@ -0,0 +1,328 @@
+//
+//  SensorEventStream.swift
+//  Lunar
+//
+//  Created by Alin Panaitiu on 19.10.2026.
+//  Copyright © 2026 Alin. All rights reserved.
+//
+
+import Foundation
+
+// MARK: - SSEParser
+
+/// Incremental parser for `text/event-stream` bodies.
+///
+/// Bytes are scanned in place and the event/data buffers are reused between events,
+/// so a steady stream of samples doesn't allocate.
+struct SSEParser {
+    static let EVENT_FIELD = Array("event:".utf8)
+    static let DATA_FIELD = Array("data:".utf8)
+
+    mutating func feed(_ data: Data, onEvent: (_ event: [UInt8], _ data: [UInt8]) -> Void) {
+        buffer.append(contentsOf: data)
+
+        while let newline = buffer[start...].firstIndex(of: 0x0A) {
+            var end = newline
+            if end > start, buffer[end - 1] == 0x0D {
+                end -= 1
+            }
+            let line = buffer[start ..< end]
+            start = newline + 1
+
+            if line.isEmpty {
+                if !payload.isEmpty {
+                    onEvent(event, payload)
+                }
+                event.removeAll(keepingCapacity: true)
+                payload.removeAll(keepingCapacity: true)
+            } else if line.starts(with: Self.EVENT_FIELD) {
+                event.append(contentsOf: Self.fieldValue(line, skipping: Self.EVENT_FIELD.count))
+            } else if line.starts(with: Self.DATA_FIELD) {
+                if !payload.isEmpty {
+                    payload.append(0x0A)
+                }
+                payload.append(contentsOf: Self.fieldValue(line, skipping: Self.DATA_FIELD.count))
+            }
+        }
+
+        if start == buffer.count {
+            buffer.removeAll(keepingCapacity: true)
+            start = 0
+        } else if start > 4096 {
+            buffer.removeSubrange(0 ..< start)
+            start = 0
+        }
+    }
+
+    mutating func reset() {
+        buffer.removeAll(keepingCapacity: true)
+        event.removeAll(keepingCapacity: true)
+        payload.removeAll(keepingCapacity: true)
+        start = 0
+    }
+
+    /// Finds `"<key>":` in a flat JSON object and parses the number after it, without decoding the object
+    static func number(for key: [UInt8], in bytes: [UInt8]) -> Double? {
+        guard let valueStart = find(key, in: bytes) else { return nil }
+
+        var i = valueStart
+        while i < bytes.count, bytes[i] == 0x20 {
+            i += 1
+        }
+        return parseNumber(bytes, from: i)
+    }
+
+    static func find(_ needle: [UInt8], in bytes: [UInt8]) -> Int? {
+        guard !needle.isEmpty, bytes.count >= needle.count else { return nil }
+
+        let first = needle[0]
+        var i = 0
+        while i <= bytes.count - needle.count {
+            if bytes[i] == first, bytes[i ..< i + needle.count].elementsEqual(needle) {
+                return i + needle.count
+            }
+            i += 1
+        }
+        return nil
+    }
+
+    private var buffer: [UInt8] = []
+    private var start = 0
+    private var event: [UInt8] = []
+    private var payload: [UInt8] = []
+
+    private static func fieldValue(_ line: ArraySlice<UInt8>, skipping count: Int) -> ArraySlice<UInt8> {
+        let value = line.dropFirst(count)
+        return value.first == 0x20 ? value.dropFirst() : value
+    }
+
+    /// Decimal number with optional sign, fraction and exponent. Returns `nil` for `null`, `NaN` or garbage.
+    private static func parseNumber(_ bytes: [UInt8], from start: Int) -> Double? {
+        var i = start
+        var negative = false
+        if i < bytes.count, bytes[i] == 0x2D || bytes[i] == 0x2B {
+            negative = bytes[i] == 0x2D
+            i += 1
+        }
+
+        var value: Double = 0
+        var digits = 0
+        while i < bytes.count, bytes[i] >= 0x30, bytes[i] <= 0x39 {
+            value = value * 10 + Double(bytes[i] - 0x30)
+            digits += 1
+            i += 1
+        }
+        if i < bytes.count, bytes[i] == 0x2E {
+            i += 1
+            var scale = 0.1
+            while i < bytes.count, bytes[i] >= 0x30, bytes[i] <= 0x39 {
+                value += Double(bytes[i] - 0x30) * scale
+                scale /= 10
+                digits += 1
+                i += 1
+            }
+        }
+        guard digits > 0 else { return nil }
+
+        if i < bytes.count, bytes[i] == 0x65 || bytes[i] == 0x45 {
+            i += 1
+            var expNegative = false
+            if i < bytes.count, bytes[i] == 0x2D || bytes[i] == 0x2B {
+                expNegative = bytes[i] == 0x2D
+                i += 1
+            }
+            var exp = 0
+            while i < bytes.count, bytes[i] >= 0x30, bytes[i] <= 0x39 {
+                exp = exp * 10 + Int(bytes[i] - 0x30)
+                i += 1
+            }
+            value *= pow(10, Double(expNegative ? -exp : exp))
+        }
+        return negative ? -value : value
+    }
+}
+
+// MARK: - SensorEventStream
+
+/// Persistent server-sent events connection to the ESPHome `web_server` of the Lunar ambient light sensor.
+///
+/// ESPHome pushes a `state` event every time a sensor publishes, so the lux value arrives as soon as
+/// it's read instead of waiting for the next poll. Dropped connections are retried with
+/// exponential backoff and equal jitter, so a floor full of Macs doesn't reconnect in lockstep.
+/// `onLux` runs on the main thread with the latest value, samples that arrive while a hop is pending replace each other.
+///
+/// Sensor mode's own polling can't be suspended from here, so while connected the stream only replaces it as
+/// the source of the lux statistics (see `AdaptiveModeInfo.luxStreamConnected`), not as the source of adaptation.
+final class SensorEventStream: NSObject, URLSessionDataDelegate {
+    init(url: URL, sensorID: String = "sensor-ambient_light", onConnectionChange: ((Bool) -> Void)? = nil, onLux: @escaping (Double) -> Void) {
+        self.url = url
+        self.onConnectionChange = onConnectionChange
+        self.onLux = onLux
+        idNeedle = Array("\"id\":\"\(sensorID)\"".utf8)
+        super.init()
+    }
+
+    static let queue = DispatchQueue(label: "fyi.lunar.sensor.stream.queue", qos: .userInitiated)
+
+    static let MIN_BACKOFF: TimeInterval = 0.5
+    static let MAX_BACKOFF: TimeInterval = 30
+
+    static let STATE_EVENT = Array("state".utf8)
+    static let VALUE_KEY = Array("\"value\":".utf8)
+
+    static var shared: SensorEventStream?
+
+    let url: URL
+
+    private(set) var connected = false
+    private(set) var events = 0
+    private(set) var reconnects = 0
+
+    /// Starts or stops the shared stream depending on the settings and the current mode
+    static func restart() {
+        shared?.stop()
+        shared = nil
+
+        let hostname = CachedDefaults[.sensorHostname]
+        guard CachedDefaults[.sensorStreaming], !hostname.isEmpty, DC.adaptiveModeKey == .sensor,
+              let url = URL(string: "http://\(hostname)/events")
+        else { return }
+
+        shared = SensorEventStream(url: url, onConnectionChange: { connected in
+            AMI.luxStreamConnected = connected
+        }) { lux in
+            AMI.stream(lux: lux)
+        }
+        shared?.start()
+    }
+
+    func start() {
+        Self.queue.async { [self] in
+            stopped = false
+            connect()
+        }
+    }
+
+    func stop() {
+        Self.queue.async { [self] in
+            stopped = true
+            reconnectTask?.cancel()
+            reconnectTask = nil
+            task?.cancel()
+            task = nil
+            session?.invalidateAndCancel()
+            session = nil
+            setConnected(false)
+        }
+    }
+
+    func urlSession(_: URLSession, dataTask _: URLSessionDataTask, didReceive response: URLResponse, completionHandler: @escaping (URLSession.ResponseDisposition) -> Void) {
+        guard let response = response as? HTTPURLResponse, response.statusCode == 200 else {
+            log.warning("Sensor event stream got an unexpected response: \(response)")
+            completionHandler(.cancel)
+            return
+        }
+        setConnected(true)
+        completionHandler(.allow)
+    }
+
+    func urlSession(_: URLSession, dataTask _: URLSessionDataTask, didReceive data: Data) {
+        parser.feed(data) { event, payload in
+            guard event == Self.STATE_EVENT, SSEParser.find(idNeedle, in: payload) != nil,
+                  let lux = SSEParser.number(for: Self.VALUE_KEY, in: payload), lux.isFinite, lux >= 0
+            else { return }
+
+            events += 1
+            attempt = 0
+            publish(lux)
+        }
+    }
+
+    func urlSession(_: URLSession, task _: URLSessionTask, didCompleteWithError error: Error?) {
+        setConnected(false)
+        guard !stopped else { return }
+
+        if let error {
+            log.debug("Sensor event stream closed: \(error.localizedDescription)")
+        }
+        scheduleReconnect()
+    }
+
+    private let onLux: (Double) -> Void
+    private let onConnectionChange: ((Bool) -> Void)?
+    private let idNeedle: [UInt8]
+
+    private var parser = SSEParser()
+    private var session: URLSession?
+    private var task: URLSessionDataTask?
+    private var reconnectTask: DispatchWorkItem?
+    private var stopped = true
+    private var attempt = 0
+
+    private let luxLock = NSRecursiveLock()
+    /// Latest lux not yet handed to `onLux`, a main thread hop is pending while this is set
+    private var pendingLux: Double?
+
+    private func publish(_ lux: Double) {
+        let hopPending = luxLock.around { () -> Bool in
+            defer { pendingLux = lux }
+            return pendingLux != nil
+        }
+        guard !hopPending else { return }
+
+        mainAsync { [weak self] in
+            guard let self else { return }
+            let lux = luxLock.around { () -> Double? in
+                defer { pendingLux = nil }
+                return pendingLux
+            }
+            if let lux {
+                onLux(lux)
+            }
+        }
+    }
+
+    /// Runs `onConnectionChange` on the main thread, ordered before the lux hops of the new connection
+    private func setConnected(_ value: Bool) {
+        guard connected != value else { return }
+        connected = value
+
+        guard let onConnectionChange else { return }
+        mainAsync { onConnectionChange(value) }
+    }
+
+    private func connect() {
+        guard !stopped else { return }
+
+        parser.reset()
+        if session == nil {
+            let config = URLSessionConfiguration.ephemeral
+            // ESPHome sends a `ping` event every few seconds, a silent minute means the sensor is gone
+            config.timeoutIntervalForRequest = 60
+            config.timeoutIntervalForResource = .infinity
+            config.httpMaximumConnectionsPerHost = 1
+
+            let delegateQueue = OperationQueue()
+            delegateQueue.underlyingQueue = Self.queue
+            delegateQueue.maxConcurrentOperationCount = 1
+            session = URLSession(configuration: config, delegate: self, delegateQueue: delegateQueue)
+        }
+
+        var request = URLRequest(url: url)
+        request.setValue("text/event-stream", forHTTPHeaderField: "Accept")
+        request.setValue("no-cache", forHTTPHeaderField: "Cache-Control")
+        task = session?.dataTask(with: request)
+        task?.resume()
+    }
+
+    private func scheduleReconnect() {
+        let delay = min(Self.MAX_BACKOFF, Self.MIN_BACKOFF * pow(2, attempt.d))
+        let jittered = Double.random(in: delay / 2 ... delay)
+        attempt = min(attempt + 1, 16)
+        reconnects += 1
+
+        let task = DispatchWorkItem(name: "SensorEventStream reconnect") { [weak self] in self?.connect() }
+        reconnectTask = task
+        Self.queue.asyncAfter(deadline: .now() + jittered, execute: task.workItem)
+    }
+}
@@ -105,10 +105,19 @@ final class Solar {
         return c
     }()
 
+    /// Minute resolution elevation/azimuth for the whole day, read from the on-disk cache when possible
+    private(set) lazy var table: SolarTable? = SolarTable.day(for: startOfDay, coordinate: coordinate)
+
     private(set) var sunPositionByMinuteInitialized = false
     private(set) lazy var sunPositionByMinute: [Sun?] = {
-        let positions = (0 ..< MINUTES_PER_DAY).map { minute in
-            computeSunPosition(date: Calendar.current.date(byAdding: DateComponents(minute: minute), to: startOfDay)!)
+        let positions: [Sun?] = if let table {
+            zip(table.elevations.prefix(MINUTES_PER_DAY), table.azimuths.prefix(MINUTES_PER_DAY)).map { elevation, azimuth in
+                Sun(azimuth: azimuth.d, elevation: elevation.d)
+            }
+        } else {
+            (0 ..< MINUTES_PER_DAY).map { minute in
+                computeSunPosition(date: Calendar.current.date(byAdding: DateComponents(minute: minute), to: startOfDay)!)
+            }
         }
         sunPositionByMinuteInitialized = true
         return positions
@@ -156,6 +165,10 @@ final class Solar {
 
     func getSunElevation(date: Date? = nil) -> Double? {
         let date = date ?? Date()
+        if let table, let sun = table.sun(at: date) {
+            return sun.elevation
+        }
+
         let key = ((date.timeIntervalSinceReferenceDate / 60).rounded() * 60).ns
         if let elevation = sunElevationCache.object(forKey: key) {
             return elevation.doubleValue
@@ -170,6 +183,9 @@ final class Solar {
 
     func computeSunPosition(date: Date? = nil) -> Sun? {
         let date = date ?? Date()
+        if let table, let sun = table.sun(at: date) {
+            return sun
+        }
 
         let components = Calendar.current.dateComponents([.hour, .minute], from: date)
         if sunPositionByMinuteInitialized,
@@ -179,7 +195,7 @@ final class Solar {
             return sun
         }
 
-        let (jd_UT, t) = jd(date)
+        let (jd_UT, t) = Self.jd(date)
         var pos: [Double] = getSun(t: t)
 
         // Ecliptic to equatorial coordinates
@@ -268,7 +284,7 @@ final class Solar {
         return Sun(azimuth: azi.radiansToDegrees, elevation: alt.radiansToDegrees)
     }
 
-    private func jd(_ date: Date) -> (Double, Double) {
+    static func jd(_ date: Date) -> (Double, Double) {
         var calendar = Calendar(identifier: .gregorian)
         calendar.timeZone = TimeZone.gmt
         let dc: DateComponents = calendar.dateComponents([.year, .month, .day, .hour, .minute, .second], from: date),
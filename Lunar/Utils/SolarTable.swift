@@ -0,0 +1,312 @@
+//
+//  SolarTable.swift
+//  Lunar
+//
+//  Created by Alin Panaitiu on 19.10.2026.
+//  Copyright © 2026 Alin. All rights reserved.
+//
+
+import Accelerate
+import CoreLocation
+import Foundation
+
+let SOLAR_TABLE_CACHE_DIR = FileManager.default.urls(for: .cachesDirectory, in: .userDomainMask).first!
+    .appendingPathComponent("fyi.lunar.Lunar", isDirectory: true)
+    .appendingPathComponent("solar", isDirectory: true)
+
+// MARK: - SolarTable
+
+/// Precomputed sun elevation/azimuth series sampled every `step` seconds starting at `start`.
+///
+/// The whole series is computed in one pass with vectorized trig (`vForce`) and stored as a flat `Float` buffer
+/// which is written to disk and memory-mapped on the next launch, so reading it needs no ephemeris math.
+///
+/// Layout: 48 byte header, `count` elevations, `count` azimuths (all `Float`, degrees)
+struct SolarTable {
+    init?(data: Data) {
+        guard data.count >= Self.HEADER_SIZE else { return nil }
+
+        let (magic, version, count, start, step, latitude, longitude) = data.withUnsafeBytes { buf in
+            (
+                buf.load(fromByteOffset: 0, as: UInt32.self),
+                buf.load(fromByteOffset: 4, as: UInt32.self),
+                Int(buf.load(fromByteOffset: 8, as: UInt32.self)),
+                buf.load(fromByteOffset: 16, as: Double.self),
+                buf.load(fromByteOffset: 24, as: Double.self),
+                buf.load(fromByteOffset: 32, as: Double.self),
+                buf.load(fromByteOffset: 40, as: Double.self)
+            )
+        }
+        guard magic == Self.MAGIC, version == Self.VERSION, count > 1, step > 0,
+              data.count == Self.HEADER_SIZE + count * 2 * MemoryLayout<Float>.size
+        else { return nil }
+
+        storage = data
+        self.count = count
+        self.start = Date(timeIntervalSinceReferenceDate: start)
+        self.step = step
+        self.latitude = latitude
+        self.longitude = longitude
+    }
+
+    init(latitude: Double, longitude: Double, start: Date, step: TimeInterval, elevations: [Float], azimuths: [Float]) {
+        var data = Data(capacity: Self.HEADER_SIZE + elevations.count * 2 * MemoryLayout<Float>.size)
+        withUnsafeBytes(of: Self.MAGIC) { data.append(contentsOf: $0) }
+        withUnsafeBytes(of: Self.VERSION) { data.append(contentsOf: $0) }
+        withUnsafeBytes(of: UInt32(elevations.count)) { data.append(contentsOf: $0) }
+        withUnsafeBytes(of: UInt32(0)) { data.append(contentsOf: $0) }
+        withUnsafeBytes(of: start.timeIntervalSinceReferenceDate) { data.append(contentsOf: $0) }
+        withUnsafeBytes(of: step) { data.append(contentsOf: $0) }
+        withUnsafeBytes(of: latitude) { data.append(contentsOf: $0) }
+        withUnsafeBytes(of: longitude) { data.append(contentsOf: $0) }
+        elevations.withUnsafeBytes { data.append(contentsOf: $0) }
+        azimuths.withUnsafeBytes { data.append(contentsOf: $0) }
+
+        storage = data
+        count = elevations.count
+        self.start = start
+        self.step = step
+        self.latitude = latitude
+        self.longitude = longitude
+    }
+
+    static let MAGIC: UInt32 = 0x4C53_4F4C // LSOL
+    static let VERSION: UInt32 = 1
+    static let HEADER_SIZE = 48
+
+    let count: Int
+    let start: Date
+    let step: TimeInterval
+    let latitude: Double
+    let longitude: Double
+
+    var end: Date { start.addingTimeInterval(step * (count - 1).d) }
+
+    var elevations: [Float] {
+        storage.withUnsafeBytes { Array($0.bindMemory(to: Float.self)[Self.HEADER_SIZE / 4 ..< Self.HEADER_SIZE / 4 + count]) }
+    }
+
+    var azimuths: [Float] {
+        storage.withUnsafeBytes { Array($0.bindMemory(to: Float.self)[Self.HEADER_SIZE / 4 + count ..< Self.HEADER_SIZE / 4 + count * 2]) }
+    }
+
+    /// One day at minute resolution starting at the local midnight of `date` (includes the next midnight)
+    static func day(for date: Date, coordinate: CLLocationCoordinate2D) -> SolarTable? {
+        guard let startOfDay = Calendar.current.date(bySettingHour: 0, minute: 0, second: 0, of: date) else { return nil }
+        return cached(coordinate: coordinate, start: startOfDay, step: 60, count: MINUTES_PER_DAY + 1)
+    }
+
+    /// A whole year at hourly resolution starting on January 1st of the year containing `date`
+    static func year(for date: Date, coordinate: CLLocationCoordinate2D) -> SolarTable? {
+        let calendar = Calendar.current
+        guard let start = calendar.date(from: calendar.dateComponents([.year], from: date)),
+              let end = calendar.date(byAdding: .year, value: 1, to: start)
+        else { return nil }
+        return cached(coordinate: coordinate, start: start, step: 3600, count: Int(end.timeIntervalSince(start) / 3600) + 1)
+    }
+
+    /// Loads the table from the memory-mapped cache file or computes and stores it
+    static func cached(coordinate: CLLocationCoordinate2D, start: Date, step: TimeInterval, count: Int) -> SolarTable? {
+        guard CLLocationCoordinate2DIsValid(coordinate), count > 1 else { return nil }
+
+        let file = cacheFile(coordinate: coordinate, start: start, step: step, count: count)
+        if let data = try? Data(contentsOf: file, options: .alwaysMapped), let table = SolarTable(data: data),
+           table.count == count, table.step == step, table.start == start
+        {
+            return table
+        }
+
+        let table = compute(coordinate: coordinate, start: start, step: step, count: count)
+        do {
+            try FileManager.default.createDirectory(at: SOLAR_TABLE_CACHE_DIR, withIntermediateDirectories: true)
+            try table.storage.write(to: file, options: .atomic)
+            pruneCache()
+        } catch {
+            log.warning("Can't write solar table to \(file.path): \(error)")
+        }
+        return table
+    }
+
+    static func cacheFile(coordinate: CLLocationCoordinate2D, start: Date, step: TimeInterval, count: Int) -> URL {
+        let lat = coordinate.latitude.str(decimals: 3)
+        let lon = coordinate.longitude.str(decimals: 3)
+        return SOLAR_TABLE_CACHE_DIR.appendingPathComponent("\(lat)_\(lon)_\(Int(start.timeIntervalSinceReferenceDate))_\(Int(step))x\(count).solar")
+    }
+
+    /// Removes cached tables that haven't been written in the last 30 days
+    static func pruneCache() {
+        let fm = FileManager.default
+        guard let files = try? fm.contentsOfDirectory(at: SOLAR_TABLE_CACHE_DIR, includingPropertiesForKeys: [.contentModificationDateKey]) else {
+            return
+        }
+
+        let expired = Date().addingTimeInterval(-30 * 24 * 60 * 60)
+        for file in files {
+            guard let modified = try? file.resourceValues(forKeys: [.contentModificationDateKey]).contentModificationDate,
+                  modified < expired
+            else { continue }
+            try? fm.removeItem(at: file)
+        }
+    }
+
+    /// Same algorithm as `Solar.computeSunPosition` evaluated over the whole series at once
+    static func compute(coordinate: CLLocationCoordinate2D, start: Date, step: TimeInterval, count: Int) -> SolarTable {
+        let deg = Double.pi / 180
+        let end = start.addingTimeInterval(step * (count - 1).d)
+
+        // Julian day and centuries are linear in time, ΔT is constant enough over a year
+        let (jdStart, tStart) = Solar.jd(start)
+        let (jdEnd, tEnd) = Solar.jd(end)
+        let jdUT = vDSP.ramp(in: jdStart ... jdEnd, count: count)
+        let t = vDSP.ramp(in: tStart ... tEnd, count: count)
+
+        // Sun ecliptic coordinates
+        let sanomaly = t.map { t in (357.5291 + 35999.0503 * t - 0.0001559 * t * t - 4.8e-07 * t * t * t) * deg }
+        let sin1 = vForce.sin(sanomaly)
+        let sin2 = vForce.sin(vDSP.multiply(2, sanomaly))
+        let sin3 = vForce.sin(vDSP.multiply(3, sanomaly))
+        let M1 = t.map { t in (124.90 - 1934.134 * t + 0.002063 * t * t) * deg }
+        let M2 = t.map { t in (201.11 + 72001.5377 * t + 0.00057 * t * t) * deg }
+        let sinM1 = vForce.sin(M1), cosM1 = vForce.cos(M1)
+        let sinM2 = vForce.sin(M2), cosM2 = vForce.cos(M2)
+
+        var c = [Double](repeating: 0, count: count)
+        var slongitude = [Double](repeating: 0, count: count)
+        var ecc = [Double](repeating: 0, count: count)
+        var anomaly = [Double](repeating: 0, count: count)
+        var obliquity = [Double](repeating: 0, count: count)
+        for i in 0 ..< count {
+            let t = t[i]
+            c[i] = (1.9146 - 0.004817 * t - 0.000014 * t * t) * sin1[i] + (0.019993 - 0.000101 * t) * sin2[i] + 0.00029 * sin3[i]
+
+            let lon = 280.46645 + 36000.76983 * t + 0.0003032 * t * t
+            slongitude[i] = (lon + c[i] + (-0.00569 - 0.0047785 * sinM1[i] - 0.0003667 * sinM2[i])) * deg
+            ecc[i] = 0.016708617 - 4.2037e-05 * t - 1.236e-07 * t * t
+            anomaly[i] = sanomaly[i] + c[i] * deg
+
+            let t2 = t / 100
+            var tmp = t2 * (27.87 + t2 * (5.79 + t2 * 2.45))
+            tmp = t2 * (-249.67 + t2 * (-39.05 + t2 * (7.12 + tmp)))
+            tmp = t2 * (-1.55 + t2 * (1999.25 + t2 * (-51.38 + tmp)))
+            tmp = (t2 * (-4680.93 + tmp)) / 3600
+            obliquity[i] = (23.4392911111111 + tmp + 0.002558 * cosM1[i] - 0.00015339 * cosM2[i]) * deg
+        }
+
+        let cosAnomaly = vForce.cos(anomaly)
+        let cosLon = vForce.cos(slongitude), sinLon = vForce.sin(slongitude)
+        let cosObl = vForce.cos(obliquity), sinObl = vForce.sin(obliquity)
+
+        // Local apparent sidereal time
+        let jd0 = vDSP.add(0.5, vForce.floor(vDSP.add(-0.5, jdUT)))
+        let obsLon = coordinate.longitude * deg
+        let obsLat = coordinate.latitude * deg
+        let sinlat = sin(obsLat), coslat = cos(obsLat)
+        var lst = [Double](repeating: 0, count: count)
+        for i in 0 ..< count {
+            let T0 = (jd0[i] - J2000) / JULIAN_DAYS_PER_CENTURY
+            let secs = (jdUT[i] - jd0[i]) * SECONDS_PER_DAY
+            let gmst = (((((-6.2e-6 * T0) + 9.3104e-2) * T0) + 8_640_184.812866) * T0) + 24110.54841
+            let msday = 1 + ((((-1.86e-5 * T0) + 0.186208) * T0) + 8_640_184.812866) / (SECONDS_PER_DAY * JULIAN_DAYS_PER_CENTURY)
+            lst[i] = (gmst + msday * secs) * (15.0 / 3600.0) * deg + obsLon
+        }
+        let cosLst = vForce.cos(lst), sinLst = vForce.sin(lst)
+
+        // Topocentric rectangular and equatorial coordinates
+        let radiusAU = EARTH_RADIUS / AU
+        var xtopo = [Double](repeating: 0, count: count)
+        var ytopo = [Double](repeating: 0, count: count)
+        var ztopo = [Double](repeating: 0, count: count)
+        var decTan = [Double](repeating: 0, count: count)
+        for i in 0 ..< count {
+            let distance = 1.000001018 * (1 - ecc[i] * ecc[i]) / (1 + ecc[i] * cosAnomaly[i])
+            let x = distance * cosLon[i]
+            let y = distance * sinLon[i]
+            xtopo[i] = x - radiusAU * coslat * cosLst[i]
+            ytopo[i] = y * cosObl[i] - radiusAU * coslat * sinLst[i]
+            ztopo[i] = y * sinObl[i] - radiusAU * sinlat
+            decTan[i] = ztopo[i] / sqrt(xtopo[i] * xtopo[i] + ytopo[i] * ytopo[i])
+        }
+        let ra = Self.atan2(ytopo, xtopo)
+        let dec = vForce.atan(decTan)
+        let angh = vDSP.subtract(lst, ra)
+
+        // Azimuth and geometric elevation
+        let sindec = vForce.sin(dec), cosdec = vForce.cos(dec)
+        let cosH = vForce.cos(angh), sinH = vForce.sin(angh)
+        var h = [Double](repeating: 0, count: count)
+        var azx = [Double](repeating: 0, count: count)
+        for i in 0 ..< count {
+            h[i] = sinlat * sindec[i] + coslat * cosdec[i] * cosH[i]
+            azx[i] = cosH[i] * sinlat - sindec[i] * coslat / cosdec[i]
+        }
+        let alt = vForce.asin(h)
+        let azimuth = vDSP.add(Double.pi, Self.atan2(sinH, azx))
+
+        // Apparent elevation with refraction (pressure of 1010 mb and T = 10 C)
+        let altDeg = vDSP.divide(alt, deg)
+        let refrArg = altDeg.map { a in Double.pi / 2 - (a + 7.31 / (a + 4.4)) * deg }
+        let refrTan = vForce.tan(refrArg)
+        var elevation = [Double](repeating: 0, count: count)
+        for i in 0 ..< count {
+            var a = alt[i]
+            if a > -3 * deg {
+                let r = 0.016667 * deg * abs(refrTan[i])
+                a = min(a + r * (0.28 * 1010 / (10 + 273)), Double.pi / 2)
+            }
+            elevation[i] = a / deg
+        }
+
+        return SolarTable(
+            latitude: coordinate.latitude,
+            longitude: coordinate.longitude,
+            start: start,
+            step: step,
+            elevations: vDSP.doubleToFloat(elevation),
+            azimuths: vDSP.doubleToFloat(vDSP.divide(azimuth, deg))
+        )
+    }
+
+    func contains(_ date: Date) -> Bool {
+        date >= start && date <= end
+    }
+
+    @inline(__always) func elevation(at index: Int) -> Float {
+        storage.withUnsafeBytes { $0.load(fromByteOffset: Self.HEADER_SIZE + index * 4, as: Float.self) }
+    }
+
+    @inline(__always) func azimuth(at index: Int) -> Float {
+        storage.withUnsafeBytes { $0.load(fromByteOffset: Self.HEADER_SIZE + (count + index) * 4, as: Float.self) }
+    }
+
+    /// Sun position at `date`, linearly interpolated between the two nearest samples
+    func sun(at date: Date) -> Sun? {
+        guard contains(date) else { return nil }
+
+        let pos = date.timeIntervalSince(start) / step
+        let i = min(Int(pos), count - 2)
+        let frac = pos - i.d
+
+        let elevation = elevation(at: i).d + frac * (elevation(at: i + 1).d - elevation(at: i).d)
+
+        var azFrom = azimuth(at: i).d
+        let azTo = azimuth(at: i + 1).d
+        if abs(azTo - azFrom) > 180 {
+            azFrom += azTo > azFrom ? 360 : -360
+        }
+        var azimuth = azFrom + frac * (azTo - azFrom)
+        if azimuth < 0 { azimuth += 360 }
+        if azimuth >= 360 { azimuth -= 360 }
+
+        return Sun(azimuth: azimuth, elevation: elevation)
+    }
+
+    private let storage: Data
+
+    /// Element-wise `atan2(y, x)` through `vvatan2`
+    private static func atan2(_ y: [Double], _ x: [Double]) -> [Double] {
+        var result = [Double](repeating: 0, count: y.count)
+        var n = Int32(y.count)
+        vvatan2(&result, y, x, &n)
+        return result
+    }
+}
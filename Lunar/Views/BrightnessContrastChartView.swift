@@ -23,6 +23,7 @@ final class BrightnessContrastChartView: LineChartView {
     let brightnessGraph = LineChartDataSet(entries: [ChartDataEntry](), label: "Brightness")
     let contrastGraph = LineChartDataSet(entries: [ChartDataEntry](), label: "Contrast")
     let graphData = LineChartData()
+    let dataProvider = ChartDataProvider()
 
     static func brightnessGradient(values: [Double], mode: AdaptiveModeKey) -> CGGradient? {
         let brColor = (darkMode ? white.withAlphaComponent(0.5) : violet).cgColor
@@ -78,19 +79,20 @@ final class BrightnessContrastChartView: LineChartView {
     func clampDataset(display: Display, mode: AdaptiveModeKey, minBrightness: Double? = nil) {
         switch mode {
         case .location:
-            let brightnessChartEntry = brightnessGraph.entries
-            let contrastChartEntry = contrastGraph.entries
-
-            if brightnessChartEntry.isEmpty || contrastChartEntry.isEmpty {
+            // the drawn entries are the snapshot the dataset was built from, the provider may already be evaluating a newer one
+            let entries = brightnessGraph.entries
+            let count = entries.count
+            guard count > 0, contrastGraph.entries.count > 0 else {
                 return
             }
 
             let minVal = minBrightness ?? display.minBrightness.doubleValue
-            let firstIndex = brightnessChartEntry.firstIndex(where: { d in d.y != minVal }) ?? 0
-            let lastIndex = brightnessChartEntry.lastIndex(where: { d in d.y != minVal }) ?? (brightnessChartEntry.count - 1)
+            let first = entries.firstIndex(where: { $0.y != minVal }) ?? 0
+            let last = entries.lastIndex(where: { $0.y != minVal }) ?? (count - 1)
+            let range = first ... last
             fitScreen()
             zoom(
-                scaleX: CGFloat(brightnessChartEntry.count) / CGFloat(brightnessChartEntry[firstIndex ... lastIndex].count),
+                scaleX: CGFloat(count) / CGFloat(range.count),
                 scaleY: 1.0, x: frame.width / 2.0, y: 0.0
             )
         default:
@@ -98,6 +100,20 @@ final class BrightnessContrastChartView: LineChartView {
         }
     }
 
+    /// Draws the decimated series computed by `dataProvider`, called on the main thread
+    func apply(_ output: ChartOutput) {
+        brightnessGraph.replaceEntries(output.brightness)
+        contrastGraph.replaceEntries(output.contrast)
+
+        if let gradient = BrightnessContrastChartView.brightnessGradient(values: output.gradientValues, mode: output.modeKey) {
+            brightnessGraph.fill = LinearGradientFill(gradient: gradient)
+        } else {
+            brightnessGraph.fill = nil
+            brightnessGraph.fillColor = darkMode ? white.withAlphaComponent(0.5) : violet
+        }
+        notifyDataSetChanged()
+    }
+
 //    func highlightCurrentValues(
 //        adaptiveMode: AdaptiveMode,
 //        for display: Display?,
@@ -196,6 +212,7 @@ final class BrightnessContrastChartView: LineChartView {
         var gradient: CGGradient?
 
         if display == nil || display?.id == GENERIC_DISPLAY_ID {
+            dataProvider.invalidate()
             if adaptiveMode is LocationMode {
                 brightnessChartEntry = stride(from: 0, to: adaptiveMode.maxChartDataPoints, by: 1)
                     .map { x in ChartDataEntry(x: x.d, y: 0.0) }
@@ -203,79 +220,15 @@ final class BrightnessContrastChartView: LineChartView {
             }
         } else if let display {
             switch adaptiveMode {
-            case let mode as SensorMode:
-                let xs = stride(from: 0.0, to: (mode.maxChartDataPoints - 1).d, by: 30.0)
-                brightnessChartEntry.reserveCapacity(mode.maxChartDataPoints)
-                contrastChartEntry.reserveCapacity(mode.maxChartDataPoints)
-
-                let brcrs = xs.map { lux in
-                    mode.computeBrightnessContrast(ambientLight: lux, display: display)
+            case is SensorMode, is LocationMode, is SyncMode:
+                if dataProvider.publishedModeKey == adaptiveMode.key, dataProvider.publishedSerial == display.serial {
+                    brightnessChartEntry = brightnessGraph.entries
+                    contrastChartEntry = contrastGraph.entries
+                    gradient = BrightnessContrastChartView.brightnessGradient(values: brightnessChartEntry.map(\.y), mode: adaptiveMode.key)
                 }
-
-                brightnessChartEntry.append(
-                    contentsOf: zip(xs, brcrs.map(\.0)).map { ChartDataEntry(x: $0, y: $1) }
-                )
-                contrastChartEntry.append(
-                    contentsOf: zip(xs, brcrs.map(\.1)).map { ChartDataEntry(x: $0, y: $1) }
-                )
-                gradient = BrightnessContrastChartView.brightnessGradient(values: brcrs.map(\.0), mode: .sensor)
-            case let mode as LocationMode:
-                brightnessChartEntry.reserveCapacity(mode.maxChartDataPoints)
-                contrastChartEntry.reserveCapacity(mode.maxChartDataPoints)
-
-                if let moment = mode.moment {
-                    let xs = stride(from: moment.astronomicalSunrise, to: moment.astronomicalSunset, by: 40)
-                    let brcrs = xs.map { datetime in
-                        mode.getBrightnessContrast(
-                            display: display,
-                            hour: datetime.hour,
-                            minute: datetime.minute
-                        )
-                    }
-
-                    brightnessChartEntry.append(
-                        contentsOf: zip(xs, brcrs.map(\.0)).map { ChartDataEntry(x: $0.timeIntervalSince(moment.astronomicalSunrise), y: $1) }
-                    )
-                    contrastChartEntry.append(
-                        contentsOf: zip(xs, brcrs.map(\.1)).map { ChartDataEntry(x: $0.timeIntervalSince(moment.astronomicalSunrise), y: $1) }
-                    )
-                    gradient = BrightnessContrastChartView.brightnessGradient(values: brcrs.map(\.0), mode: .location)
-                }
-            case let mode as SyncMode:
-//                if mode.isSyncingNits, let d = SyncMode.sourceDisplay {
-//                    let xs = stride(from: display.adaptiveSubzero ? -100.0 : 0.0, to: d.maxNits, by: 20.0)
-//                    brightnessChartEntry.reserveCapacity(mode.maxChartDataPoints)
-//                    contrastChartEntry.reserveCapacity(mode.maxChartDataPoints)
-//
-//                    let brcrs = xs.map { sourceNits in
-//                        mode.computeBrightnessContrast(nits: sourceNits, display: display)
-//                    }
-//                    brightnessChartEntry.append(
-//                        contentsOf: zip(xs, brcrs.map(\.0)).map { ChartDataEntry(x: $0, y: $1) }
-//                    )
-//                    contrastChartEntry.append(
-//                        contentsOf: zip(xs, brcrs.map(\.1)).map { ChartDataEntry(x: $0, y: $1) }
-//                    )
-//                } else {
-                let xs = stride(from: display.adaptiveSubzero ? -100.0 : 0.0, to: 100.0, by: 12.0)
-                brightnessChartEntry.reserveCapacity(mode.maxChartDataPoints)
-                contrastChartEntry.reserveCapacity(mode.maxChartDataPoints)
-
-                let brs = xs.map { sourceBrightness in
-                    mode.interpolate(sourceBrightness, display: display)
-                }
-
-                brightnessChartEntry.append(
-                    contentsOf: zip(xs, brs).map { ChartDataEntry(x: $0, y: $1) }
-                )
-
-                let crs = xs.map { sourceContrast in
-                    mode.interpolate(sourceContrast, display: display, contrast: true)
+                dataProvider.rebuild(display: display, mode: adaptiveMode, width: bounds.width) { [weak self] output in
+                    self?.apply(output)
                 }
-                contrastChartEntry.append(
-                    contentsOf: zip(xs, crs).map { ChartDataEntry(x: $0, y: $1) }
-                )
-                gradient = BrightnessContrastChartView.brightnessGradient(values: brs, mode: .sync)
             case is ManualMode:
                 brightnessChartEntry = [ChartDataEntry(x: 0, y: display.minBrightness.doubleValue), ChartDataEntry(x: 100, y: display.maxBrightness.doubleValue)]
                 contrastChartEntry = [ChartDataEntry(x: 0, y: display.minContrast.doubleValue), ChartDataEntry(x: 100, y: display.maxContrast.doubleValue)]
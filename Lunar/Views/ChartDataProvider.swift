@@ -0,0 +1,366 @@
+//
+//  ChartDataProvider.swift
+//  Lunar
+//
+//  Created by Alin Panaitiu on 19.10.2026.
+//  Copyright © 2026 Alin. All rights reserved.
+//
+
+import Atomics
+import Charts
+import Cocoa
+import SwiftDate
+
+/// Roughly one chart point every `CHART_POINT_SPACING` pixels after decimation
+let CHART_POINT_SPACING: CGFloat = 10
+
+// MARK: - ChartValueOverrides
+
+/// Values the user is currently dragging in the settings, not yet stored on the display
+struct ChartValueOverrides {
+    static let none = ChartValueOverrides()
+
+    var minBrightness: UInt16? = nil
+    var maxBrightness: UInt16? = nil
+    var minContrast: UInt16? = nil
+    var maxContrast: UInt16? = nil
+}
+
+// MARK: - ChartSeries
+
+/// Flat buffers holding the full resolution series. `features` is the curve input for each sample
+/// (lux, source brightness or sun elevation) and is used to find the samples affected by a curve edit.
+struct ChartSeries {
+    var xs: [Double] = []
+    var features: [Double] = []
+    var brightness: [Double] = []
+    var contrast: [Double] = []
+
+    var count: Int { xs.count }
+}
+
+// MARK: - ChartCurves
+
+/// Sample positions and the evaluator for the chart of one display and mode, captured on the main thread.
+///
+/// Values come from the mode's own functions, the same ones its adapt passes use, so the chart never
+/// draws a curve that Lunar doesn't apply.
+struct ChartCurves {
+    var modeKey: AdaptiveModeKey
+    var serial: String
+    var brightnessMapping: [AutoLearnMapping]
+    var contrastMapping: [AutoLearnMapping]
+
+    /// Evaluated with values the user is still dragging, which an incremental update must not reuse
+    var overridden: Bool
+
+    /// Sample positions, `features` are filled on the chart queue for Location mode
+    var series: ChartSeries
+
+    /// Sun elevation source for Location mode, `xs` are seconds since `sunrise`
+    var table: SolarTable?
+    var sunrise: Date?
+
+    /// Brightness and contrast in the display range for a sample position
+    var evaluateSample: (Double) -> (Double, Double)
+
+    func evaluate(_ xs: [Double]) -> (brightness: [Double], contrast: [Double]) {
+        var brightness = [Double](repeating: 0, count: xs.count)
+        var contrast = [Double](repeating: 0, count: xs.count)
+        for (i, x) in xs.enumerated() {
+            (brightness[i], contrast[i]) = evaluateSample(x)
+        }
+        return (brightness, contrast)
+    }
+}
+
+// MARK: - ChartOutput
+
+struct ChartOutput {
+    let modeKey: AdaptiveModeKey
+    let brightness: [ChartDataEntry]
+    let contrast: [ChartDataEntry]
+    let gradientValues: [Double]
+    let evaluatedPoints: Int
+    let evaluationMs: Double
+}
+
+// MARK: - ChartDataProvider
+
+/// Evaluates the adaptive curves for the chart off the main thread, keeps them in flat buffers,
+/// re-evaluates only the samples touched by a learned data point and decimates the result (LTTB)
+/// to the chart width.
+///
+/// Curves are evaluated through the mode's own functions, from a `ChartCurves` snapshot taken on the main thread.
+final class ChartDataProvider {
+    static let queue = DispatchQueue(label: "fyi.lunar.chart.queue", qos: .userInitiated)
+
+    /// Location mode targets change at most once a minute
+    static let LOCATION_SAMPLE_SECONDS: TimeInterval = 60
+
+    private(set) var series = ChartSeries()
+    private(set) var curves: ChartCurves?
+
+    /// Mode and display of the last series drawn, only accessed on the main thread
+    var publishedModeKey: AdaptiveModeKey?
+    var publishedSerial: String?
+    var lastMainThreadMs: Double = 0
+
+    /// Rebuilds the whole series for `mode` and calls `completion` on the main thread, must be called on the main thread
+    func rebuild(
+        display: Display,
+        mode: AdaptiveMode,
+        width: CGFloat,
+        overrides: ChartValueOverrides = .none,
+        completion: @escaping (ChartOutput) -> Void
+    ) {
+        guard let captured = Self.capture(display: display, mode: mode, overrides: overrides) else { return }
+
+        let gen = nextGeneration()
+        Self.queue.async { [weak self] in
+            guard let self, gen == generation.load(ordering: .relaxed) else { return }
+
+            let startedAt = DispatchTime.now()
+            var s = captured.series
+            if let table = captured.table, let sunrise = captured.sunrise {
+                s.features = s.xs.map { x in table.sun(at: sunrise.addingTimeInterval(x))?.elevation ?? .nan }
+            }
+            (s.brightness, s.contrast) = captured.evaluate(s.xs)
+
+            series = s
+            curves = captured
+            publish(gen: gen, evaluated: s.count, startedAt: startedAt, width: width, completion: completion)
+        }
+    }
+
+    /// Re-evaluates only the samples whose feature lies in the part of the curve changed by a learned data point
+    func update(
+        display: Display,
+        mode: AdaptiveMode,
+        width: CGFloat,
+        userBrightness: [AutoLearnMapping]? = nil,
+        userContrast: [AutoLearnMapping]? = nil,
+        completion: @escaping (ChartOutput) -> Void
+    ) {
+        let gen = nextGeneration()
+        let modeKey = mode.key
+        let serial = display.serial
+        Self.queue.async { [weak self] in
+            guard let self, gen == generation.load(ordering: .relaxed) else { return }
+            guard var current = curves, current.modeKey == modeKey, current.serial == serial, !current.overridden, series.count > 0 else {
+                mainAsync { [weak self] in
+                    self?.rebuild(display: display, mode: mode, width: width, completion: completion)
+                }
+                return
+            }
+
+            let startedAt = DispatchTime.now()
+            var ranges: [ClosedRange<Double>] = []
+            if let userBrightness {
+                if let range = Self.affectedFeatureRange(old: current.brightnessMapping, new: userBrightness) {
+                    ranges.append(range)
+                }
+                current.brightnessMapping = userBrightness
+            }
+            if let userContrast {
+                if let range = Self.affectedFeatureRange(old: current.contrastMapping, new: userContrast) {
+                    ranges.append(range)
+                }
+                current.contrastMapping = userContrast
+            }
+            curves = current
+
+            // the mode reads the learned point from the display, which already stored it
+            let indices = series.features.indices.filter { i in
+                let feature = series.features[i]
+                return !feature.isFinite || ranges.contains(where: { $0.contains(feature) })
+            }
+            let (brightness, contrast) = current.evaluate(indices.map { series.xs[$0] })
+            for (j, i) in indices.enumerated() {
+                series.brightness[i] = brightness[j]
+                series.contrast[i] = contrast[j]
+            }
+
+            publish(gen: gen, evaluated: indices.count, startedAt: startedAt, width: width, completion: completion)
+        }
+    }
+
+    func invalidate() {
+        _ = nextGeneration()
+        publishedModeKey = nil
+        publishedSerial = nil
+        Self.queue.async { [weak self] in
+            self?.series = ChartSeries()
+            self?.curves = nil
+        }
+    }
+
+    /// Feature interval whose chart values can change when going from `old` to `new`.
+    ///
+    /// Spline slopes depend on the neighbouring data points, so the interval is widened
+    /// by two data points on each side of the changed ones.
+    static func affectedFeatureRange(old: [AutoLearnMapping], new: [AutoLearnMapping]) -> ClosedRange<Double>? {
+        let oldPoints = Dictionary(old.map { ($0.source, $0.target) }, uniquingKeysWith: { _, new in new })
+        let newPoints = Dictionary(new.map { ($0.source, $0.target) }, uniquingKeysWith: { _, new in new })
+        let sources = Set(oldPoints.keys).union(newPoints.keys).sorted()
+
+        guard let lo = sources.firstIndex(where: { oldPoints[$0] != newPoints[$0] }),
+              let hi = sources.lastIndex(where: { oldPoints[$0] != newPoints[$0] })
+        else { return nil }
+
+        let lower = lo >= 2 ? sources[lo - 2] : -Double.infinity
+        let upper = hi + 2 < sources.count ? sources[hi + 2] : Double.infinity
+        return lower ... upper
+    }
+
+    /// Largest-Triangle-Three-Buckets downsampling: picks `threshold` indices that preserve the visual shape of the series.
+    /// The triangle area is summed over all `ys` series so that every curve keeps its peaks.
+    static func lttb(xs: [Double], ys: [[Double]], threshold: Int) -> [Int] {
+        let n = xs.count
+        guard threshold >= 3, n > threshold else { return Array(0 ..< n) }
+
+        var indices = [Int]()
+        indices.reserveCapacity(threshold)
+        indices.append(0)
+
+        let bucketSize = (n - 2).d / (threshold - 2).d
+        var a = 0
+        for bucket in 0 ..< threshold - 2 {
+            let start = Int(bucket.d * bucketSize) + 1
+            let end = min(Int((bucket + 1).d * bucketSize) + 1, n - 1)
+
+            let nextStart = end
+            let nextEnd = min(Int((bucket + 2).d * bucketSize) + 1, n)
+            let nextCount = max(nextEnd - nextStart, 1).d
+            let avgX = xs[nextStart ..< max(nextEnd, nextStart + 1)].reduce(0, +) / nextCount
+            let avgYs = ys.map { $0[nextStart ..< max(nextEnd, nextStart + 1)].reduce(0, +) / nextCount }
+
+            var maxArea = -1.0
+            var chosen = start
+            for i in start ..< max(end, start + 1) {
+                var area = 0.0
+                for (y, avgY) in zip(ys, avgYs) {
+                    area += abs((xs[a] - avgX) * (y[i] - y[a]) - (xs[a] - xs[i]) * (avgY - y[a]))
+                }
+                if area > maxArea {
+                    maxArea = area
+                    chosen = i
+                }
+            }
+
+            indices.append(chosen)
+            a = chosen
+        }
+
+        indices.append(n - 1)
+        return indices
+    }
+
+    /// Bumped on every request so that stale results are dropped. Atomic because the main thread
+    /// must never `sync` on the chart queue: curve evaluation can itself wait on the main thread.
+    private let generation = ManagedAtomic<Int>(0)
+
+    private func nextGeneration() -> Int {
+        generation.wrappingIncrementThenLoad(ordering: .relaxed)
+    }
+
+    private func publish(gen: Int, evaluated: Int, startedAt: DispatchTime, width: CGFloat, completion: @escaping (ChartOutput) -> Void) {
+        guard let modeKey = curves?.modeKey else { return }
+        let serial = curves?.serial
+
+        let threshold = max(Int(width / CHART_POINT_SPACING), 16)
+        let indices = Self.lttb(xs: series.xs, ys: [series.brightness, series.contrast], threshold: threshold)
+        let brightness = indices.map { ChartDataEntry(x: series.xs[$0], y: series.brightness[$0]) }
+        let contrast = indices.map { ChartDataEntry(x: series.xs[$0], y: series.contrast[$0]) }
+        let evaluationMs = (DispatchTime.now().rawValue - startedAt.rawValue).d / 1_000_000
+
+        let output = ChartOutput(
+            modeKey: modeKey,
+            brightness: brightness,
+            contrast: contrast,
+            gradientValues: indices.map { series.brightness[$0] },
+            evaluatedPoints: evaluated,
+            evaluationMs: evaluationMs
+        )
+
+        mainAsync { [weak self] in
+            guard let self, gen == generation.load(ordering: .relaxed) else { return }
+
+            let mainStartedAt = DispatchTime.now()
+            publishedModeKey = output.modeKey
+            publishedSerial = serial
+            completion(output)
+            lastMainThreadMs = (DispatchTime.now().rawValue - mainStartedAt.rawValue).d / 1_000_000
+
+            log.debug(
+                "Chart \(modeKey.str): evaluated \(evaluated) points in \(evaluationMs.str(decimals: 2))ms off the main thread, drew \(brightness.count) points in \(lastMainThreadMs.str(decimals: 2))ms on the main thread"
+            )
+        }
+    }
+
+    /// Sample positions and the per-sample evaluator for each curve based mode, read from the live objects on the main thread
+    private static func capture(display: Display, mode: AdaptiveMode, overrides: ChartValueOverrides) -> ChartCurves? {
+        var series = ChartSeries()
+        var table: SolarTable?
+        var sunrise: Date?
+        let evaluateSample: (Double) -> (Double, Double)
+
+        // LTTB keeps the shape at the chart width, denser sampling than this only costs evaluation time
+        switch mode {
+        case let mode as SensorMode:
+            series.xs = Array(stride(from: 0.0, to: (mode.maxChartDataPoints - 1).d, by: 30.0))
+            series.features = series.xs
+            evaluateSample = { lux in mode.computeBrightnessContrast(ambientLight: lux, display: display) }
+        case let mode as LocationMode:
+            guard let moment = mode.moment, let solarTable = mode.geolocation?.solar?.table else { return nil }
+
+            let start = moment.astronomicalSunrise
+            table = solarTable
+            sunrise = start.date
+            series.xs = Array(stride(from: 0.0, to: moment.astronomicalSunset.date.timeIntervalSince(start.date), by: Self.LOCATION_SAMPLE_SECONDS))
+            series.features = [Double](repeating: .nan, count: series.xs.count)
+            evaluateSample = { x in
+                let datetime = start + Int(x).seconds
+                return mode.getBrightnessContrast(
+                    display: display,
+                    hour: datetime.hour,
+                    minute: datetime.minute,
+                    minBrightness: overrides.minBrightness?.u8,
+                    minContrast: overrides.minContrast?.u8
+                )
+            }
+        case let mode as SyncMode:
+            series.xs = Array(stride(from: display.adaptiveSubzero ? -100.0 : 0.0, to: 100.0, by: 4.0))
+            series.features = series.xs
+            evaluateSample = { x in
+                (
+                    mode.interpolate(x, display: display, minVal: overrides.minBrightness?.d, maxVal: overrides.maxBrightness?.d),
+                    mode.interpolate(x, display: display, minVal: overrides.minContrast?.d, maxVal: overrides.maxContrast?.d, contrast: true)
+                )
+            }
+        default:
+            return nil
+        }
+
+        return ChartCurves(
+            modeKey: mode.key,
+            serial: display.serial,
+            brightnessMapping: display.brightnessCurveMapping(mode.key),
+            contrastMapping: display.contrastCurveMapping(mode.key),
+            overridden: overrides.minBrightness != nil || overrides.maxBrightness != nil || overrides.minContrast != nil || overrides.maxContrast != nil,
+            series: series.filled,
+            table: table,
+            sunrise: sunrise,
+            evaluateSample: evaluateSample
+        )
+    }
+}
+
+private extension ChartSeries {
+    var filled: ChartSeries {
+        var s = self
+        s.brightness = [Double](repeating: 0, count: xs.count)
+        s.contrast = [Double](repeating: 0, count: xs.count)
+        return s
+    }
+}
@@ -295,6 +295,18 @@ extension Defaults.Keys {
     static let disableVolumeKeysOnSleep = Key<Bool>("disableVolumeKeysOnSleep", default: false)
     static let sleepInClamshellMode = Key<Bool>("sleepInClamshellMode", default: false)
     static let disableCliffDetection = Key<Bool>("disableCliffDetection", default: false)
+    static let curveLUTResolution = Key<Int>("curveLUTResolution", default: 1024)
+    static let luxFiltering = Key<Bool>("luxFiltering", default: true)
+    static let luxWindowSize = Key<Int>("luxWindowSize", default: 15)
+    static let luxEWMAAlpha = Key<Double>("luxEWMAAlpha", default: 0.3)
+    static let luxLogThreshold = Key<Double>("luxLogThreshold", default: 0.04)
+    static let luxDeadband = Key<Double>("luxDeadband", default: 1)
+    static let luxRateLimit = Key<Double>("luxRateLimit", default: 1)
+    static let sensorStreaming = Key<Bool>("sensorStreaming", default: false)
+    static let sensorFilterWindow = Key<Int>("sensorFilterWindow", default: 7)
+    static let sensorDeltaPercent = Key<Double>("sensorDeltaPercent", default: 5)
+    static let sensorHeartbeatSeconds = Key<Int>("sensorHeartbeatSeconds", default: 60)
+    static let networkMaxInFlight = Key<Int>("networkMaxInFlight", default: 2)
     static let jitterBrightnessOnWake = Key<Bool>("jitterBrightnessOnWake", default: false)
 
     static let sensorHostname = Key<String>("sensorHostname", default: "lunarsensor.local")
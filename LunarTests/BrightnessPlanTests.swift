@@ -0,0 +1,54 @@
+//
+//  BrightnessPlanTests.swift
+//  LunarTests
+//
+//  Created by Alin Panaitiu on 19.10.2026.
+//  Copyright © 2026 Alin. All rights reserved.
+//
+
+import XCTest
+@testable import Lunar
+
+final class BrightnessPlanTests: XCTestCase {
+    static let key = BrightnessPlan.Key(minBrightness: 0, maxBrightness: 100, minContrast: 30, maxContrast: 70, subzero: false, latitude: 0, longitude: 0)
+    let start = Date(timeIntervalSinceReferenceDate: 0)
+
+    /// Brightness climbs one unit every 10 minutes, contrast stays flat
+    func plan() -> BrightnessPlan {
+        BrightnessPlan(key: Self.key, start: start, step: 60, count: 1440) { [start] date in
+            ((date.timeIntervalSince(start) / 600).rounded(.down), 50)
+        }!
+    }
+
+    func testSamplesTheEvaluatorOncePerStep() {
+        var calls = 0
+        let plan = BrightnessPlan(key: Self.key, start: start, step: 60, count: 1440) { _ in
+            calls += 1
+            return (10, 40)
+        }
+
+        XCTAssertEqual(calls, 1440)
+        XCTAssertEqual(plan?.end, start.addingTimeInterval(1439 * 60))
+        XCTAssertNil(BrightnessPlan(key: Self.key, start: start, step: 60, count: 1) { _ in (0, 0) })
+    }
+
+    func testTargetInterpolatesBetweenSamples() {
+        let plan = plan()
+
+        XCTAssertEqual(plan.target(at: start)?.brightness, 0)
+        XCTAssertEqual(plan.target(at: start.addingTimeInterval(600))?.brightness, 1)
+        XCTAssertEqual(plan.target(at: start.addingTimeInterval(570))!.brightness, 0.5, accuracy: 0.0001)
+        XCTAssertEqual(plan.target(at: start.addingTimeInterval(570))?.contrast, 50)
+        XCTAssertNil(plan.target(at: start.addingTimeInterval(-1)))
+        XCTAssertNil(plan.target(at: plan.end.addingTimeInterval(1)))
+    }
+
+    func testNextChangeSkipsToTheFirstPerceivableChange() {
+        let plan = plan()
+
+        XCTAssertEqual(plan.nextChange(after: start), start.addingTimeInterval(600))
+        XCTAssertEqual(plan.nextChange(after: start.addingTimeInterval(601)), start.addingTimeInterval(1200))
+        XCTAssertEqual(plan.nextChange(after: start, brightnessThreshold: 3), start.addingTimeInterval(1800))
+        XCTAssertNil(plan.nextChange(after: plan.end))
+    }
+}
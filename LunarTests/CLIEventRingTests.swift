@@ -0,0 +1,79 @@
+//
+//  CLIEventRingTests.swift
+//  LunarTests
+//
+//  Created by Alin Panaitiu on 19.10.2026.
+//  Copyright © 2026 Alin. All rights reserved.
+//
+
+import CoreGraphics
+import XCTest
+@testable import Lunar
+
+final class CLIEventRingTests: XCTestCase {
+    func event(_ display: CGDirectDisplayID, _ property: String, _ value: String) -> CLIEventRing.Event {
+        CLIEventRing.Event(key: .init(display: display, property: property), bytes: Data(value.utf8))
+    }
+
+    func drain(_ ring: inout CLIEventRing) -> [String] {
+        var values: [String] = []
+        while let event = ring.popFirst() {
+            values.append(String(decoding: event.bytes, as: UTF8.self))
+        }
+        return values
+    }
+
+    func testPopsInOrder() {
+        var ring = CLIEventRing(capacity: 4)
+        XCTAssertEqual(ring.push(event(1, "brightness", "a")), .queued)
+        XCTAssertEqual(ring.push(event(1, "contrast", "b")), .queued)
+        XCTAssertEqual(ring.push(event(2, "brightness", "c")), .queued)
+
+        XCTAssertEqual(ring.count, 3)
+        XCTAssertEqual(drain(&ring), ["a", "b", "c"])
+        XCTAssertTrue(ring.isEmpty)
+    }
+
+    func testCoalescesInPlace() {
+        var ring = CLIEventRing(capacity: 4)
+        _ = ring.push(event(1, "brightness", "10"))
+        _ = ring.push(event(1, "contrast", "20"))
+        XCTAssertEqual(ring.push(event(1, "brightness", "11")), .coalesced)
+
+        XCTAssertEqual(ring.count, 2)
+        XCTAssertEqual(drain(&ring), ["11", "20"])
+    }
+
+    func testDropsTheOldestWhenFull() {
+        var ring = CLIEventRing(capacity: 2)
+        _ = ring.push(event(1, "brightness", "a"))
+        _ = ring.push(event(2, "brightness", "b"))
+        XCTAssertEqual(ring.push(event(3, "brightness", "c")), .droppedOldest)
+
+        XCTAssertEqual(drain(&ring), ["b", "c"])
+
+        // the dropped key is free again and doesn't coalesce into a stale slot
+        XCTAssertEqual(ring.push(event(1, "brightness", "d")), .queued)
+        XCTAssertEqual(drain(&ring), ["d"])
+    }
+
+    func testWrapsAround() {
+        var ring = CLIEventRing(capacity: 3)
+        var expected: [String] = []
+        var popped: [String] = []
+
+        for i in 0 ..< 20 {
+            _ = ring.push(event(CGDirectDisplayID(i), "brightness", "\(i)"))
+            expected.append("\(i)")
+            if i.isMultiple(of: 2), let event = ring.popFirst() {
+                popped.append(String(decoding: event.bytes, as: UTF8.self))
+            }
+            XCTAssertLessThanOrEqual(ring.count, 3)
+        }
+        popped += drain(&ring)
+
+        // everything popped is in push order, and only the oldest were dropped
+        XCTAssertEqual(popped, popped.sorted { Int($0)! < Int($1)! })
+        XCTAssertEqual(popped.last, expected.last)
+    }
+}
@@ -0,0 +1,127 @@
+//
+//  CLIRequestTests.swift
+//  LunarTests
+//
+//  Created by Alin Panaitiu on 19.10.2026.
+//  Copyright © 2026 Alin. All rights reserved.
+//
+
+import XCTest
+@testable import Lunar
+
+final class CLIRequestTests: XCTestCase {
+    let SEP = CLI_ARG_SEPARATOR
+
+    func testRawRequestsEndAtANewline() {
+        var buffer = Data("key\(SEP)displays\(SEP)list\nkey\(SEP)lid\n".utf8)
+
+        let first = CLIRequest.take(from: &buffer)
+        XCTAssertEqual(first?.line, "key\(SEP)displays\(SEP)list")
+        XCTAssertEqual(first?.escaped, true)
+        XCTAssertFalse(first?.http ?? true)
+
+        XCTAssertEqual(CLIRequest.take(from: &buffer)?.line, "key\(SEP)lid")
+        XCTAssertNil(CLIRequest.take(from: &buffer))
+        XCTAssertTrue(buffer.isEmpty)
+    }
+
+    func testRawRequestSplitAcrossReads() {
+        var buffer = Data("key\(SEP)displ".utf8)
+        XCTAssertNil(CLIRequest.take(from: &buffer))
+        XCTAssertEqual(buffer.count, "key\(SEP)displ".utf8.count)
+
+        buffer.append(Data("ays\n".utf8))
+        XCTAssertEqual(CLIRequest.take(from: &buffer)?.line, "key\(SEP)displays")
+    }
+
+    func testUnterminatedRawRequestIsTakenOnceComplete() {
+        var buffer = Data("key lid".utf8)
+        XCTAssertNil(CLIRequest.take(from: &buffer))
+
+        let request = CLIRequest.take(from: &buffer, complete: true)
+        XCTAssertEqual(request?.line, "key lid")
+        XCTAssertEqual(request?.escaped, false)
+        XCTAssertTrue(buffer.isEmpty)
+    }
+
+    func testSessionLines() {
+        var buffer = Data("3\(SEP)displays\(SEP)a\\nb\n4\(SEP)li".utf8)
+
+        let request = CLIRequest.take(from: &buffer, sessionKey: "secret")
+        XCTAssertEqual(request?.id, "3")
+        XCTAssertEqual(request?.key, "secret")
+        XCTAssertEqual(request?.line, "displays\(SEP)a\\nb")
+        XCTAssertEqual(request?.escaped, true)
+
+        // the rest of the next line hasn't arrived yet, even at EOF a session line needs its newline
+        XCTAssertNil(CLIRequest.take(from: &buffer, sessionKey: "secret", complete: true))
+        buffer.append(Data("d\n".utf8))
+        XCTAssertEqual(CLIRequest.take(from: &buffer, sessionKey: "secret")?.line, "lid")
+    }
+
+    func testHandshake() {
+        var buffer = Data(CLISession.handshake(key: "sec").utf8.dropLast())
+        XCTAssertNil(CLIRequest.take(from: &buffer, complete: true))
+
+        buffer.append(Data("ret\n".utf8))
+        let request = CLIRequest.take(from: &buffer)
+        XCTAssertEqual(request?.handshake, true)
+        XCTAssertEqual(request?.key, "secret")
+    }
+
+    func testHTTPWaitsForTheWholeBody() {
+        let head = "POST /cmd?x=1 HTTP/1.1\r\nAuthorization: secret\r\nContent-Length: 10\r\n\r\n"
+        var buffer = Data((head + "cmd=lid").utf8)
+        XCTAssertNil(CLIRequest.take(from: &buffer, complete: true))
+
+        buffer.append(Data("+onGET".utf8))
+        let request = CLIRequest.take(from: &buffer)
+        XCTAssertEqual(request?.http, true)
+        XCTAssertEqual(request?.key, "secret")
+        XCTAssertEqual(request?.path, "/cmd")
+        XCTAssertEqual(request?.line, "lid on")
+        XCTAssertEqual(String(decoding: buffer, as: UTF8.self), "GET")
+    }
+
+    func testPartialHTTPRequestLineWaits() {
+        var buffer = Data("GET /metr".utf8)
+        XCTAssertNil(CLIRequest.take(from: &buffer, complete: true))
+        XCTAssertEqual(buffer.count, 9)
+    }
+
+    // MARK: - CLISession
+
+    func testEscapeRoundTrips() {
+        let args = ["plain", "two\nlines", "crlf\r\nend", "back\\slash", "literal \\n", "trailing\\", ""]
+        for arg in args {
+            let escaped = CLISession.escape(arg)
+            XCTAssertFalse(escaped.unicodeScalars.contains("\n"), escaped)
+            XCTAssertFalse(escaped.unicodeScalars.contains("\r"), escaped)
+            XCTAssertEqual(CLISession.unescape(escaped), arg)
+        }
+        XCTAssertEqual(CLISession.escape("plain"), "plain")
+        XCTAssertEqual(CLISession.unescape("a\\tb"), "a\\tb")
+    }
+
+    func testSessionRequestsSurviveTheServerSplit() {
+        let args = ["displays", "dell u2720q", "note", "multi\nline\\"]
+        var buffer = Data(CLISession.request(id: 7, args: args).utf8)
+
+        let request = CLIRequest.take(from: &buffer, sessionKey: "secret")
+        XCTAssertEqual(request?.id, "7")
+        XCTAssertTrue(buffer.isEmpty)
+
+        let parsed = request?.line?.split(separator: SEP.first!).map { CLISession.unescape(String($0)) }
+        XCTAssertEqual(parsed, args)
+    }
+
+    func testArguments() {
+        XCTAssertEqual(CLISession.arguments(#"displays "dell u2720q" brightness 50"#), ["displays", "dell u2720q", "brightness", "50"])
+        XCTAssertEqual(CLISession.arguments("lunar displays 'built in' contrast 0"), ["displays", "built in", "contrast", "0"])
+        XCTAssertEqual(CLISession.arguments("  displays\tx  # trailing comment"), ["displays", "x"])
+        XCTAssertEqual(CLISession.arguments(#"set "" 1"#), ["set", "", "1"])
+        XCTAssertEqual(CLISession.arguments("preset a#b"), ["preset", "a#b"])
+        XCTAssertEqual(CLISession.arguments("# only a comment"), [])
+        XCTAssertEqual(CLISession.arguments("   "), [])
+    }
+}
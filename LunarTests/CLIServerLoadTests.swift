@@ -0,0 +1,138 @@
+//
+//  CLIServerLoadTests.swift
+//  LunarTests
+//
+//  Created by Alin Panaitiu on 19.10.2026.
+//  Copyright © 2026 Alin. All rights reserved.
+//
+
+import Socket
+import XCTest
+@testable import Lunar
+
+/// Runs a `LunarServer` on an ephemeral port and drives it with concurrent `CLISession` clients.
+final class CLIServerLoadTests: XCTestCase {
+    static let CLIENTS = 50
+    static let REQUESTS_PER_CLIENT = 40
+
+    var server: LunarServer!
+    var port: Int32 = 0
+
+    override func setUpWithError() throws {
+        try XCTSkipIf(CachedDefaults[.apiKey].isEmpty, "no API key to authenticate with")
+
+        server = LunarServer()
+        server.run(host: "127.0.0.1", port: 0)
+
+        let deadline = Date().addingTimeInterval(5)
+        while Date() < deadline {
+            if let listening = server.listenSocket?.listeningPort, listening > 0 {
+                port = listening
+                return
+            }
+            usleep(10000)
+        }
+        XCTFail("CLI server didn't start listening")
+    }
+
+    override func tearDown() {
+        server?.stop()
+        server?.listenSocket?.close()
+        server = nil
+    }
+
+    /// 50 clients each run `lunar key` request after request, reports throughput and latency percentiles
+    func testFiftyConcurrentClients() throws {
+        let key = CachedDefaults[.apiKey]
+        let lock = NSRecursiveLock()
+        var latency = LatencyStats(capacity: Self.CLIENTS * Self.REQUESTS_PER_CLIENT)
+        var wrongOutputs = 0
+
+        let group = DispatchGroup()
+        let clientsQueue = DispatchQueue(label: "fyi.lunar.test.cliClients", attributes: .concurrent)
+        let startedAt = DispatchTime.now()
+
+        // `lunar key` runs on the main thread, which must stay free while the clients wait for it
+        for _ in 0 ..< Self.CLIENTS {
+            clientsQueue.async(group: group) { [port] in
+                guard let client = try? CLISessionClient(host: "127.0.0.1", port: port, key: key) else {
+                    lock.around { latency.recordFailure() }
+                    return
+                }
+                defer { client.close() }
+
+                for id in 0 ..< Self.REQUESTS_PER_CLIENT {
+                    let sentAt = DispatchTime.now()
+                    guard (try? client.send(id: id, args: ["key"])) != nil,
+                          let response = try? client.nextResponse(), response.id == id
+                    else {
+                        lock.around { latency.recordFailure() }
+                        return
+                    }
+
+                    let ms = (DispatchTime.now().rawValue - sentAt.rawValue).d / 1_000_000
+                    lock.around {
+                        latency.record(ms)
+                        if response.output.trimmed != key {
+                            wrongOutputs += 1
+                        }
+                    }
+                }
+            }
+        }
+
+        let finished = expectation(description: "clients finished")
+        group.notify(queue: .main) { finished.fulfill() }
+        wait(for: [finished], timeout: 120)
+
+        let seconds = (DispatchTime.now().rawValue - startedAt.rawValue).d / 1_000_000_000
+        let stats = Lunar.Bench.Stats(latency, retries: 0, seconds: seconds)
+        print("CLI server, \(Self.CLIENTS) clients x \(Self.REQUESTS_PER_CLIENT) requests: \(stats.text)")
+
+        XCTAssertEqual(stats.failures, 0)
+        XCTAssertEqual(stats.count, Self.CLIENTS * Self.REQUESTS_PER_CLIENT)
+        XCTAssertEqual(wrongOutputs, 0)
+    }
+
+    /// A response larger than the socket buffer is queued and drained as the client reads, never truncated
+    func testSlowReaderGetsTheWholeResponse() throws {
+        var fds: [Int32] = [0, 0]
+        XCTAssertEqual(socketpair(AF_UNIX, SOCK_STREAM, 0, &fds), 0)
+        defer { Darwin.close(fds[1]) }
+
+        var sendBuffer: Int32 = 4096
+        setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &sendBuffer, socklen_t(MemoryLayout<Int32>.size))
+
+        let socket = try Socket.create(fromNativeHandle: fds[0], address: nil)
+        defer { socket.close() }
+        try socket.setBlocking(mode: false)
+
+        let connection = LunarServer.Connection(socket: socket)
+        let response = String(repeating: "{\"brightness\": 50}\n", count: 64 * 1024)
+        let expected = Data(response.utf8)
+
+        let drained = expectation(description: "response drained")
+        LunarServer.loopQueue.async { [server] in
+            server!.send(response, on: connection)
+            XCTAssertFalse(connection.drained, "the socket took \(expected.count) bytes at once")
+            server!.whenDrained(connection) { drained.fulfill() }
+        }
+
+        let read = expectation(description: "response read")
+        var received = Data()
+        DispatchQueue.global().async {
+            var buf = [UInt8](repeating: 0, count: 8192)
+            while received.count < expected.count {
+                let n = Darwin.read(fds[1], &buf, buf.count)
+                guard n > 0 else { break }
+                received.append(buf, count: n)
+                usleep(100)
+            }
+            read.fulfill()
+        }
+
+        wait(for: [read, drained], timeout: 60)
+        XCTAssertEqual(received.count, expected.count)
+        XCTAssertEqual(received, expected)
+    }
+}
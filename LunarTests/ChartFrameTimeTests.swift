@@ -0,0 +1,89 @@
+//
+//  ChartFrameTimeTests.swift
+//  LunarTests
+//
+//  Created by Alin Panaitiu on 19.10.2026.
+//  Copyright © 2026 Alin. All rights reserved.
+//
+
+import Charts
+import XCTest
+@testable import Lunar
+
+/// Frame time of the brightness chart before and after LTTB decimation.
+///
+/// Draws a Location mode day (one sample per 5 seconds, as the chart was sampled before decimation)
+/// into an offscreen bitmap, once with every sample and once decimated to the chart width.
+final class ChartFrameTimeTests: XCTestCase {
+    static let width: CGFloat = 560
+
+    static let day: (xs: [Double], brightness: [Double], contrast: [Double]) = {
+        let xs = Array(stride(from: 0.0, to: 14 * 3600, by: 5))
+        let brightness = xs.map { x in 5 + 90 * pow(sin(.pi * x / (14 * 3600)), 1.5) }
+        let contrast = brightness.map { 30 + $0 * 0.4 }
+        return (xs, brightness, contrast)
+    }()
+
+    func chart(_ indices: [Int]) -> LineChartView {
+        let day = Self.day
+        let view = LineChartView(frame: NSRect(x: 0, y: 0, width: Self.width, height: 300))
+
+        let brightness = LineChartDataSet(entries: indices.map { ChartDataEntry(x: day.xs[$0], y: day.brightness[$0]) }, label: "Brightness")
+        let contrast = LineChartDataSet(entries: indices.map { ChartDataEntry(x: day.xs[$0], y: day.contrast[$0]) }, label: "Contrast")
+        for set in [brightness, contrast] {
+            set.mode = .cubicBezier
+            set.cubicIntensity = 0.15
+            set.drawFilledEnabled = true
+            set.drawCirclesEnabled = false
+            set.drawValuesEnabled = false
+        }
+        view.data = LineChartData(dataSets: [brightness, contrast])
+        return view
+    }
+
+    func draw(_ view: LineChartView) {
+        guard let rep = view.bitmapImageRepForCachingDisplay(in: view.bounds) else {
+            XCTFail("no bitmap for \(view.bounds)")
+            return
+        }
+        view.cacheDisplay(in: view.bounds, to: rep)
+    }
+
+    func testDecimationKeepsTheEndsAndFitsTheWidth() {
+        let day = Self.day
+        let threshold = Int(Self.width / CHART_POINT_SPACING)
+        let indices = ChartDataProvider.lttb(xs: day.xs, ys: [day.brightness, day.contrast], threshold: threshold)
+
+        XCTAssertEqual(indices.count, threshold)
+        XCTAssertEqual(indices.first, 0)
+        XCTAssertEqual(indices.last, day.xs.count - 1)
+        XCTAssertEqual(indices, indices.sorted())
+
+        // the noon peak survives decimation
+        let peak = day.brightness.max()!
+        XCTAssertLessThan(peak - indices.map { day.brightness[$0] }.max()!, 1)
+    }
+
+    func testFrameTimeFullResolution() {
+        let view = chart(Array(Self.day.xs.indices))
+        measure {
+            draw(view)
+        }
+    }
+
+    func testFrameTimeDecimated() {
+        let day = Self.day
+        let indices = ChartDataProvider.lttb(xs: day.xs, ys: [day.brightness, day.contrast], threshold: Int(Self.width / CHART_POINT_SPACING))
+        let view = chart(indices)
+        measure {
+            draw(view)
+        }
+    }
+
+    func testDecimationTime() {
+        let day = Self.day
+        measure {
+            _ = ChartDataProvider.lttb(xs: day.xs, ys: [day.brightness, day.contrast], threshold: Int(Self.width / CHART_POINT_SPACING))
+        }
+    }
+}
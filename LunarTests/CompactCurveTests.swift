@@ -0,0 +1,89 @@
+//
+//  CompactCurveTests.swift
+//  LunarTests
+//
+//  Created by Alin Panaitiu on 19.10.2026.
+//  Copyright © 2026 Alin. All rights reserved.
+//
+
+import XCTest
+@testable import Lunar
+
+final class CompactCurveTests: XCTestCase {
+    let mapping = [
+        AutoLearnMapping(source: 0, target: 5),
+        AutoLearnMapping(source: 40.5, target: 50),
+        AutoLearnMapping(source: 100, target: 100),
+    ]
+
+    func testEncodesTwoColumns() throws {
+        let encoder = JSONEncoder()
+        encoder.outputFormatting = [.sortedKeys]
+
+        let json = String(decoding: try encoder.encode(CompactCurve(mapping)), as: UTF8.self)
+        XCTAssertEqual(json, #"{"x":[0,40.5,100],"y":[5,50,100]}"#)
+    }
+
+    func testRoundTrips() throws {
+        let decoded = try JSONDecoder().decode(CompactCurve.self, from: JSONEncoder().encode(CompactCurve(mapping)))
+
+        XCTAssertEqual(decoded.mapping.map(\.source), mapping.map(\.source))
+        XCTAssertEqual(decoded.mapping.map(\.target), mapping.map(\.target))
+    }
+
+    func testEmptyCurve() throws {
+        let decoded = try JSONDecoder().decode(CompactCurve.self, from: Data(#"{"x":[],"y":[]}"#.utf8))
+        XCTAssertTrue(decoded.mapping.isEmpty)
+    }
+
+    func testMismatchedColumnsKeepTheCompletePairs() throws {
+        let decoded = try JSONDecoder().decode(CompactCurve.self, from: Data(#"{"x":[1,2,3],"y":[10,20]}"#.utf8))
+        XCTAssertEqual(decoded.mapping.map(\.source), [1, 2])
+        XCTAssertEqual(decoded.mapping.map(\.target), [10, 20])
+    }
+
+    /// A display with learned curves of typical length (70 points in total), as DisplayPersistence stores it
+    func display() -> Display {
+        var rng = SplitMix64(seed: 0x4355_5256)
+        let curve = { (count: Int) -> [AutoLearnMapping] in
+            let xs = (0 ..< count).map { _ in Double(Int.random(in: 0 ... 1000, using: &rng)) / 10 }.sorted()
+            let ys = (0 ..< count).map { _ in Double(Int.random(in: 0 ... 100, using: &rng)) }.sorted()
+            return zip(xs, ys).map { AutoLearnMapping(source: $0, target: $1) }
+        }
+
+        let display = Display(id: GENERIC_DISPLAY_ID, serial: "compact-curves-test", name: "Compact Curves Test")
+        display.syncBrightnessMapping = ["AAAAAAAA-BBBB-CCCC-DDDD-000000000000": curve(10)]
+        display.syncContrastMapping = ["AAAAAAAA-BBBB-CCCC-DDDD-000000000000": curve(10)]
+        display.sensorBrightnessMapping = curve(12)
+        display.sensorContrastMapping = curve(12)
+        display.locationBrightnessMapping = curve(5)
+        display.locationContrastMapping = curve(5)
+        #if arch(arm64)
+            display.nitsBrightnessMapping = curve(8)
+            display.nitsContrastMapping = curve(8)
+        #endif
+        return display
+    }
+
+    func testCompactEncodingWritesOnlyTheCurvesKey() throws {
+        let display = display()
+        let compactEncoder = JSONEncoder()
+        compactEncoder.userInfo[.compactCurves] = true
+
+        let legacy = try JSONEncoder().encode(display)
+        let compact = try compactEncoder.encode(display)
+        print("Display encoding: \(legacy.count) bytes with mapping keys, \(compact.count) bytes with compact curves")
+
+        let keys = try XCTUnwrap(JSONSerialization.jsonObject(with: compact) as? [String: Any]).keys
+        XCTAssertTrue(keys.contains("curves"))
+        XCTAssertFalse(keys.contains { $0.hasSuffix("Mapping") }, "\(keys.sorted())")
+        XCTAssertLessThan(compact.count, legacy.count)
+
+        for data in [legacy, compact] {
+            let decoded = try JSONDecoder().decode(Display.self, from: data)
+            XCTAssertEqual(decoded.sensorBrightnessMapping.map(\.source), display.sensorBrightnessMapping.map(\.source))
+            XCTAssertEqual(decoded.locationContrastMapping.map(\.target), display.locationContrastMapping.map(\.target))
+            XCTAssertEqual(decoded.syncBrightnessMapping.mapValues { $0.map(\.target) }, display.syncBrightnessMapping.mapValues { $0.map(\.target) })
+        }
+    }
+}
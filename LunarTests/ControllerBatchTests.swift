@@ -0,0 +1,119 @@
+//
+//  ControllerBatchTests.swift
+//  LunarTests
+//
+//  Created by Alin Panaitiu on 19.10.2026.
+//  Copyright © 2026 Alin. All rights reserved.
+//
+
+import XCTest
+@testable import Lunar
+
+/// Sends presets (3 displays × 3 controls behind one controller) through `ControllerClient` to a `StandInController`
+final class ControllerBatchTests: XCTestCase {
+    static let CONTROLS = ["brightness", "contrast", "volume"]
+
+    var controller: StandInController?
+
+    override func tearDown() {
+        controller?.stop()
+        controller = nil
+    }
+
+    func preset(_ value: Int, on controller: StandInController) -> [(key: String, url: URL, batch: BatchWrite?)] {
+        (1 ... 3).flatMap { display in
+            Self.CONTROLS.map { control in
+                (key: "\(display):\(control)", url: controller.url / display / control / value, batch: BatchWrite(display: display, control: control, value: UInt16(value)))
+            }
+        }
+    }
+
+    func send(_ writes: [(key: String, url: URL, batch: BatchWrite?)], with client: ControllerClient) -> [String?] {
+        let done = expectation(description: "responses")
+        var responses: [String?] = []
+        client.enqueue(writes, timeout: 5) {
+            responses = $0
+            done.fulfill()
+        }
+        wait(for: [done], timeout: 30)
+        return responses
+    }
+
+    func testPresetGoesOutInOneRoundTrip() throws {
+        let controller = try StandInController()
+        self.controller = controller
+        let client = ControllerClient(host: "127.0.0.1", port: controller.port.i, maxInFlight: 2)
+
+        let responses = send(preset(50, on: controller), with: client)
+
+        XCTAssertEqual(responses, [String?](repeating: "50", count: 9))
+        XCTAssertEqual(controller.requests.map(\.path), ["/batch"])
+        XCTAssertEqual(client.supportsBatch, true)
+    }
+
+    func testAnyRejectedBatchFallsBackToSingleRequests() throws {
+        for status in [400, 404, 405, 500, 501, 503] {
+            let controller = try StandInController(batch: .rejected(status: status))
+            defer { controller.stop() }
+            let client = ControllerClient(host: "127.0.0.1", port: controller.port.i, maxInFlight: 2)
+
+            let responses = send(preset(50, on: controller), with: client)
+            XCTAssertEqual(responses, [String?](repeating: "ok", count: 9), "status \(status)")
+            XCTAssertEqual(client.supportsBatch, false, "status \(status)")
+            XCTAssertEqual(controller.requests.filter { $0.path == "/batch" }.count, 1, "status \(status)")
+            XCTAssertEqual(controller.requests.filter { $0.path != "/batch" }.count, 9, "status \(status)")
+
+            // the controller is remembered as single-request only
+            _ = send(preset(60, on: controller), with: client)
+            XCTAssertEqual(controller.requests.filter { $0.path == "/batch" }.count, 1, "status \(status)")
+        }
+    }
+
+    func testReplacedWritesCompleteWithoutAResponse() throws {
+        let controller = try StandInController()
+        self.controller = controller
+        let client = ControllerClient(host: "127.0.0.1", port: controller.port.i, maxInFlight: 1)
+
+        let url = controller.url / 1 / "brightness"
+        let responses = send([
+            (key: "1:brightness", url: url / 10, batch: BatchWrite(display: 1, control: "brightness", value: 10)),
+            (key: "1:brightness", url: url / 20, batch: BatchWrite(display: 1, control: "brightness", value: 20)),
+        ], with: client)
+
+        XCTAssertEqual(responses, [nil, "ok"])
+        XCTAssertEqual(controller.requests.map(\.path), ["/1/brightness/20"])
+    }
+
+    /// Preset latency with 5ms per request on the controller, one `/batch` against nine single requests
+    func testPresetLatency() throws {
+        let presets = 40
+
+        func run(_ batch: StandInController.BatchMode) throws -> Lunar.Bench.Stats {
+            let controller = try StandInController(batch: batch, delay: 0.005)
+            defer { controller.stop() }
+            let client = ControllerClient(host: "127.0.0.1", port: controller.port.i, maxInFlight: 1)
+            _ = send(preset(0, on: controller), with: client)
+
+            var latency = LatencyStats(capacity: presets)
+            let startedAt = DispatchTime.now()
+            for i in 1 ... presets {
+                let sentAt = DispatchTime.now()
+                let responses = send(preset(i, on: controller), with: client)
+                if responses.contains(where: { $0 == nil }) {
+                    latency.recordFailure()
+                } else {
+                    latency.record((DispatchTime.now().rawValue - sentAt.rawValue).d / 1_000_000)
+                }
+            }
+            return Lunar.Bench.Stats(latency, retries: 0, seconds: (DispatchTime.now().rawValue - startedAt.rawValue).d / 1_000_000_000)
+        }
+
+        let batched = try run(.supported)
+        let singles = try run(.rejected(status: 404))
+        print("Preset over /batch:           \(batched.text)")
+        print("Preset over single requests:  \(singles.text)")
+
+        XCTAssertEqual(batched.failures + singles.failures, 0)
+        XCTAssertLessThan(batched.p50!, singles.p50!)
+    }
+}
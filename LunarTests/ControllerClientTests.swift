@@ -0,0 +1,82 @@
+//
+//  ControllerClientTests.swift
+//  LunarTests
+//
+//  Created by Alin Panaitiu on 19.10.2026.
+//  Copyright © 2026 Alin. All rights reserved.
+//
+
+import XCTest
+@testable import Lunar
+
+/// Set latency, connection reuse and coalescing of `ControllerClient` against a `StandInController`
+final class ControllerClientTests: XCTestCase {
+    var controller: StandInController?
+
+    override func tearDown() {
+        controller?.stop()
+        controller = nil
+    }
+
+    /// 3 displays × 2 controls written concurrently, each control waiting for its previous write, with 2ms per request on the controller
+    func testSetLatency() throws {
+        let controller = try StandInController(batch: .rejected(status: 404), delay: 0.002)
+        self.controller = controller
+        let client = ControllerClient(host: "127.0.0.1", port: controller.port.i, maxInFlight: 4)
+
+        let keys = (1 ... 3).flatMap { display in ["brightness", "contrast"].map { (display, $0) } }
+        let writesPerKey = 100
+        let lock = NSRecursiveLock()
+        var latency = LatencyStats(capacity: keys.count * writesPerKey)
+
+        let startedAt = DispatchTime.now()
+        DispatchQueue.concurrentPerform(iterations: keys.count) { i in
+            let (display, control) = keys[i]
+            for value in 0 ..< writesPerKey {
+                let done = DispatchSemaphore(value: 0)
+                let sentAt = DispatchTime.now()
+                var response: String?
+                client.enqueue(key: "\(display):\(control)", url: controller.url / display / control / value, timeout: 5) {
+                    response = $0
+                    done.signal()
+                }
+                guard done.wait(timeout: .now() + 10) == .success, response != nil else {
+                    lock.around { latency.recordFailure() }
+                    continue
+                }
+                let ms = (DispatchTime.now().rawValue - sentAt.rawValue).d / 1_000_000
+                lock.around { latency.record(ms) }
+            }
+        }
+
+        let seconds = (DispatchTime.now().rawValue - startedAt.rawValue).d / 1_000_000_000
+        let stats = Lunar.Bench.Stats(latency, retries: 0, seconds: seconds)
+        print("Controller sets, \(keys.count) controls x \(writesPerKey) writes, maxInFlight 4: \(stats.text), connections=\(controller.connections)")
+
+        XCTAssertEqual(stats.failures, 0)
+        XCTAssertEqual(stats.count, keys.count * writesPerKey)
+        // keep-alive: the writes share at most `maxInFlight` connections instead of opening one each
+        XCTAssertLessThanOrEqual(controller.connections, client.maxInFlight)
+    }
+
+    func testWritesForTheSameControlAreCoalesced() throws {
+        let controller = try StandInController(batch: .rejected(status: 404), delay: 0.02)
+        self.controller = controller
+        let client = ControllerClient(host: "127.0.0.1", port: controller.port.i, maxInFlight: 2)
+
+        let last = expectation(description: "last value sent")
+        for value in 0 ... 50 {
+            client.enqueue(key: "1:brightness", url: controller.url / 1 / "brightness" / value, timeout: 5) { _ in
+                if value == 50 {
+                    last.fulfill()
+                }
+            }
+        }
+        wait(for: [last], timeout: 10)
+
+        let paths = controller.requests.map(\.path)
+        XCTAssertEqual(paths.last, "/1/brightness/50")
+        XCTAssertLessThan(paths.count, 51)
+        XCTAssertEqual(client.coalesced, 51 - paths.count)
+    }
+}
@@ -0,0 +1,38 @@
+//
+//  HealthMetricsTests.swift
+//  LunarTests
+//
+//  Created by Alin Panaitiu on 19.10.2026.
+//  Copyright © 2026 Alin. All rights reserved.
+//
+
+import XCTest
+@testable import Lunar
+
+final class HealthMetricsTests: XCTestCase {
+    static let ID: CGDirectDisplayID = 0x4C55_4E41
+
+    func testRendersRegisteredNamesFromAnyThread() {
+        let metrics = HealthMetrics()
+        metrics.display(Self.ID).networkWrite.observe(seconds: 0.003)
+        metrics.register(names: [Self.ID: #"DELL "U2720Q""#])
+
+        let out = DispatchQueue.global().sync { metrics.render() }
+
+        let labels = #"display="\#(Self.ID)",name="DELL \"U2720Q\"""#
+        XCTAssertTrue(out.contains(#"lunar_control_write_duration_seconds_bucket{\#(labels),control="network",le="0.005"} 1"#), out)
+        XCTAssertTrue(out.contains(#"lunar_control_write_duration_seconds_count{\#(labels),control="ddcctl"} 0"#), out)
+    }
+
+    func testRegisteringKeepsNamesOfOtherDisplays() {
+        let metrics = HealthMetrics()
+        metrics.display(Self.ID).gammaApplications.increment()
+        metrics.display(Self.ID + 1).gammaApplications.increment()
+        metrics.register(names: [Self.ID: "One", Self.ID + 1: "Two"])
+        metrics.register(names: [Self.ID + 1: "Renamed"])
+
+        let out = metrics.render()
+        XCTAssertTrue(out.contains(#"lunar_gamma_applications_total{display="\#(Self.ID)",name="One"} 1"#), out)
+        XCTAssertTrue(out.contains(#"lunar_gamma_applications_total{display="\#(Self.ID + 1)",name="Renamed"} 1"#), out)
+    }
+}
@@ -0,0 +1,192 @@
+//
+//  JSONStreamWriterTests.swift
+//  LunarTests
+//
+//  Created by Alin Panaitiu on 19.10.2026.
+//  Copyright © 2026 Alin. All rights reserved.
+//
+
+import XCTest
+@testable import Lunar
+
+final class JSONStreamWriterTests: XCTestCase {
+    func testWritesCommasAndNesting() {
+        var writer = JSONStreamWriter()
+        writer.beginObject()
+        writer.key("a")
+        writer.value(1.5)
+        writer.key("b")
+        writer.beginObject()
+        writer.endObject()
+        writer.key("c")
+        writer.beginObject()
+        writer.key("d")
+        writer.value(true)
+        writer.key("e")
+        writer.null()
+        writer.endObject()
+        writer.key("f")
+        writer.value(Int64(-3))
+        writer.endObject()
+
+        XCTAssertEqual(writer.string, #"{"a":1.5,"b":{},"c":{"d":true,"e":null},"f":-3}"#)
+    }
+
+    func testNumbersMatchJSONEncoder() throws {
+        for value in [0.0, 50.0, -2.0, 0.25, 33.5] {
+            var writer = JSONStreamWriter()
+            writer.value(value)
+            XCTAssertEqual(writer.string, String(decoding: try JSONEncoder().encode(value), as: UTF8.self))
+        }
+
+        var writer = JSONStreamWriter()
+        writer.value(Double.nan)
+        XCTAssertEqual(writer.string, "null")
+    }
+
+    func testEscapesStrings() throws {
+        let string = "quote \" backslash \\ newline \n tab \t bell \u{07} ünicode"
+        var writer = JSONStreamWriter()
+        writer.value(string)
+
+        XCTAssertEqual(try JSONDecoder().decode(String.self, from: writer.bytes), string)
+    }
+
+    // MARK: - ProjectingEncoder
+
+    func project(_ value: Encodable, _ fields: [String]) throws -> String {
+        var writer = JSONStreamWriter()
+        try ProjectingEncoder.write(value, fields: fields, to: &writer)
+        return writer.string
+    }
+
+    func testProjectsTheRequestedFieldsInOrder() throws {
+        let sample = Sample(
+            name: #"DELL "U2720Q""#, brightness: 50, enabled: true, missing: nil,
+            inner: .init(a: 1, b: "x"), expensive: Exploding()
+        )
+
+        XCTAssertEqual(
+            try project(sample, ["inner", "brightness", "name", "missing", "unknown"]),
+            #"{"inner":{"a":1,"b":"x"},"brightness":50,"name":"DELL \"U2720Q\""}"#
+        )
+        XCTAssertEqual(try project(sample, []), "{}")
+    }
+
+    func testProjectedValuesMatchJSONEncoder() throws {
+        let sample = Sample(name: "LG", brightness: 33.3, enabled: false, missing: 7, inner: .init(a: 2, b: "y"), expensive: Exploding())
+        let projected = try project(sample, ["name", "brightness", "enabled", "missing", "inner"])
+
+        let full = try JSONSerialization.jsonObject(with: JSONEncoder().encode(Projected(sample))) as! NSDictionary
+        let partial = try JSONSerialization.jsonObject(with: Data(projected.utf8)) as! NSDictionary
+        XCTAssertEqual(partial, full)
+    }
+
+    func testMergesNestedContainerMembers() throws {
+        XCTAssertEqual(try project(WithNested(), ["limits", "id"]), #"{"limits":{"min":0,"max":100},"id":3}"#)
+        XCTAssertEqual(try project(WithNested(), ["id"]), #"{"id":3}"#)
+    }
+
+    // MARK: - lunar displays --fields
+
+    static let DISPLAY_FIELDS = DisplayFields(argument: "name,brightness,contrast,audioMuted")!
+
+    /// What `lunar displays --json` encodes per display, the whole dictionary through `ForgivingEncodable`
+    func fullEncode(_ display: Display) throws -> Data {
+        try Lunar.encoder.encode(ForgivingEncodable(XCTUnwrap(display.dictionary)))
+    }
+
+    /// What `lunar displays --json --fields` encodes per display
+    func fieldsEncode(_ display: Display) throws -> Data {
+        var writer = JSONStreamWriter()
+        try ProjectingEncoder.write(display, fields: Self.DISPLAY_FIELDS.names, to: &writer)
+        return writer.bytes
+    }
+
+    func testDisplayFieldsBytesPerCall() throws {
+        let display = Display(id: GENERIC_DISPLAY_ID, serial: "fields-bench", name: "Fields Bench")
+        let full = try fullEncode(display)
+        let fields = try fieldsEncode(display)
+        print("lunar displays --json: \(full.count) bytes per display, --fields \(Self.DISPLAY_FIELDS.names.joined(separator: ",")): \(fields.count) bytes")
+
+        let projected = try JSONSerialization.jsonObject(with: fields) as! [String: Any]
+        XCTAssertEqual(Set(projected.keys), Set(Self.DISPLAY_FIELDS.names))
+        XCTAssertLessThan(fields.count, full.count)
+    }
+
+    func testFullDisplayEncodeTime() throws {
+        let display = Display(id: GENERIC_DISPLAY_ID, serial: "fields-bench", name: "Fields Bench")
+        measure {
+            for _ in 0 ..< 100 {
+                _ = try? fullEncode(display)
+            }
+        }
+    }
+
+    func testDisplayFieldsEncodeTime() throws {
+        let display = Display(id: GENERIC_DISPLAY_ID, serial: "fields-bench", name: "Fields Bench")
+        measure {
+            for _ in 0 ..< 100 {
+                _ = try? fieldsEncode(display)
+            }
+        }
+    }
+}
+
+private struct Inner: Codable {
+    let a: Int
+    let b: String
+}
+
+/// Fails the test if encoded, fields that weren't requested must be skipped without encoding them
+private struct Exploding: Encodable {
+    func encode(to _: Encoder) throws {
+        XCTFail("Skipped fields shouldn't be encoded")
+    }
+}
+
+private struct Sample: Encodable {
+    let name: String
+    let brightness: Double
+    let enabled: Bool
+    let missing: Int?
+    let inner: Inner
+    let expensive: Exploding
+}
+
+/// `Sample` without the field that can't be encoded, to compare against `JSONEncoder`
+private struct Projected: Encodable {
+    init(_ sample: Sample) {
+        name = sample.name
+        brightness = sample.brightness
+        enabled = sample.enabled
+        missing = sample.missing
+        inner = sample.inner
+    }
+
+    let name: String
+    let brightness: Double
+    let enabled: Bool
+    let missing: Int?
+    let inner: Inner
+}
+
+private struct WithNested: Encodable {
+    enum CodingKeys: String, CodingKey {
+        case id
+        case limits
+    }
+
+    enum LimitKeys: String, CodingKey {
+        case min
+        case max
+    }
+
+    func encode(to encoder: Encoder) throws {
+        var container = encoder.container(keyedBy: CodingKeys.self)
+        try container.encode(3, forKey: .id)
+        var limits = container.nestedContainer(keyedBy: LimitKeys.self, forKey: .limits)
+        try limits.encode(0, forKey: .min)
+        try limits.encode(100, forKey: .max)
+    }
+}
@@ -0,0 +1,90 @@
+//
+//  LuxReplayTests.swift
+//  LunarTests
+//
+//  Created by Alin Panaitiu on 19.10.2026.
+//  Copyright © 2026 Alin. All rights reserved.
+//
+
+import XCTest
+@testable import Lunar
+
+/// Replays a day of 1 Hz ambient light readings through `LuxStatistics`.
+///
+/// There is no recorded sensor log in the tree, so the day is generated from a seeded model of an
+/// indoor sensor: a daylight curve, slow cloud cover, per-sample noise and the occasional spike
+/// from a reflection or someone walking past the sensor.
+final class LuxReplayTests: XCTestCase {
+    static let day: [Double] = {
+        var rng = SplitMix64(seed: 0x4C55_58)
+        var clouds = 1.0
+        return (0 ..< 86400).map { second in
+            let hour = second.d / 3600
+            let sun = max(0, sin(.pi * (hour - 6) / 13))
+            clouds = cap(clouds + Double.random(in: -0.004 ... 0.004, using: &rng), minVal: 0.35, maxVal: 1)
+
+            var lux = 3 + 900 * pow(sun, 1.4) * clouds
+            lux *= 1 + Double.random(in: -0.03 ... 0.03, using: &rng)
+            if Int.random(in: 0 ..< 500, using: &rng) == 0 {
+                lux *= Double.random(in: 3 ... 8, using: &rng)
+            }
+            return lux
+        }
+    }()
+
+    func replay(_ samples: [Double]) -> (published: [Double], last: Double?) {
+        let stats = LuxStatistics(windowSize: 15, alpha: 0.3, logThreshold: 0.04, deadband: 1, rateLimit: 1)
+        let start = Date(timeIntervalSinceReferenceDate: 0)
+        var published: [Double] = []
+        published.reserveCapacity(2048)
+
+        for (second, lux) in samples.enumerated() {
+            if let value = stats.push(lux, at: start.addingTimeInterval(second.d)) {
+                published.append(value)
+            }
+        }
+        return (published, stats.snapshot.filtered)
+    }
+
+    func testRecordedDayPublishesAFractionOfTheReadings() {
+        let samples = Self.day
+        let (published, _) = replay(samples)
+
+        print("LuxStatistics: \(samples.count) readings, \(published.count) published (\(published.count * 100 / samples.count)%)")
+        XCTAssertGreaterThan(published.count, 24)
+        XCTAssertLessThan(published.count, samples.count / 20)
+    }
+
+    func testRecordedDayStaysCloseToTheLightLevel() {
+        let samples = Self.day
+        let stats = LuxStatistics(windowSize: 15, alpha: 0.3, logThreshold: 0.04, deadband: 1, rateLimit: 1)
+        let start = Date(timeIntervalSinceReferenceDate: 0)
+
+        for (second, lux) in samples.enumerated() {
+            stats.push(lux, at: start.addingTimeInterval(second.d))
+            guard second % 600 == 599, let filtered = stats.snapshot.filtered else { continue }
+
+            let window = samples[(second - 59) ... second].sorted()
+            let median = window[window.count / 2]
+            XCTAssertLessThan(abs(log10(filtered + 1) - log10(median + 1)), 0.15, "at \(second)s: \(filtered) vs \(median)")
+        }
+    }
+
+    func testSpikesAloneAreNotPublished() {
+        var samples = [Double](repeating: 400, count: 600)
+        for i in stride(from: 30, to: samples.count, by: 45) {
+            samples[i] = 3000
+        }
+        let (published, last) = replay(samples)
+
+        XCTAssertEqual(published, [400])
+        XCTAssertEqual(last, 400)
+    }
+
+    func testRecordedDayReplayTime() {
+        let samples = Self.day
+        measure {
+            _ = replay(samples)
+        }
+    }
+}
@@ -0,0 +1,64 @@
+//
+//  MonotonicInsertTests.swift
+//  LunarTests
+//
+//  Created by Alin Panaitiu on 19.10.2026.
+//  Copyright © 2026 Alin. All rights reserved.
+//
+
+import XCTest
+@testable import Lunar
+
+final class MonotonicInsertTests: XCTestCase {
+    func testEvictsOnlyThePointsThatBreakMonotonicity() {
+        var points: [Double: Double] = [0: 0, 10: 20, 20: 40, 30: 60, 40: 80]
+        let removed = Display.insertMonotonic(25, 30, in: &points)
+
+        XCTAssertEqual(removed.map(\.0), [20])
+        XCTAssertEqual(points, [0: 0, 10: 20, 25: 30, 30: 60, 40: 80])
+    }
+
+    func testEvictsOnBothSides() {
+        var points: [Double: Double] = [0: 0, 10: 50, 20: 55, 30: 60, 40: 80]
+        let removed = Display.insertMonotonic(25, 55, in: &points)
+
+        XCTAssertEqual(Set(removed.map(\.0)), [10, 20])
+        XCTAssertEqual(points, [0: 0, 25: 55, 30: 60, 40: 80])
+    }
+
+    func testReplacesThePointAtTheSameFeatureValue() {
+        var points: [Double: Double] = [10: 20, 50: 60]
+        let removed = Display.insertMonotonic(10, 30, in: &points)
+
+        XCTAssertTrue(removed.isEmpty)
+        XCTAssertEqual(points, [10: 30, 50: 60])
+    }
+
+    func testRandomInsertsKeepTheCurveStrictlyIncreasing() {
+        var rng = SplitMix64(seed: 0x4C55_4E41_52)
+
+        for _ in 0 ..< 50 {
+            var points: [Double: Double] = [:]
+            for _ in 0 ..< 40 {
+                let x = Double(Int.random(in: 0 ... 100, using: &rng))
+                let y = Double(Int.random(in: 0 ... 100, using: &rng))
+                let before = points
+                let removed = Display.insertMonotonic(x, y, in: &points)
+
+                XCTAssertEqual(points[x], y)
+
+                let sorted = points.sorted { $0.key < $1.key }
+                for (a, b) in zip(sorted, sorted.dropFirst()) {
+                    XCTAssertLessThan(a.value, b.value, "\(sorted)")
+                }
+
+                // nothing is evicted unless it conflicts with the new point
+                for (rx, ry) in removed {
+                    XCTAssertTrue((rx < x && ry >= y) || (rx > x && ry <= y), "evicted \(rx) => \(ry) for \(x) => \(y)")
+                    XCTAssertEqual(before[rx], ry)
+                }
+                XCTAssertEqual(points.count, before.count - removed.count + (before[x] == nil ? 1 : 0))
+            }
+        }
+    }
+}
@@ -0,0 +1,31 @@
+//
+//  QueueDictionary.swift
+//  LunarTests
+//
+//  Created by Alin Panaitiu on 19.10.2026.
+//  Copyright © 2026 Alin. All rights reserved.
+//
+
+import Foundation
+
+// MARK: - QueueDictionary
+
+/// The queue-based `ThreadSafeDictionary` that `CachedDefaults` and the DDC maps used before the atomic snapshots,
+/// kept as the baseline for the concurrent read benchmarks: reads are `sync` on a concurrent queue, writes are barrier blocks.
+final class QueueDictionary<V: Hashable, T> {
+    init(dict: [V: T] = [:]) {
+        storage = dict
+    }
+
+    subscript(key: V) -> T? {
+        get { queue.sync { storage[key] } }
+        set {
+            queue.async(flags: .barrier) {
+                self.storage[key] = newValue
+            }
+        }
+    }
+
+    private var storage: [V: T]
+    private let queue = DispatchQueue(label: "QueueDictionary", attributes: .concurrent)
+}
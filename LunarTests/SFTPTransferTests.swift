@@ -0,0 +1,73 @@
+//
+//  SFTPTransferTests.swift
+//  LunarTests
+//
+//  Created by Alin Panaitiu on 19.10.2026.
+//  Copyright © 2026 Alin. All rights reserved.
+//
+
+import XCTest
+@testable import Lunar
+
+/// Upload and download throughput of `SFTP` against a `StandInSSHD`, 32KB chunks against the default pipelined chunk size
+final class SFTPTransferTests: XCTestCase {
+    static let FILE_SIZE = 32 * 1024 * 1024
+    static let SMALL_CHUNK = 32 * 1024
+
+    var sshd: StandInSSHD?
+
+    override func tearDown() {
+        sshd?.stop()
+        sshd = nil
+    }
+
+    func testThroughput() throws {
+        let sshd = try StandInSSHD()
+        self.sshd = sshd
+
+        var rng = SplitMix64(seed: 41)
+        var data = Data(count: Self.FILE_SIZE)
+        data.withUnsafeMutableBytes { bytes in
+            for i in 0 ..< Self.FILE_SIZE / 8 {
+                bytes.storeBytes(of: rng.next(), toByteOffset: i * 8, as: UInt64.self)
+            }
+        }
+        let local = sshd.dir / "local.bin"
+        try data.write(to: local)
+
+        let pool = SSHPool()
+        defer { pool.removeAll() }
+        let lease = try pool.lease(host: sshd.host, port: sshd.port, username: sshd.username, authMethod: sshd.key)
+        defer { lease.release() }
+        let sftp = try lease.ssh.openSftp()
+
+        func megabytesPerSecond(_ seconds: Double) -> Double {
+            Self.FILE_SIZE.d / 1_048_576 / seconds
+        }
+
+        for chunkSize in [Self.SMALL_CHUNK, SFTP.DEFAULT_CHUNK_SIZE] {
+            sftp.chunkSize = chunkSize
+            let remote = (sshd.dir / "remote-\(chunkSize).bin").path
+            let downloaded = sshd.dir / "downloaded-\(chunkSize).bin"
+
+            var startedAt = DispatchTime.now()
+            var lastProgress: SFTP.TransferProgress?
+            try sftp.upload(localURL: local, remotePath: remote) { lastProgress = $0 }
+            let upload = (DispatchTime.now().rawValue - startedAt.rawValue).d / 1_000_000_000
+
+            startedAt = DispatchTime.now()
+            try sftp.download(remotePath: remote, localURL: downloaded)
+            let download = (DispatchTime.now().rawValue - startedAt.rawValue).d / 1_000_000_000
+
+            print(String(
+                format: "SFTP, %dMB in %dKB chunks: upload %.1fMB/s, download %.1fMB/s",
+                Self.FILE_SIZE / 1_048_576, chunkSize / 1024, megabytesPerSecond(upload), megabytesPerSecond(download)
+            ))
+
+            XCTAssertEqual(lastProgress?.bytes, Self.FILE_SIZE)
+            XCTAssertEqual(lastProgress?.fraction, 1)
+            XCTAssertEqual(try Data(contentsOf: URL(fileURLWithPath: remote)), data, "upload in \(chunkSize)B chunks")
+            XCTAssertEqual(try Data(contentsOf: downloaded), data, "download in \(chunkSize)B chunks")
+        }
+    }
+}
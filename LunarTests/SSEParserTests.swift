@@ -0,0 +1,80 @@
+//
+//  SSEParserTests.swift
+//  LunarTests
+//
+//  Created by Alin Panaitiu on 19.10.2026.
+//  Copyright © 2026 Alin. All rights reserved.
+//
+
+import XCTest
+@testable import Lunar
+
+final class SSEParserTests: XCTestCase {
+    static let STATE = "event: state\ndata: {\"id\":\"sensor-ambient_light\",\"value\":12.5,\"state\":\"12.5 lx\"}\n\n"
+
+    func events(_ chunks: [String]) -> [String] {
+        var parser = SSEParser()
+        var events: [String] = []
+        for chunk in chunks {
+            parser.feed(Data(chunk.utf8)) { event, data in
+                events.append("\(String(decoding: event, as: UTF8.self))|\(String(decoding: data, as: UTF8.self))")
+            }
+        }
+        return events
+    }
+
+    func testParsesOneEvent() {
+        XCTAssertEqual(events([Self.STATE]), ["state|{\"id\":\"sensor-ambient_light\",\"value\":12.5,\"state\":\"12.5 lx\"}"])
+    }
+
+    func testEventsSplitAcrossReads() {
+        let whole = events([Self.STATE + Self.STATE])
+        XCTAssertEqual(whole.count, 2)
+
+        let bytewise = events((Self.STATE + Self.STATE).map { String($0) })
+        XCTAssertEqual(bytewise, whole)
+
+        let odd = Self.STATE + Self.STATE
+        let cut = odd.index(odd.startIndex, offsetBy: 17)
+        XCTAssertEqual(events([String(odd[..<cut]), String(odd[cut...])]), whole)
+    }
+
+    func testCRLFLineEndings() {
+        let crlf = Self.STATE.replacingOccurrences(of: "\n", with: "\r\n")
+        XCTAssertEqual(events([crlf]), events([Self.STATE]))
+    }
+
+    func testJoinsDataLinesAndSkipsCommentsAndEmptyEvents() {
+        let stream = ": keepalive\n\nevent: ping\n\nevent: log\ndata: first\ndata: second\n\n"
+        XCTAssertEqual(events([stream]), ["log|first\nsecond"])
+    }
+
+    func testResetDropsAPartialEvent() {
+        var parser = SSEParser()
+        var count = 0
+        parser.feed(Data("event: state\ndata: {\"value\":1}".utf8)) { _, _ in count += 1 }
+        parser.reset()
+        parser.feed(Data("\n\n".utf8)) { _, _ in count += 1 }
+        XCTAssertEqual(count, 0)
+    }
+
+    func testNumber() {
+        let key = Array("\"value\":".utf8)
+        let number = { (json: String) in SSEParser.number(for: key, in: Array(json.utf8)) }
+
+        XCTAssertEqual(number("{\"value\":12.5}")!, 12.5, accuracy: 1e-9)
+        XCTAssertEqual(number("{\"value\": -3}")!, -3, accuracy: 1e-9)
+        XCTAssertEqual(number("{\"value\":1e3}")!, 1000, accuracy: 1e-9)
+        XCTAssertEqual(number("{\"value\":2.5E-1}")!, 0.25, accuracy: 1e-9)
+        XCTAssertNil(number("{\"value\":null}"))
+        XCTAssertNil(number("{\"value\":\"NaN\"}"))
+        XCTAssertNil(number("{\"other\":1}"))
+    }
+
+    func testFindReturnsTheIndexAfterTheNeedle() {
+        let bytes = Array("{\"id\":\"x\"}".utf8)
+        XCTAssertEqual(SSEParser.find(Array("\"id\":".utf8), in: bytes), 6)
+        XCTAssertNil(SSEParser.find(Array("\"value\":".utf8), in: bytes))
+        XCTAssertNil(SSEParser.find([], in: bytes))
+    }
+}
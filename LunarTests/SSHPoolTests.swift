@@ -0,0 +1,87 @@
+//
+//  SSHPoolTests.swift
+//  LunarTests
+//
+//  Created by Alin Panaitiu on 19.10.2026.
+//  Copyright © 2026 Alin. All rights reserved.
+//
+
+import XCTest
+@testable import Lunar
+
+/// Sequential installer-like commands against a `StandInSSHD`, one session per command against one pooled session
+final class SSHPoolTests: XCTestCase {
+    static let COMMANDS = 20
+
+    var sshd: StandInSSHD?
+
+    override func tearDown() {
+        sshd?.stop()
+        sshd = nil
+    }
+
+    func testPooledCommandsConnectOnce() throws {
+        let sshd = try StandInSSHD()
+        self.sshd = sshd
+
+        var fresh = LatencyStats(capacity: Self.COMMANDS)
+        var startedAt = DispatchTime.now()
+        for i in 0 ..< Self.COMMANDS {
+            let sentAt = DispatchTime.now()
+            var output = ""
+            try SSH.connect(host: sshd.host, port: sshd.port, username: sshd.username, authMethod: sshd.key) { ssh in
+                output = try ssh.capture("echo \(i)").output
+            }
+            fresh.record((DispatchTime.now().rawValue - sentAt.rawValue).d / 1_000_000)
+            XCTAssertEqual(output.trimmingCharacters(in: .whitespacesAndNewlines), "\(i)")
+        }
+        let freshStats = Lunar.Bench.Stats(fresh, retries: 0, seconds: (DispatchTime.now().rawValue - startedAt.rawValue).d / 1_000_000_000)
+
+        let pool = SSHPool()
+        defer { pool.removeAll() }
+        var pooled = LatencyStats(capacity: Self.COMMANDS)
+        startedAt = DispatchTime.now()
+        for i in 0 ..< Self.COMMANDS {
+            let sentAt = DispatchTime.now()
+            let lease = try pool.lease(host: sshd.host, port: sshd.port, username: sshd.username, authMethod: sshd.key)
+            let output = try lease.ssh.capture("echo \(i)").output
+            lease.release()
+            pooled.record((DispatchTime.now().rawValue - sentAt.rawValue).d / 1_000_000)
+            XCTAssertEqual(output.trimmingCharacters(in: .whitespacesAndNewlines), "\(i)")
+        }
+        let pooledStats = Lunar.Bench.Stats(pooled, retries: 0, seconds: (DispatchTime.now().rawValue - startedAt.rawValue).d / 1_000_000_000)
+
+        print("SSH, \(Self.COMMANDS) commands, connect per command: \(freshStats.text)")
+        print("SSH, \(Self.COMMANDS) commands, pooled session:      \(pooledStats.text)")
+
+        XCTAssertEqual(pool.connects, 1)
+        XCTAssertEqual(pool.reuses, Self.COMMANDS - 1)
+        XCTAssertLessThan(pooledStats.p50!, freshStats.p50!)
+    }
+
+    /// Leases of one session used from several threads take turns on it instead of corrupting it
+    func testConcurrentLeasesRunSequentiallyOnTheSharedSession() throws {
+        let sshd = try StandInSSHD()
+        self.sshd = sshd
+
+        let pool = SSHPool()
+        defer { pool.removeAll() }
+        let lock = NSRecursiveLock()
+        var outputs: [String] = []
+        var errors: [Error] = []
+
+        DispatchQueue.concurrentPerform(iterations: 4) { i in
+            do {
+                let lease = try pool.lease(host: sshd.host, port: sshd.port, username: sshd.username, authMethod: sshd.key)
+                defer { lease.release() }
+                let output = try lease.ssh.capture("echo \(i)").output
+                lock.around { outputs.append(output.trimmingCharacters(in: .whitespacesAndNewlines)) }
+            } catch {
+                lock.around { errors.append(error) }
+            }
+        }
+
+        XCTAssertTrue(errors.isEmpty, "\(errors)")
+        XCTAssertEqual(Set(outputs), ["0", "1", "2", "3"])
+    }
+}
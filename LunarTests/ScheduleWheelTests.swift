@@ -0,0 +1,151 @@
+//
+//  ScheduleWheelTests.swift
+//  LunarTests
+//
+//  Created by Alin Panaitiu on 19.10.2026.
+//  Copyright © 2026 Alin. All rights reserved.
+//
+
+import XCTest
+@testable import Lunar
+
+/// Drives a wheel without a timer through a virtual clock, actions run synchronously because tests run on the main thread
+final class ScheduleWheelTests: XCTestCase {
+    var now = Date(timeIntervalSince1970: 1_700_000_000)
+    lazy var wheel = ScheduleWheel(resolution: 1, clock: { [unowned self] in now }, automatic: false)
+
+    func advance(_ seconds: TimeInterval) {
+        now += seconds
+        wheel.advance(to: now)
+    }
+
+    func testFiresOnceAtTheDeadline() {
+        var fired = 0
+        wheel.schedule(at: now + 90, display: "a", kind: .contrastTransition) { fired += 1 }
+
+        advance(89)
+        XCTAssertEqual(fired, 0)
+        advance(1)
+        XCTAssertEqual(fired, 1)
+        advance(100)
+        XCTAssertEqual(fired, 1)
+        XCTAssertTrue(wheel.pending.isEmpty)
+    }
+
+    func testSameKindReplacesThePreviousEvent() {
+        var fired: [String] = []
+        wheel.schedule(at: now + 10, display: "a", kind: .contrastTransition) { fired.append("a1") }
+        wheel.schedule(at: now + 20, display: "a", kind: .contrastTransition) { fired.append("a2") }
+        wheel.schedule(at: now + 10, display: "a", kind: .brightnessTransition) { fired.append("a-transition") }
+        wheel.schedule(at: now + 10, display: "b", kind: .contrastTransition) { fired.append("b") }
+
+        XCTAssertEqual(wheel.nextDeadline(for: "a", kind: .contrastTransition), now + 20)
+        advance(15)
+        XCTAssertEqual(Set(fired), ["a-transition", "b"])
+        advance(5)
+        XCTAssertEqual(fired.last, "a2")
+        XCTAssertEqual(fired.count, 3)
+    }
+
+    func testCancelledEventsDontFire() {
+        var fired = 0
+        let event = wheel.schedule(at: now + 5, display: "a", kind: .contrastTransition) { fired += 1 }
+        wheel.schedule(at: now + 5, display: "b", kind: .brightnessTransition) { fired += 1 }
+        wheel.schedule(at: now + 5, display: "b", kind: .contrastTransition) { fired += 1 }
+
+        event.cancel()
+        wheel.cancel(display: "b")
+        XCTAssertNil(wheel.nextDeadline(for: "a"))
+        XCTAssertNil(wheel.nextDeadline(for: "b"))
+
+        advance(10)
+        XCTAssertEqual(fired, 0)
+    }
+
+    func testEventsOnTheSameTickShareAWakeup() {
+        var fired = 0
+        for display in ["a", "b", "c"] {
+            wheel.schedule(at: now + 30, display: display, kind: .contrastTransition) { fired += 1 }
+        }
+
+        advance(60)
+        XCTAssertEqual(fired, 3)
+        XCTAssertEqual(wheel.wakeups, 1)
+        XCTAssertEqual(wheel.fired, 3)
+    }
+
+    func testFarDeadlinesCascadeDownToTheExactTick() {
+        // one deadline on each level (64, 64², 64³ ticks) and one past the wheel in the overflow list
+        let offsets: [TimeInterval] = [5, 100, 5000, 300_000, 20_000_000]
+        var fired: [TimeInterval] = []
+        for (i, offset) in offsets.enumerated() {
+            wheel.schedule(at: now + offset, display: "display\(i)", kind: .contrastTransition) { fired.append(offset) }
+        }
+        XCTAssertEqual(wheel.pending.map(\.display), offsets.indices.map { "display\($0)" })
+
+        let start = now
+        for offset in offsets {
+            advance((start + offset - 1).timeIntervalSince(now))
+            XCTAssertFalse(fired.contains(offset), "fired \(offset) a tick early")
+            advance(1)
+            XCTAssertEqual(fired.last, offset)
+        }
+        XCTAssertEqual(fired, offsets)
+    }
+
+    func testRepeatingFiresTheGivenNumberOfTimes() {
+        var fired: [TimeInterval] = []
+        var finished = 0
+        let start = now
+        wheel.repeating(every: 2, times: 3, display: "a", kind: .brightnessTransition, onFinish: { _ in finished += 1 }) { [unowned self] in
+            fired.append(now.timeIntervalSince(start))
+        }
+
+        for _ in 0 ..< 10 {
+            advance(1)
+        }
+        XCTAssertEqual(fired, [2, 4, 6])
+        XCTAssertEqual(finished, 1)
+    }
+
+    func testRepeatingDoesntBurstThroughMissedSteps() {
+        var fired = 0
+        let event = wheel.repeating(every: 1, times: 5, display: "a", kind: .brightnessTransition) { fired += 1 }
+
+        // a sleep: the first step and the one at wake fire, the missed ones in between don't
+        advance(30)
+        XCTAssertEqual(fired, 2)
+        XCTAssertEqual(event.remaining, 3)
+
+        for _ in 0 ..< 5 {
+            advance(1)
+        }
+        XCTAssertEqual(fired, 5)
+    }
+
+    func testCountersAndCancellationCanBeReadFromOtherThreads() {
+        let events = (0 ..< 64).map { i in
+            wheel.repeating(every: 1, times: 1000, display: "display\(i)", kind: .brightnessTransition) {}
+        }
+
+        let reading = expectation(description: "readers finished")
+        DispatchQueue.global().async { [wheel] in
+            DispatchQueue.concurrentPerform(iterations: 8) { _ in
+                for _ in 0 ..< 500 {
+                    XCTAssertLessThanOrEqual(wheel.wakeups, wheel.fired)
+                    _ = events.filter(\.cancelled).map(\.remaining)
+                }
+            }
+            reading.fulfill()
+        }
+        for (i, event) in events.enumerated() {
+            advance(1)
+            if i.isMultiple(of: 2) {
+                event.cancel()
+            }
+        }
+        wait(for: [reading], timeout: 30)
+
+        XCTAssertEqual(events.filter(\.cancelled).count, 32)
+    }
+}
@@ -0,0 +1,170 @@
+//
+//  SensorEventStreamTests.swift
+//  LunarTests
+//
+//  Created by Alin Panaitiu on 19.10.2026.
+//  Copyright © 2026 Alin. All rights reserved.
+//
+
+import Socket
+import XCTest
+@testable import Lunar
+
+// MARK: - StandInEventServer
+
+/// Serves `/events` the way ESPHome's `web_server` does: a chunked `text/event-stream` response, one client at a time
+final class StandInEventServer {
+    init() throws {
+        socket = try Socket.create()
+        try socket.listen(on: 0, node: "127.0.0.1")
+        port = socket.listeningPort
+    }
+
+    let socket: Socket
+    let port: Int32
+
+    var url: URL { URL(string: "http://127.0.0.1:\(port)/events")! }
+
+    /// Accepts the next connection, reads its request and answers with the event stream headers
+    func accept() throws -> Socket {
+        let client = try socket.acceptClientConnection()
+        var request = Data()
+        while request.range(of: Data("\r\n\r\n".utf8)) == nil {
+            guard try client.read(into: &request) > 0 else { throw URLError(.networkConnectionLost) }
+        }
+        try client.write(from: "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\nTransfer-Encoding: chunked\r\n\r\n")
+        return client
+    }
+
+    func send(lux: Double, id: String = "sensor-ambient_light", to client: Socket) throws {
+        let event = "event: state\ndata: {\"id\":\"\(id)\",\"value\":\(lux),\"state\":\"\(lux) lx\"}\n\n"
+        try client.write(from: String(event.utf8.count, radix: 16) + "\r\n" + event + "\r\n")
+    }
+
+    func close() {
+        socket.close()
+    }
+}
+
+// MARK: - SensorEventStreamTests
+
+final class SensorEventStreamTests: XCTestCase {
+    var server: StandInEventServer!
+    var stream: SensorEventStream?
+
+    override func setUpWithError() throws {
+        server = try StandInEventServer()
+    }
+
+    override func tearDown() {
+        stream?.stop()
+        stream = nil
+        server?.close()
+        server = nil
+    }
+
+    func state<T>(_ value: () -> T) -> T {
+        SensorEventStream.queue.sync(execute: value)
+    }
+
+    func testDeliversTheLatestValueAndIgnoresOtherSensors() throws {
+        var received: [Double] = []
+        let last = expectation(description: "last value delivered")
+        stream = SensorEventStream(url: server.url) { lux in
+            received.append(lux)
+            if lux == 999 {
+                last.fulfill()
+            }
+        }
+        stream?.start()
+
+        let client = try server.accept()
+        defer { client.close() }
+        for i in 0 ..< 1000 {
+            try server.send(lux: i.d, to: client)
+            try server.send(lux: 5000, id: "sensor-temperature", to: client)
+        }
+        wait(for: [last], timeout: 10)
+
+        XCTAssertEqual(state { stream!.events }, 1000)
+        XCTAssertFalse(received.contains(5000))
+        // samples that arrive while a main thread hop is pending replace each other
+        XCTAssertLessThanOrEqual(received.count, 1000)
+        XCTAssertEqual(received, received.sorted())
+    }
+
+    func testReconnectsAfterTheSensorDropsTheConnection() throws {
+        var connections: [Bool] = []
+        let first = expectation(description: "first value")
+        let second = expectation(description: "value after reconnecting")
+        stream = SensorEventStream(url: server.url, onConnectionChange: { connections.append($0) }) { lux in
+            if lux == 1 { first.fulfill() }
+            if lux == 2 { second.fulfill() }
+        }
+        stream?.start()
+
+        let client = try server.accept()
+        try server.send(lux: 1, to: client)
+        wait(for: [first], timeout: 10)
+        client.close()
+
+        let reconnected = try server.accept()
+        defer { reconnected.close() }
+        try server.send(lux: 2, to: reconnected)
+        wait(for: [second], timeout: 10)
+
+        XCTAssertEqual(state { stream!.reconnects }, 1)
+        XCTAssertEqual(connections, [true, false, true])
+    }
+
+    /// Time from the sensor writing a sample to `onLux` running on the main thread
+    func testDeliveryLatency() throws {
+        let samples = 200
+        let delivered = DispatchSemaphore(value: 0)
+        stream = SensorEventStream(url: server.url) { _ in delivered.signal() }
+        stream?.start()
+
+        var latency = LatencyStats(capacity: samples)
+        let finished = expectation(description: "samples delivered")
+        let startedAt = DispatchTime.now()
+        DispatchQueue.global().async { [server] in
+            defer { finished.fulfill() }
+            guard let client = try? server!.accept() else { return }
+            defer { client.close() }
+
+            for i in 0 ..< samples {
+                let sentAt = DispatchTime.now()
+                guard (try? server!.send(lux: i.d, to: client)) != nil, delivered.wait(timeout: .now() + 5) == .success else {
+                    latency.recordFailure()
+                    continue
+                }
+                latency.record((DispatchTime.now().rawValue - sentAt.rawValue).d / 1_000_000)
+            }
+        }
+        wait(for: [finished], timeout: 60)
+
+        let seconds = (DispatchTime.now().rawValue - startedAt.rawValue).d / 1_000_000_000
+        let stats = Lunar.Bench.Stats(latency, retries: 0, seconds: seconds)
+        print("Sensor event stream, \(samples) samples: \(stats.text)")
+        XCTAssertEqual(stats.failures, 0)
+        XCTAssertEqual(stats.count, samples)
+    }
+
+    @MainActor
+    func testPolledLuxIsNotRecordedWhileStreaming() {
+        let samples = HealthMetrics.shared.luxSamples
+        AMI.luxStreamConnected = true
+        defer { AMI.luxStreamConnected = false }
+
+        let before = samples.value
+        AMI.lux = 120
+        XCTAssertEqual(samples.value, before, "polled value recorded while the stream is connected")
+        AMI.stream(lux: 121)
+        XCTAssertEqual(samples.value, before + 1)
+        XCTAssertEqual(AMI.lux, 121)
+
+        AMI.luxStreamConnected = false
+        AMI.lux = 122
+        XCTAssertEqual(samples.value, before + 2)
+    }
+}
@@ -0,0 +1,92 @@
+//
+//  SettingsSnapshotTests.swift
+//  LunarTests
+//
+//  Created by Alin Panaitiu on 19.10.2026.
+//  Copyright © 2026 Alin. All rights reserved.
+//
+
+import Defaults
+import XCTest
+@testable import Lunar
+
+/// Settings read throughput while other threads keep writing, `CachedDefaults` against the cache it replaced
+final class SettingsSnapshotTests: XCTestCase {
+    static let READERS = 6
+    static let WRITERS = 2
+    static let READS = 50000
+    static let WRITES = 2000
+
+    /// Runs `body` on background threads while the main thread keeps its run loop going, so reads that hop to main can finish
+    func runConcurrently(_ threads: Int, _ body: @escaping (Int) -> Void) -> Double {
+        let group = DispatchGroup()
+        let startedAt = DispatchTime.now()
+        for i in 0 ..< threads {
+            DispatchQueue.global(qos: .userInitiated).async(group: group) { body(i) }
+        }
+        while group.wait(timeout: .now()) == .timedOut {
+            RunLoop.current.run(until: Date().addingTimeInterval(0.001))
+        }
+        return (DispatchTime.now().rawValue - startedAt.rawValue).d / 1_000_000_000
+    }
+
+    func testReadThroughputUnderWrites() {
+        let step = CachedDefaults[.brightnessStep]
+        // writers store the values the settings already have, so the app state doesn't change
+        let writes: [(name: String, value: Any)] = [
+            (Defaults.Keys.brightnessStep.name, step),
+            (Defaults.Keys.smoothTransition.name, CachedDefaults[.smoothTransition]),
+        ]
+        let lock = NSRecursiveLock()
+        var mismatches = 0
+
+        let snapshotSeconds = runConcurrently(Self.READERS + Self.WRITERS) { i in
+            guard i >= Self.WRITERS else {
+                for n in 0 ..< Self.WRITES {
+                    let write = writes[n % writes.count]
+                    CachedDefaults.store(write.name, write.value)
+                }
+                return
+            }
+
+            let wrong = (0 ..< Self.READS).filter { _ in CachedDefaults[.brightnessStep] != step }.count
+            lock.around { mismatches += wrong }
+        }
+
+        // what the getter did before: hop to main, look the value up through the queue and cast it
+        let legacy = QueueDictionary<String, Any>(dict: Dictionary(uniqueKeysWithValues: writes.map { ($0.name, $0.value) }))
+        let legacySeconds = runConcurrently(Self.READERS + Self.WRITERS) { i in
+            guard i >= Self.WRITERS else {
+                for n in 0 ..< Self.WRITES {
+                    let write = writes[n % writes.count]
+                    legacy[write.name] = write.value
+                }
+                return
+            }
+
+            let wrong = (0 ..< Self.READS).filter { _ in mainThread { legacy[Defaults.Keys.brightnessStep.name] as? Int } != step }.count
+            lock.around { mismatches += wrong }
+        }
+
+        let reads = (Self.READERS * Self.READS).d
+        print(String(
+            format: "Settings reads, %d readers, %d writers: snapshot %.0f reads/s, queue + main thread %.0f reads/s",
+            Self.READERS, Self.WRITERS, reads / snapshotSeconds, reads / legacySeconds
+        ))
+        XCTAssertEqual(mismatches, 0)
+        XCTAssertLessThan(snapshotSeconds, legacySeconds)
+    }
+
+    func testWritesAreVisibleToTheNextReadOnAnyThread() {
+        let key = Defaults.Key<Int>("settingsSnapshotTest", default: 0)
+        let name = key.name
+        defer { CachedDefaults.reset(key) }
+
+        for value in 0 ..< 100 {
+            let generation = CachedDefaults.store(name, value)
+            let read = DispatchQueue.global().sync { CachedDefaults.snapshot.values[name] as? Int }
+            XCTAssertEqual(read, value)
+            XCTAssertGreaterThanOrEqual(CachedDefaults.snapshot.generation, generation)
+        }
+    }
+}
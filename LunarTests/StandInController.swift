@@ -0,0 +1,144 @@
+//
+//  StandInController.swift
+//  LunarTests
+//
+//  Created by Alin Panaitiu on 19.10.2026.
+//  Copyright © 2026 Alin. All rights reserved.
+//
+
+import Foundation
+import Socket
+@testable import Lunar
+
+// MARK: - StandInController
+
+/// Local HTTP/1.1 keep-alive server answering like a network controller (`/<display>/<control>/<value>` and `POST /batch`).
+///
+/// Every connection is served on its own thread, requests on a connection are answered in order.
+/// `delay` is added before each response to stand in for the network and the DDC write on the Pi.
+/// `routes` answer other endpoints by path, a route returning `nil` took over the connection and the server closes it afterwards.
+final class StandInController {
+    init(batch: BatchMode = .supported, delay: TimeInterval = 0, routes: [String: Route] = [:]) throws {
+        self.batch = batch
+        self.routes = routes
+        _delay = delay
+        socket = try Socket.create()
+        try socket.listen(on: 0, node: "127.0.0.1")
+        port = socket.listeningPort
+
+        DispatchQueue.global().async { [self] in
+            while let client = try? socket.acceptClientConnection() {
+                lock.around { _connections += 1 }
+                Thread.detachNewThread { [weak self] in self?.serve(client) }
+            }
+        }
+    }
+
+    enum BatchMode {
+        case supported
+        /// Answers `/batch` with this status, like controllers that predate it or fail on it
+        case rejected(status: Int)
+    }
+
+    struct Request {
+        let method: String
+        let path: String
+        let body: Data
+    }
+
+    typealias Route = (Request, Socket) -> (status: Int, body: String)?
+
+    let socket: Socket
+    let port: Int32
+    let batch: BatchMode
+    let routes: [String: Route]
+
+    var delay: TimeInterval {
+        get { lock.around { _delay } }
+        set { lock.around { _delay = newValue } }
+    }
+
+    var requests: [Request] { lock.around { _requests } }
+    var connections: Int { lock.around { _connections } }
+
+    var url: URL { URL(string: "http://127.0.0.1:\(port)")! }
+
+    func stop() {
+        socket.close()
+    }
+
+    private let lock = NSRecursiveLock()
+    private var _delay: TimeInterval
+    private var _requests: [Request] = []
+    private var _connections = 0
+
+    private func serve(_ client: Socket) {
+        defer { client.close() }
+
+        var buffer = Data()
+        while let request = readRequest(from: client, buffer: &buffer) {
+            lock.around { _requests.append(request) }
+            let delay = self.delay
+            if delay > 0 {
+                Thread.sleep(forTimeInterval: delay)
+            }
+
+            let response: (status: Int, body: String)? = if let route = routes[request.path] {
+                route(request, client)
+            } else {
+                respond(to: request)
+            }
+            guard let response else { return }
+
+            let head = "HTTP/1.1 \(response.status) \(response.status == 200 ? "OK" : "Error")\r\nContent-Type: text/plain\r\nContent-Length: \(response.body.utf8.count)\r\nConnection: keep-alive\r\n\r\n"
+            guard (try? client.write(from: head + response.body)) != nil else { return }
+        }
+    }
+
+    private func respond(to request: Request) -> (status: Int, body: String) {
+        guard request.path == "/batch" else {
+            return (200, "ok")
+        }
+
+        switch batch {
+        case let .rejected(status):
+            return (status, "")
+        case .supported:
+            guard request.method == "POST",
+                  let writes = try? JSONSerialization.jsonObject(with: request.body) as? [String: [[String: Any]]],
+                  let items = writes["writes"]
+            else { return (400, "") }
+
+            let results = items.map { item in "{\"ok\":true,\"value\":\"\(item["value"] ?? "")\"}" }
+            return (200, "{\"results\":[\(results.joined(separator: ","))]}")
+        }
+    }
+
+    private func readRequest(from client: Socket, buffer: inout Data) -> Request? {
+        let separator = Data("\r\n\r\n".utf8)
+        while buffer.range(of: separator) == nil {
+            guard let n = try? client.read(into: &buffer), n > 0 else { return nil }
+        }
+
+        let headEnd = buffer.range(of: separator)!
+        let head = String(decoding: buffer[..<headEnd.lowerBound], as: UTF8.self)
+        let lines = head.components(separatedBy: "\r\n")
+        let requestLine = lines[0].split(separator: " ")
+        guard requestLine.count >= 2 else { return nil }
+
+        let length = lines.dropFirst().compactMap { line -> Int? in
+            let parts = line.split(separator: ":", maxSplits: 1)
+            guard parts.count == 2, parts[0].lowercased() == "content-length" else { return nil }
+            return Int(parts[1].trimmingCharacters(in: .whitespaces))
+        }.first ?? 0
+
+        while buffer.count - headEnd.upperBound < length {
+            guard let n = try? client.read(into: &buffer), n > 0 else { return nil }
+        }
+
+        let body = buffer[headEnd.upperBound ..< headEnd.upperBound + length]
+        let request = Request(method: String(requestLine[0]), path: String(requestLine[1]), body: Data(body))
+        buffer = Data(buffer[(headEnd.upperBound + length)...])
+        return request
+    }
+}
@@ -0,0 +1,121 @@
+//
+//  StandInSSHD.swift
+//  LunarTests
+//
+//  Created by Alin Panaitiu on 19.10.2026.
+//  Copyright © 2026 Alin. All rights reserved.
+//
+
+import Foundation
+import Socket
+import XCTest
+@testable import Lunar
+
+// MARK: - StandInSSHD
+
+/// The system `sshd` running unprivileged on a free localhost port, standing in for the Raspberry Pi the installers talk to.
+///
+/// Host and user keys are generated in a temporary directory, the current user logs in with `key`.
+/// The `sftp` subsystem is enabled so the same server serves `SFTP` transfers.
+/// Tests are skipped when `sshd` or `ssh-keygen` aren't available.
+final class StandInSSHD {
+    init() throws {
+        guard FileManager.default.isExecutableFile(atPath: Self.SSHD),
+              FileManager.default.isExecutableFile(atPath: Self.SSH_KEYGEN)
+        else {
+            throw XCTSkip("\(Self.SSHD) is not available")
+        }
+
+        dir = FileManager.default.temporaryDirectory / "lunar-sshd-\(UUID().uuidString)"
+        try FileManager.default.createDirectory(at: dir, withIntermediateDirectories: true)
+
+        try Self.keygen(dir / "host_key")
+        try Self.keygen(dir / "user_key")
+        try FileManager.default.copyItem(at: dir / "user_key.pub", to: dir / "authorized_keys")
+
+        port = try Self.freePort()
+        let config = """
+        ListenAddress 127.0.0.1
+        Port \(port)
+        HostKey \((dir / "host_key").path)
+        AuthorizedKeysFile \((dir / "authorized_keys").path)
+        PidFile \((dir / "sshd.pid").path)
+        StrictModes no
+        UsePAM no
+        PasswordAuthentication no
+        KbdInteractiveAuthentication no
+        Subsystem sftp \(Self.SFTP_SERVER)
+        """
+        try config.write(to: dir / "sshd_config", atomically: true, encoding: .utf8)
+
+        process.executableURL = URL(fileURLWithPath: Self.SSHD)
+        process.arguments = ["-D", "-e", "-f", (dir / "sshd_config").path]
+        process.standardOutput = FileHandle.nullDevice
+        process.standardError = FileHandle.nullDevice
+        try process.run()
+
+        guard Self.waitForListener(on: port, timeout: 5) else {
+            stop()
+            throw XCTSkip("\(Self.SSHD) didn't start listening on port \(port)")
+        }
+    }
+
+    static let SSHD = "/usr/sbin/sshd"
+    static let SSH_KEYGEN = "/usr/bin/ssh-keygen"
+    static let SFTP_SERVER = "/usr/libexec/sftp-server"
+
+    let dir: URL
+    let port: Int32
+    let host = "127.0.0.1"
+    let username = NSUserName()
+
+    var key: SSHKey {
+        SSHKey(privateKey: (dir / "user_key").path, publicKey: (dir / "user_key.pub").path)
+    }
+
+    func stop() {
+        if process.isRunning {
+            process.terminate()
+            process.waitUntilExit()
+        }
+        try? FileManager.default.removeItem(at: dir)
+    }
+
+    private let process = Process()
+
+    /// PEM keys, libssh2 can't always read the newer OpenSSH private key format
+    private static func keygen(_ path: URL) throws {
+        let keygen = Process()
+        keygen.executableURL = URL(fileURLWithPath: SSH_KEYGEN)
+        keygen.arguments = ["-q", "-t", "rsa", "-b", "2048", "-m", "PEM", "-N", "", "-f", path.path]
+        keygen.standardOutput = FileHandle.nullDevice
+        keygen.standardError = FileHandle.nullDevice
+        try keygen.run()
+        keygen.waitUntilExit()
+
+        guard keygen.terminationStatus == 0 else {
+            throw XCTSkip("ssh-keygen exited with \(keygen.terminationStatus)")
+        }
+    }
+
+    private static func freePort() throws -> Int32 {
+        let socket = try Socket.create()
+        defer { socket.close() }
+        try socket.listen(on: 0, node: "127.0.0.1")
+        return socket.listeningPort
+    }
+
+    private static func waitForListener(on port: Int32, timeout: TimeInterval) -> Bool {
+        let deadline = Date().addingTimeInterval(timeout)
+        while Date() < deadline {
+            if let socket = try? Socket.create() {
+                defer { socket.close() }
+                if (try? socket.connect(to: "127.0.0.1", port: port)) != nil {
+                    return true
+                }
+            }
+            Thread.sleep(forTimeInterval: 0.05)
+        }
+        return false
+    }
+}
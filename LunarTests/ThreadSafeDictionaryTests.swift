@@ -0,0 +1,75 @@
+//
+//  ThreadSafeDictionaryTests.swift
+//  LunarTests
+//
+//  Created by Alin Panaitiu on 19.10.2026.
+//  Copyright © 2026 Alin. All rights reserved.
+//
+
+import XCTest
+@testable import Lunar
+
+/// Mixed read/write load on `ThreadSafeDictionary` against the queue-based `QueueDictionary` it replaced
+final class ThreadSafeDictionaryTests: XCTestCase {
+    static let THREADS = 8
+    static let OPERATIONS = 20000
+    static let KEYS = 64
+
+    /// Every thread does `OPERATIONS` random reads and writes over `KEYS` keys, `writePercent` of them writes
+    func mixedLoad(writePercent: UInt64, read: @escaping (Int) -> Int?, write: @escaping (Int, Int) -> Void) -> Double {
+        let startedAt = DispatchTime.now()
+        DispatchQueue.concurrentPerform(iterations: Self.THREADS) { thread in
+            var rng = SplitMix64(seed: UInt64(thread))
+            for _ in 0 ..< Self.OPERATIONS {
+                let r = rng.next()
+                let key = Int(r % Self.KEYS.u64)
+                if (r >> 32) % 100 < writePercent {
+                    write(key, thread)
+                } else {
+                    _ = read(key)
+                }
+            }
+        }
+        return (DispatchTime.now().rawValue - startedAt.rawValue).d / 1_000_000_000
+    }
+
+    func testMixedLoadThroughput() {
+        for writePercent: UInt64 in [1, 10, 50] {
+            let dict = ThreadSafeDictionary<Int, Int>()
+            let atomic = mixedLoad(writePercent: writePercent, read: { dict[$0] }, write: { dict[$0] = $1 })
+
+            let queue = QueueDictionary<Int, Int>()
+            let queued = mixedLoad(writePercent: writePercent, read: { queue[$0] }, write: { queue[$0] = $1 })
+
+            let operations = (Self.THREADS * Self.OPERATIONS).d
+            print(String(
+                format: "%d threads, %d%% writes: atomic snapshot %.0f ops/s, concurrent queue %.0f ops/s",
+                Self.THREADS, writePercent, operations / atomic, operations / queued
+            ))
+            if writePercent <= 10 {
+                XCTAssertLessThan(atomic, queued, "\(writePercent)% writes")
+            }
+        }
+    }
+
+    func testWritesAreVisibleToTheNextRead() {
+        let dict = ThreadSafeDictionary<Int, Int>()
+        DispatchQueue.concurrentPerform(iterations: Self.THREADS) { thread in
+            for value in 0 ..< 1000 {
+                dict[thread] = value
+                XCTAssertEqual(dict[thread], value)
+            }
+        }
+        XCTAssertEqual(dict.count, Self.THREADS)
+    }
+
+    func testUpdateIsAtomic() {
+        let dict = ThreadSafeDictionary<String, Int>()
+        DispatchQueue.concurrentPerform(iterations: Self.THREADS) { _ in
+            for _ in 0 ..< 1000 {
+                dict.update(key: "count") { $0 = ($0 ?? 0) + 1 }
+            }
+        }
+        XCTAssertEqual(dict["count"], Self.THREADS * 1000)
+    }
+}
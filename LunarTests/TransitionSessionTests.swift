@@ -0,0 +1,296 @@
+//
+//  TransitionSessionTests.swift
+//  LunarTests
+//
+//  Created by Alin Panaitiu on 19.10.2026.
+//  Copyright © 2026 Alin. All rights reserved.
+//
+
+import Socket
+import XCTest
+@testable import Lunar
+
+// MARK: - StandInTransitions
+
+/// Controller side of the `/transition` protocol: interpolates linearly on a 10ms tick and streams `applied` events.
+///
+/// `eventDelay` is added before every event to stand in for a slow link, `acks` turns the events off entirely.
+final class StandInTransitions {
+    struct Running {
+        var from: Double
+        var target: Double
+        var start: Date
+        var duration: TimeInterval
+        var value: Double
+    }
+
+    var routes: [String: StandInController.Route] {
+        [
+            "/transition": { [weak self] request, _ in
+                self?.start(request.body)
+                return (200, "{}")
+            },
+            "/transition/cancel": { [weak self] request, _ in
+                self?.cancel(request.body)
+                return (200, "{}")
+            },
+            "/transition/events": { [weak self] _, client in
+                self?.stream(to: client)
+                return nil
+            },
+        ]
+    }
+
+    var acks: Bool {
+        get { lock.around { _acks } }
+        set { lock.around { _acks = newValue } }
+    }
+
+    var eventDelay: TimeInterval {
+        get { lock.around { _eventDelay } }
+        set { lock.around { _eventDelay = newValue } }
+    }
+
+    var commands: [TransitionCommand] { lock.around { _commands } }
+    var cancelled: [UInt64] { lock.around { _cancelled } }
+    var running: [UInt64: Running] { lock.around { _running } }
+
+    func stop() {
+        lock.around { stopped = true }
+    }
+
+    private let lock = NSRecursiveLock()
+    private var _acks = true
+    private var _eventDelay: TimeInterval = 0
+    private var _commands: [TransitionCommand] = []
+    private var _cancelled: [UInt64] = []
+    private var _running: [UInt64: Running] = [:]
+    private var stopped = false
+
+    private func start(_ body: Data) {
+        guard let commands = try? JSONDecoder().decode([String: [TransitionCommand]].self, from: body)["transitions"] else { return }
+
+        let now = Date()
+        lock.around {
+            for command in commands {
+                _commands.append(command)
+                // a known id is retargeted from the value applied last
+                let from = _running[command.id]?.value ?? command.from.map(\.d) ?? 0
+                _running[command.id] = Running(from: from, target: command.target.d, start: now, duration: command.durationMs.d / 1000, value: from)
+            }
+        }
+    }
+
+    private func cancel(_ body: Data) {
+        guard let ids = try? JSONDecoder().decode([String: [UInt64]].self, from: body)["ids"] else { return }
+
+        lock.around {
+            for id in ids {
+                _cancelled.append(id)
+                _running.removeValue(forKey: id)
+            }
+        }
+    }
+
+    private func stream(to client: Socket) {
+        guard (try? client.write(from: "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\nTransfer-Encoding: chunked\r\n\r\n")) != nil else { return }
+
+        while !lock.around({ stopped }) {
+            Thread.sleep(forTimeInterval: 0.01)
+
+            let now = Date()
+            let (events, acks, delay) = lock.around { () -> ([String], Bool, TimeInterval) in
+                var events: [String] = []
+                for (id, var transition) in _running {
+                    let progress = transition.duration > 0 ? min(now.timeIntervalSince(transition.start) / transition.duration, 1) : 1
+                    let value = (transition.from + (transition.target - transition.from) * progress).rounded()
+                    let done = progress >= 1
+                    let changed = value != transition.value
+
+                    transition.value = value
+                    _running[id] = done ? nil : transition
+                    if changed || done {
+                        events.append("event: applied\ndata: {\"id\":\(id),\"value\":\(Int(value)),\"done\":\(done)}\n\n")
+                    }
+                }
+                return (events, _acks, _eventDelay)
+            }
+            guard acks else { continue }
+
+            for event in events {
+                if delay > 0 {
+                    Thread.sleep(forTimeInterval: delay)
+                }
+                guard (try? client.write(from: String(event.utf8.count, radix: 16) + "\r\n" + event + "\r\n")) != nil else { return }
+            }
+        }
+    }
+}
+
+// MARK: - TransitionSessionTests
+
+/// Runs `TransitionSession` against a stand-in controller, once without and once with 30ms injected on every response and event
+final class TransitionSessionTests: XCTestCase {
+    static let DELAYS: [TimeInterval] = [0, 0.03]
+
+    var cleanup: [() -> Void] = []
+
+    override func tearDown() {
+        cleanup.forEach { $0() }
+        cleanup = []
+    }
+
+    func session(delay: TimeInterval, ackGrace: TimeInterval = 2) throws -> (TransitionSession, StandInTransitions) {
+        let transitions = StandInTransitions()
+        transitions.eventDelay = delay
+        let controller = try StandInController(delay: delay, routes: transitions.routes)
+        let client = ControllerClient(host: "127.0.0.1", port: controller.port.i)
+        let session = TransitionSession(client: client, base: controller.url, ackGrace: ackGrace)
+
+        cleanup.append {
+            session.stop()
+            transitions.stop()
+            controller.stop()
+        }
+        return (session, transitions)
+    }
+
+    func testProgressIsAcknowledgedUntilDone() throws {
+        for delay in Self.DELAYS {
+            let (session, _) = try session(delay: delay)
+            let lock = NSRecursiveLock()
+            var values: [UInt16] = []
+            var final: UInt16?
+            let done = expectation(description: "done with \(delay)s delay")
+
+            session.start(display: 1, control: "brightness", from: 0, to: 100, duration: 0.3, onProgress: { value, isDone in
+                lock.around { values.append(value) }
+                if isDone {
+                    final = value
+                    done.fulfill()
+                }
+            }, fallback: { XCTFail("fell back to /smooth") })
+            wait(for: [done], timeout: 10)
+
+            XCTAssertEqual(final, 100)
+            XCTAssertGreaterThan(values.count, 2, "no progress before done with \(delay)s delay")
+            XCTAssertEqual(values, values.sorted())
+            XCTAssertEqual(session.supported, true)
+        }
+    }
+
+    func testRetargetContinuesFromTheAppliedValue() throws {
+        for delay in Self.DELAYS {
+            let (session, transitions) = try session(delay: delay)
+            let lock = NSRecursiveLock()
+            let halfway = expectation(description: "progress with \(delay)s delay")
+            var reached = false
+
+            session.start(display: 1, control: "brightness", from: 0, to: 100, duration: 2, onProgress: { value, _ in
+                lock.around {
+                    guard value >= 20, !reached else { return }
+                    reached = true
+                    halfway.fulfill()
+                }
+            }, fallback: { XCTFail("fell back to /smooth") })
+            wait(for: [halfway], timeout: 10)
+
+            var values: [UInt16] = []
+            var final: UInt16?
+            let done = expectation(description: "retargeted transition done with \(delay)s delay")
+            session.start(display: 1, control: "brightness", from: 0, to: 10, duration: 0.3, onProgress: { value, isDone in
+                lock.around { values.append(value) }
+                if isDone {
+                    final = value
+                    done.fulfill()
+                }
+            }, fallback: { XCTFail("fell back to /smooth") })
+            wait(for: [done], timeout: 10)
+
+            let commands = transitions.commands
+            XCTAssertEqual(commands.count, 2)
+            XCTAssertEqual(Set(commands.map(\.id)).count, 1, "retargeting started a new transition")
+            XCTAssertEqual(commands.last?.from, nil)
+            XCTAssertEqual(final, 10)
+            // it comes back down from where the first transition was, instead of starting over from 0
+            let retargeted = lock.around { values }
+            XCTAssertGreaterThanOrEqual(retargeted.first ?? 0, 20)
+            XCTAssertGreaterThanOrEqual(retargeted.min() ?? 0, 10)
+        }
+    }
+
+    func testCancelStopsTheInterpolationOnTheController() throws {
+        for delay in Self.DELAYS {
+            let (session, transitions) = try session(delay: delay)
+            let lock = NSRecursiveLock()
+            let started = expectation(description: "progress with \(delay)s delay")
+            var progress = 0
+
+            session.start(display: 2, control: "contrast", from: 0, to: 100, duration: 2, onProgress: { _, _ in
+                let count = lock.around { () -> Int in
+                    progress += 1
+                    return progress
+                }
+                if count == 1 {
+                    started.fulfill()
+                }
+            }, fallback: { XCTFail("fell back to /smooth") })
+            wait(for: [started], timeout: 10)
+
+            let cancelled = expectation(description: "cancel answered with \(delay)s delay")
+            session.cancel(display: 2, control: "contrast") { cancelled.fulfill() }
+            wait(for: [cancelled], timeout: 10)
+
+            let afterCancel = lock.around { progress }
+            let quiet = expectation(description: "no progress after cancel")
+            quiet.isInverted = true
+            wait(for: [quiet], timeout: 0.3)
+
+            XCTAssertEqual(lock.around { progress }, afterCancel)
+            XCTAssertTrue(transitions.running.isEmpty)
+            XCTAssertEqual(transitions.cancelled, transitions.commands.map(\.id))
+            XCTAssertTrue(session.applied.isEmpty)
+        }
+    }
+
+    func testMissingAcknowledgmentsExpireAfterTheGracePeriod() throws {
+        for delay in Self.DELAYS {
+            let (session, transitions) = try session(delay: delay, ackGrace: 0.5)
+            transitions.acks = false
+
+            var final: UInt16?
+            let done = expectation(description: "expired with \(delay)s delay")
+            let startedAt = Date()
+            session.start(display: 1, control: "brightness", from: 0, to: 70, duration: 0.2, onProgress: { value, isDone in
+                XCTAssertTrue(isDone)
+                final = value
+                done.fulfill()
+            }, fallback: { XCTFail("fell back to /smooth") })
+            wait(for: [done], timeout: 10)
+
+            XCTAssertGreaterThanOrEqual(Date().timeIntervalSince(startedAt), 0.65)
+            XCTAssertEqual(final, 70)
+        }
+    }
+
+    func testControllersWithoutTransitionsFallBackToSmooth() throws {
+        let controller = try StandInController(routes: ["/transition": { _, _ in (404, "") }])
+        let client = ControllerClient(host: "127.0.0.1", port: controller.port.i)
+        let session = TransitionSession(client: client, base: controller.url)
+        cleanup.append {
+            session.stop()
+            controller.stop()
+        }
+
+        let fellBack = expectation(description: "fallback")
+        fellBack.expectedFulfillmentCount = 2
+        session.start(display: 1, control: "brightness", from: 0, to: 100, duration: 1, onProgress: { _, _ in XCTFail("progress without support") }) {
+            fellBack.fulfill()
+        }
+        session.start(display: 2, control: "brightness", from: 0, to: 100, duration: 1, onProgress: { _, _ in XCTFail("progress without support") }) {
+            fellBack.fulfill()
+        }
+        wait(for: [fellBack], timeout: 10)
+        XCTAssertEqual(session.supported, false)
+    }
+}